@@ -0,0 +1,755 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Benchmark of the path between the backend and the Python interpreter of a
+// model instance. The benchmark starts src/resources/startup.py with an
+// identity model and drives it the way a model instance of the backend does:
+// the inputs are copied into the shared memory region, Execute is called over
+// gRPC and the outputs are copied out of the region. The latency reported for
+// every configuration is the time of the whole round trip. The processing of
+// the responses is also measured on its own, along with the number of
+// allocations it makes.
+
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <new>
+#include <string>
+#include <vector>
+
+#include <benchmark/benchmark.h>
+#include <grpcpp/grpcpp.h>
+
+#include "output_index.h"
+#include "python_host.grpc.pb.h"
+#include "shm_manager.h"
+
+namespace {
+
+// Allocations made by the current thread, counted by the replacements of the
+// global allocation functions below. The threads of gRPC aren't counted.
+thread_local uint64_t allocation_count = 0;
+
+}  // namespace
+
+void*
+operator new(size_t size)
+{
+  ++allocation_count;
+  void* ptr = malloc((size == 0) ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void
+operator delete(void* ptr) noexcept
+{
+  free(ptr);
+}
+
+#ifdef __cpp_sized_deallocation
+void
+operator delete(void* ptr, size_t size) noexcept
+{
+  free(ptr);
+}
+#endif  // __cpp_sized_deallocation
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Time allowed for the interpreter to import the model and start listening.
+constexpr int kStartupTimeoutMs = 60000;
+
+// Initial size of the shared memory region, it is grown on demand like the
+// regions of the backend.
+constexpr uint64_t kShmDefaultByteSize = 64 * 1024 * 1024;
+constexpr uint64_t kShmGrowthByteSize = 64 * 1024 * 1024;
+
+// Size of the outputs of BM_ResponseLoop.
+constexpr uint64_t kResponseLoopTensorByteSize = 4096;
+
+// Every element of the BYTES tensors is a 4 byte length followed by the
+// payload, so an element takes 64 bytes in the serialized tensor.
+constexpr uint64_t kBytesElementPayload = 60;
+constexpr uint64_t kBytesElementByteSize = 4 + kBytesElementPayload;
+
+std::string
+EnvOrDefault(const char* name, const std::string& default_value)
+{
+  const char* value = getenv(name);
+  return (value == nullptr) ? default_value : std::string(value);
+}
+
+std::string
+ErrnoMessage(const std::string& msg)
+{
+  return msg + ": " + std::string(strerror(errno));
+}
+
+// Convert 'err' to 'error', deleting it. Return true if there was no error.
+bool
+Succeeded(TRITONSERVER_Error* err, std::string* error)
+{
+  if (err == nullptr) {
+    return true;
+  }
+  *error = TRITONSERVER_ErrorMessage(err);
+  TRITONSERVER_ErrorDelete(err);
+  return false;
+}
+
+// A Python interpreter running the identity model.
+class Interpreter {
+ public:
+  static bool Launch(std::unique_ptr<Interpreter>* interpreter);
+  ~Interpreter();
+
+  PythonInterpreter::Stub* Stub() { return stub_.get(); }
+  SharedMemory& Shm() { return *shm_; }
+  OutputIndex& Outputs() { return output_index_; }
+
+ private:
+  Interpreter() : pid_(-1), control_fd_(-1) {}
+
+  bool Start(std::string* error);
+  bool Connect(std::string* error);
+
+  pid_t pid_;
+  int control_fd_;
+  std::string tmp_dir_;
+  std::string domain_socket_;
+  std::unique_ptr<SharedMemory> shm_;
+  OutputIndex output_index_;
+  std::unique_ptr<PythonInterpreter::Stub> stub_;
+};
+
+bool
+Interpreter::Launch(std::unique_ptr<Interpreter>* interpreter)
+{
+  std::unique_ptr<Interpreter> launched(new Interpreter());
+  std::string error;
+  if (!launched->Start(&error) || !launched->Connect(&error)) {
+    std::cerr << "failed to launch the Python interpreter: " << error
+              << std::endl;
+    return false;
+  }
+
+  *interpreter = std::move(launched);
+  return true;
+}
+
+bool
+Interpreter::Start(std::string* error)
+{
+  char tmp_dir_template[] = "/tmp/python_ipc_benchmark_XXXXXX";
+  if (mkdtemp(tmp_dir_template) == nullptr) {
+    *error = ErrnoMessage("failed to create a temporary directory");
+    return false;
+  }
+  tmp_dir_ = tmp_dir_template;
+  domain_socket_ = tmp_dir_ + "/benchmark.sock";
+
+  const std::string shm_name =
+      "/python_ipc_benchmark_" + std::to_string(getpid());
+  if (!Succeeded(
+          SharedMemory::Create(
+              shm_name, kShmDefaultByteSize, kShmGrowthByteSize,
+              -1 /* numa_node */, &shm_),
+          error)) {
+    return false;
+  }
+
+  int fds[2];
+  if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) == -1) {
+    *error = ErrnoMessage("failed to create the control socket");
+    return false;
+  }
+
+  const std::string python_runtime =
+      EnvOrDefault("PYTHON_IPC_BENCHMARK_RUNTIME", "python3");
+  const std::string startup =
+      EnvOrDefault("PYTHON_IPC_BENCHMARK_STARTUP", BENCHMARK_STARTUP_PATH);
+  const std::string model =
+      EnvOrDefault("PYTHON_IPC_BENCHMARK_MODEL", BENCHMARK_MODEL_PATH);
+  const std::string python_path =
+      EnvOrDefault("PYTHON_IPC_BENCHMARK_PYTHONPATH", BENCHMARK_PYTHONPATH);
+  const std::string socket_arg = "unix://" + domain_socket_;
+  const std::string control_fd_arg = std::to_string(fds[1]);
+
+  pid_ = fork();
+  if (pid_ == -1) {
+    close(fds[0]);
+    close(fds[1]);
+    *error = ErrnoMessage("failed to fork the Python interpreter");
+    return false;
+  }
+
+  if (pid_ == 0) {
+    // The interpreter end of the socket must survive the exec.
+    fcntl(fds[1], F_SETFD, 0);
+    setenv("PYTHONPATH", python_path.c_str(), 1 /* overwrite */);
+    execlp(
+        python_runtime.c_str(), python_runtime.c_str(), startup.c_str(),
+        "--socket", socket_arg.c_str(), "--model-path", model.c_str(),
+        "--model-name", "identity", "--control-fd", control_fd_arg.c_str(),
+        nullptr);
+    std::cerr << ErrnoMessage("failed to run " + python_runtime) << std::endl;
+    _exit(1);
+  }
+
+  close(fds[1]);
+  control_fd_ = fds[0];
+
+  // The interpreter writes to the control socket once it is listening.
+  pollfd pfd = {control_fd_, POLLIN, 0};
+  char ready;
+  if ((poll(&pfd, 1, kStartupTimeoutMs) != 1) ||
+      (read(control_fd_, &ready, 1) != 1)) {
+    *error = "the interpreter exited or didn't start within " +
+             std::to_string(kStartupTimeoutMs) + " ms";
+    return false;
+  }
+
+  return true;
+}
+
+bool
+Interpreter::Connect(std::string* error)
+{
+  grpc::ChannelArguments arguments;
+  arguments.SetMaxSendMessageSize(-1);
+  arguments.SetMaxReceiveMessageSize(-1);
+  std::shared_ptr<grpc::Channel> channel = grpc::CreateCustomChannel(
+      "unix://" + domain_socket_, grpc::InsecureChannelCredentials(),
+      arguments);
+  stub_ = PythonInterpreter::NewStub(channel);
+
+  InitializationCommand init;
+  auto* arg = init.add_args();
+  arg->set_key("model_config");
+  arg->set_value("{}");
+  arg = init.add_args();
+  arg->set_key("model_name");
+  arg->set_value("identity");
+
+  grpc::ClientContext context;
+  Empty empty;
+  grpc::Status status = stub_->Init(&context, init, &empty);
+  if (!status.ok()) {
+    *error = status.error_message();
+    return false;
+  }
+
+  return true;
+}
+
+Interpreter::~Interpreter()
+{
+  if (stub_ != nullptr) {
+    grpc::ClientContext context;
+    Empty empty;
+    stub_->Fini(&context, empty, &empty);
+  }
+
+  // The interpreter exits when its end of the control socket is closed.
+  if (control_fd_ != -1) {
+    close(control_fd_);
+  }
+  if (pid_ > 0) {
+    kill(pid_, SIGTERM);
+    int status;
+    waitpid(pid_, &status, 0);
+  }
+  if (!domain_socket_.empty()) {
+    unlink(domain_socket_.c_str());
+  }
+  if (!tmp_dir_.empty()) {
+    rmdir(tmp_dir_.c_str());
+  }
+}
+
+std::unique_ptr<Interpreter> interpreter;
+
+// Arguments of BM_Execute.
+enum ExecuteArgument {
+  ARG_TENSOR_BYTE_SIZE,
+  ARG_REQUEST_COUNT,
+  ARG_OUTPUT_COUNT,
+  ARG_BYTES
+};
+
+void
+ExecuteArguments(benchmark::internal::Benchmark* bm)
+{
+  bm->ArgNames({"tensor_bytes", "requests", "outputs", "bytes_type"});
+  for (const int64_t bytes_type : {0, 1}) {
+    // 1 KB to 1 GB tensors. The BYTES tensors stop at 32 MB because the
+    // interpreter deserializes and serializes every element.
+    const int64_t max_byte_size = bytes_type ? (32 << 20) : (1 << 30);
+    for (int64_t byte_size = 1 << 10; byte_size <= max_byte_size;
+         byte_size *= 32) {
+      for (const int64_t request_count : {1, 8, 32}) {
+        // Keep the inputs of an execution within 1 GB.
+        if ((byte_size * request_count) > (1 << 30)) {
+          continue;
+        }
+        for (const int64_t output_count : {1, 4}) {
+          bm->Args({byte_size, request_count, output_count, bytes_type});
+        }
+      }
+    }
+  }
+}
+
+// Fill 'data' with a serialized BYTES tensor of elements of
+// kBytesElementPayload bytes.
+void
+SerializeBytesTensor(std::vector<char>* data)
+{
+  const uint32_t payload = kBytesElementPayload;
+  for (size_t offset = 0; (offset + kBytesElementByteSize) <= data->size();
+       offset += kBytesElementByteSize) {
+    memcpy(data->data() + offset, &payload, sizeof(payload));
+    memset(data->data() + offset + sizeof(payload), 'x', payload);
+  }
+}
+
+// Run one execution of 'execute_request' the way a model instance does. The
+// inputs are copied from 'input' and every output is copied to 'output'.
+// 'bytes_copied' returns the number of bytes copied in and out of the shared
+// memory region.
+bool
+RunExecution(
+    const std::vector<char>& input, ExecuteRequest* execute_request,
+    std::vector<char>* output, uint64_t* bytes_copied, std::string* error)
+{
+  SharedMemory& shm = interpreter->Shm();
+  shm.Reset();
+
+  uint64_t copied = 0;
+  for (auto& request : *execute_request->mutable_requests()) {
+    Tensor* tensor = request.mutable_inputs(0);
+    uint64_t offset;
+    char* buffer;
+    if (!Succeeded(shm.Allocate(input.size(), &offset, &buffer), error)) {
+      return false;
+    }
+    memcpy(buffer, input.data(), input.size());
+    tensor->set_offset(offset);
+    copied += input.size();
+  }
+
+  grpc::ClientContext context;
+  ExecuteResponse execute_response;
+  grpc::Status status =
+      interpreter->Stub()->Execute(&context, *execute_request,
+                                   &execute_response);
+  if (!status.ok()) {
+    *error = status.error_message();
+    return false;
+  }
+
+  if (execute_response.responses_size() !=
+      execute_request->requests_size()) {
+    *error = "the interpreter returned " +
+             std::to_string(execute_response.responses_size()) +
+             " responses for " +
+             std::to_string(execute_request->requests_size()) + " requests";
+    return false;
+  }
+
+  // The outputs are looked up by the requested names like the backend does.
+  OutputIndex& output_index = interpreter->Outputs();
+  for (int r = 0; r < execute_response.responses_size(); ++r) {
+    const InferenceResponse& response = execute_response.responses(r);
+    if (response.failed()) {
+      *error = response.error().message();
+      return false;
+    }
+    output_index.Build(response);
+    for (const auto& name :
+         execute_request->requests(r).requested_output_names()) {
+      const Tensor* tensor = output_index.Find(name.c_str());
+      if (tensor == nullptr) {
+        *error = "the interpreter didn't return output " + name;
+        return false;
+      }
+      char* buffer;
+      if (!Succeeded(
+              shm.Buffer(tensor->offset(), tensor->byte_size(), &buffer),
+              error)) {
+        return false;
+      }
+      const uint64_t byte_size =
+          std::min<uint64_t>(tensor->byte_size(), output->size());
+      memcpy(output->data(), buffer, byte_size);
+      copied += byte_size;
+    }
+  }
+
+  *bytes_copied = copied;
+  return true;
+}
+
+// Report the median and 99th percentile of 'latencies', in seconds.
+void
+ReportLatencies(std::vector<double>* latencies, benchmark::State& state)
+{
+  std::sort(latencies->begin(), latencies->end());
+  const auto percentile_us = [latencies](const double percentile) {
+    const size_t idx = std::min(
+        latencies->size() - 1,
+        static_cast<size_t>(percentile * latencies->size() / 100));
+    return (*latencies)[idx] * 1e6;
+  };
+  state.counters["p50_us"] = percentile_us(50);
+  state.counters["p99_us"] = percentile_us(99);
+}
+
+void
+BM_Execute(benchmark::State& state)
+{
+  // The interpreter is only started for the benchmarks that need it.
+  if ((interpreter == nullptr) && !Interpreter::Launch(&interpreter)) {
+    state.SkipWithError("failed to launch the Python interpreter");
+    return;
+  }
+
+  const bool bytes_type = state.range(ARG_BYTES) != 0;
+  const int64_t request_count = state.range(ARG_REQUEST_COUNT);
+  const int64_t output_count = state.range(ARG_OUTPUT_COUNT);
+  int64_t element_count = state.range(ARG_TENSOR_BYTE_SIZE) /
+                          (bytes_type ? kBytesElementByteSize : sizeof(float));
+  element_count = std::max<int64_t>(element_count, 1);
+  const uint64_t byte_size =
+      element_count * (bytes_type ? kBytesElementByteSize : sizeof(float));
+
+  // Source of the inputs and destination of the outputs, standing in for the
+  // buffers of the requests and responses of the server.
+  std::vector<char> input(byte_size);
+  if (bytes_type) {
+    SerializeBytesTensor(&input);
+  }
+  std::vector<char> output(byte_size);
+
+  ExecuteRequest execute_request;
+  execute_request.set_shm_region_name(interpreter->Shm().Name());
+  for (int64_t r = 0; r < request_count; ++r) {
+    InferenceRequest* request = execute_request.add_requests();
+    request->set_id(std::to_string(r));
+    Tensor* tensor = request->add_inputs();
+    tensor->set_name("INPUT0");
+    tensor->set_dtype(
+        bytes_type ? TRITONSERVER_TYPE_BYTES : TRITONSERVER_TYPE_FP32);
+    tensor->add_dims(element_count);
+    tensor->set_byte_size(byte_size);
+    for (int64_t o = 0; o < output_count; ++o) {
+      request->add_requested_output_names("OUTPUT" + std::to_string(o));
+    }
+  }
+
+  std::vector<double> latencies;
+  uint64_t bytes_copied = 0;
+  std::string error;
+  for (auto _ : state) {
+    const auto start = std::chrono::steady_clock::now();
+    if (!RunExecution(
+            input, &execute_request, &output, &bytes_copied, &error)) {
+      state.SkipWithError(error.c_str());
+      break;
+    }
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    state.SetIterationTime(elapsed.count());
+    latencies.push_back(elapsed.count());
+  }
+
+  if (latencies.empty()) {
+    return;
+  }
+
+  ReportLatencies(&latencies, state);
+  state.counters["bytes_copied"] = bytes_copied;
+  state.SetItemsProcessed(state.iterations() * request_count);
+  state.SetBytesProcessed(state.iterations() * request_count * byte_size);
+}
+
+BENCHMARK(BM_Execute)
+    ->Apply(ExecuteArguments)
+    ->UseManualTime()
+    ->Unit(benchmark::kMicrosecond);
+
+// Arguments of BM_ResponseLoop.
+enum ResponseLoopArgument {
+  ARG_LOOP_REQUEST_COUNT,
+  ARG_LOOP_OUTPUT_COUNT,
+  ARG_COPY_MESSAGES
+};
+
+void
+ResponseLoopArguments(benchmark::internal::Benchmark* bm)
+{
+  bm->ArgNames({"requests", "outputs", "copy_messages"});
+  for (const int64_t copy_messages : {0, 1}) {
+    for (const int64_t request_count : {1, 8, 32}) {
+      for (const int64_t output_count : {1, 8, 32}) {
+        bm->Args({request_count, output_count, copy_messages});
+      }
+    }
+  }
+}
+
+// Copy the output 'tensor' out of 'shm' to 'output' after checking its byte
+// size against its shape, like the backend does for an FP32 output.
+bool
+CopyOutput(
+    SharedMemory* shm, const std::string& name, const Tensor& tensor,
+    const uint64_t byte_size, std::vector<char>* output, std::string* error)
+{
+  if (tensor.byte_size() != byte_size) {
+    *error = "output tensor '" + name + "' has " +
+             std::to_string(tensor.byte_size()) + " bytes, expected " +
+             std::to_string(byte_size);
+    return false;
+  }
+  char* buffer;
+  if (!Succeeded(shm->Buffer(tensor.offset(), byte_size, &buffer), error)) {
+    return false;
+  }
+  memcpy(output->data(), buffer, std::min<uint64_t>(byte_size, output->size()));
+  return true;
+}
+
+// Process the responses of 'execute_response' like the backend does. The
+// requested outputs are looked up with 'output_index' and the output 'j' of
+// every request is copied to 'outputs[j]'.
+bool
+ProcessResponses(
+    const ExecuteRequest& execute_request,
+    const ExecuteResponse& execute_response, SharedMemory* shm,
+    OutputIndex* output_index, std::vector<std::vector<char>>* outputs,
+    std::string* error)
+{
+  for (int r = 0; r < execute_response.responses_size(); ++r) {
+    const InferenceResponse& response = execute_response.responses(r);
+    const auto& names = execute_request.requests(r).requested_output_names();
+    output_index->Build(response);
+    for (int j = 0; j < names.size(); ++j) {
+      const Tensor* tensor = output_index->Find(names[j].c_str());
+      if (tensor == nullptr) {
+        *error = "can't find output tensor with name " + names[j];
+        return false;
+      }
+      uint64_t byte_size = sizeof(float);
+      for (const int64_t dim : tensor->dims()) {
+        byte_size *= dim;
+      }
+      if (!CopyOutput(
+              shm, tensor->name(), *tensor, byte_size, &(*outputs)[j],
+              error)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+// Process the responses of 'execute_response' like the backend did before
+// OutputIndex: the messages are copied and every requested output is
+// searched for among all the outputs of the response.
+bool
+ProcessResponsesByCopy(
+    const ExecuteRequest& execute_request,
+    const ExecuteResponse& execute_response, SharedMemory* shm,
+    std::vector<std::vector<char>>* outputs, std::string* error)
+{
+  for (int r = 0; r < execute_response.responses_size(); ++r) {
+    InferenceResponse response = execute_response.responses(r);
+    const auto& names = execute_request.requests(r).requested_output_names();
+    for (int j = 0; j < names.size(); ++j) {
+      auto it = std::find_if(
+          response.outputs().begin(), response.outputs().end(),
+          [&names, j](const Tensor& tensor) {
+            return tensor.name() == names[j];
+          });
+      if (it == response.outputs().end()) {
+        *error = "can't find output tensor with name " + names[j];
+        return false;
+      }
+      const Tensor tensor = *it;
+      const std::vector<int64_t> dims(
+          tensor.dims().begin(), tensor.dims().end());
+      const std::string name = tensor.name();
+      uint64_t byte_size = sizeof(float);
+      for (const int64_t dim : dims) {
+        byte_size *= dim;
+      }
+      if (!CopyOutput(
+              shm, name, tensor, byte_size, &(*outputs)[j], error)) {
+        return false;
+      }
+    }
+  }
+
+  return true;
+}
+
+void
+BM_ResponseLoop(benchmark::State& state)
+{
+  const int64_t request_count = state.range(ARG_LOOP_REQUEST_COUNT);
+  const int64_t output_count = state.range(ARG_LOOP_OUTPUT_COUNT);
+  const bool copy_messages = state.range(ARG_COPY_MESSAGES) != 0;
+  const int64_t element_count = kResponseLoopTensorByteSize / sizeof(float);
+
+  std::unique_ptr<SharedMemory> shm;
+  std::string error;
+  if (!Succeeded(
+          SharedMemory::Create(
+              "/python_ipc_benchmark_responses_" + std::to_string(getpid()),
+              kShmDefaultByteSize, kShmGrowthByteSize, -1 /* numa_node */,
+              &shm),
+          &error)) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+
+  // The outputs are returned in the reverse order of the requested outputs,
+  // the model is free to return them in any order.
+  ExecuteRequest execute_request;
+  ExecuteResponse execute_response;
+  for (int64_t r = 0; r < request_count; ++r) {
+    InferenceRequest* request = execute_request.add_requests();
+    InferenceResponse* response = execute_response.add_responses();
+    for (int64_t o = 0; o < output_count; ++o) {
+      request->add_requested_output_names("OUTPUT" + std::to_string(o));
+    }
+    for (int64_t o = output_count - 1; o >= 0; --o) {
+      uint64_t offset;
+      char* buffer;
+      if (!Succeeded(
+              shm->Allocate(kResponseLoopTensorByteSize, &offset, &buffer),
+              &error)) {
+        state.SkipWithError(error.c_str());
+        return;
+      }
+      memset(buffer, 'x', kResponseLoopTensorByteSize);
+      Tensor* tensor = response->add_outputs();
+      tensor->set_name("OUTPUT" + std::to_string(o));
+      tensor->set_dtype(TRITONSERVER_TYPE_FP32);
+      tensor->add_dims(element_count);
+      tensor->set_offset(offset);
+      tensor->set_byte_size(kResponseLoopTensorByteSize);
+    }
+  }
+
+  // Destination of the outputs, standing in for the output buffers of the
+  // responses of the server.
+  std::vector<std::vector<char>> outputs(
+      output_count, std::vector<char>(kResponseLoopTensorByteSize));
+
+  // The index is kept by the execution slot in the backend, so it has
+  // already grown to the number of outputs when the responses arrive.
+  OutputIndex output_index;
+  const auto process = [&]() {
+    return copy_messages
+               ? ProcessResponsesByCopy(
+                     execute_request, execute_response, shm.get(), &outputs,
+                     &error)
+               : ProcessResponses(
+                     execute_request, execute_response, shm.get(),
+                     &output_index, &outputs, &error);
+  };
+  if (!process()) {
+    state.SkipWithError(error.c_str());
+    return;
+  }
+
+  std::vector<double> latencies;
+  uint64_t allocations = 0;
+  for (auto _ : state) {
+    const uint64_t allocations_before = allocation_count;
+    const auto start = std::chrono::steady_clock::now();
+    const bool processed = process();
+    const std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    allocations += allocation_count - allocations_before;
+    if (!processed) {
+      state.SkipWithError(error.c_str());
+      break;
+    }
+    latencies.push_back(elapsed.count());
+  }
+
+  if (latencies.empty()) {
+    return;
+  }
+
+  ReportLatencies(&latencies, state);
+  state.counters["allocs_per_request"] =
+      static_cast<double>(allocations) / (state.iterations() * request_count);
+  state.SetItemsProcessed(state.iterations() * request_count);
+}
+
+BENCHMARK(BM_ResponseLoop)
+    ->Apply(ResponseLoopArguments)
+    ->Unit(benchmark::kMicrosecond);
+
+}  // namespace
+
+}}}  // namespace triton::backend::python
+
+int
+main(int argc, char** argv)
+{
+  namespace python = triton::backend::python;
+
+  benchmark::Initialize(&argc, argv);
+  if (benchmark::ReportUnrecognizedArguments(argc, argv)) {
+    return 1;
+  }
+
+  benchmark::RunSpecifiedBenchmarks();
+  python::interpreter.reset();
+  return 0;
+}
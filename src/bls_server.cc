@@ -0,0 +1,433 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "bls_server.h"
+
+#include <grpcpp/security/server_credentials.h>
+#include <grpcpp/server_builder.h>
+#include <unistd.h>
+#include <cerrno>
+#include <condition_variable>
+#include <cstring>
+#include <vector>
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// State of a request that is running in Triton, shared with its callbacks
+struct InferCall {
+  std::mutex mu;
+  std::condition_variable cv;
+  TRITONSERVER_InferenceResponse* response = nullptr;
+  bool complete = false;
+  bool released = false;
+
+  // The outputs are staged in buffers of the pool, which are given back
+  // once they are copied to the region
+  BufferPool* buffer_pool = nullptr;
+  std::vector<BackendMemory*> buffers;
+};
+
+TRITONSERVER_Error*
+ResponseAlloc(
+    TRITONSERVER_ResponseAllocator* allocator, const char* tensor_name,
+    size_t byte_size, TRITONSERVER_MemoryType memory_type,
+    int64_t memory_type_id, void* userp, void** buffer, void** buffer_userp,
+    TRITONSERVER_MemoryType* actual_memory_type,
+    int64_t* actual_memory_type_id)
+{
+  // The outputs are copied to the shared memory region once the request is
+  // complete. Allocating them in the region could remap it while Triton is
+  // still reading the inputs from it.
+  *buffer = nullptr;
+  *buffer_userp = nullptr;
+  *actual_memory_type = TRITONSERVER_MEMORY_CPU;
+  *actual_memory_type_id = 0;
+  if (byte_size == 0) {
+    return nullptr;
+  }
+
+  InferCall* call = reinterpret_cast<InferCall*>(userp);
+  BackendMemory* memory;
+  RETURN_IF_ERROR(call->buffer_pool->Acquire(byte_size, &memory));
+  {
+    std::lock_guard<std::mutex> lk(call->mu);
+    call->buffers.push_back(memory);
+  }
+  *buffer = memory->MemoryPtr();
+  *actual_memory_type = memory->MemoryType();
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ResponseRelease(
+    TRITONSERVER_ResponseAllocator* allocator, void* buffer, void* buffer_userp,
+    size_t byte_size, TRITONSERVER_MemoryType memory_type,
+    int64_t memory_type_id)
+{
+  // The buffers are given back to the pool by BlsServer::Run
+  return nullptr;
+}
+
+void
+RequestRelease(
+    TRITONSERVER_InferenceRequest* request, const uint32_t flags, void* userp)
+{
+  if ((flags & TRITONSERVER_REQUEST_RELEASE_ALL) == 0) {
+    return;
+  }
+
+  LOG_IF_ERROR(
+      TRITONSERVER_InferenceRequestDelete(request),
+      "failed to delete an inference request of a Python model");
+  InferCall* call = reinterpret_cast<InferCall*>(userp);
+  std::lock_guard<std::mutex> lk(call->mu);
+  call->released = true;
+  call->cv.notify_all();
+}
+
+void
+ResponseComplete(
+    TRITONSERVER_InferenceResponse* response, const uint32_t flags, void* userp)
+{
+  InferCall* call = reinterpret_cast<InferCall*>(userp);
+  std::lock_guard<std::mutex> lk(call->mu);
+  if (response != nullptr) {
+    // Only the first response is returned, the requests sent to decoupled
+    // models get no more than one response.
+    if (call->response == nullptr) {
+      call->response = response;
+    } else {
+      LOG_IF_ERROR(
+          TRITONSERVER_InferenceResponseDelete(response),
+          "failed to delete an inference response");
+    }
+  }
+  if ((flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0) {
+    call->complete = true;
+    call->cv.notify_all();
+  }
+}
+
+// Add the inputs of 'message', which are located in 'shm', and the outputs
+// that it requests to 'request'.
+TRITONSERVER_Error*
+BuildRequest(
+    SharedMemory* shm, const InferenceRequest& message,
+    TRITONSERVER_InferenceRequest* request)
+{
+  if (!message.id().empty()) {
+    RETURN_IF_ERROR(
+        TRITONSERVER_InferenceRequestSetId(request, message.id().c_str()));
+  }
+  if (message.correlation_id() != 0) {
+    RETURN_IF_ERROR(TRITONSERVER_InferenceRequestSetCorrelationId(
+        request, message.correlation_id()));
+  }
+  if (message.timeout_us() != 0) {
+    RETURN_IF_ERROR(TRITONSERVER_InferenceRequestSetTimeoutMicroseconds(
+        request, message.timeout_us()));
+  }
+
+  // The buffers stay valid until the region is reset for the next
+  // execution, even if the region is remapped while the request runs, e.g.
+  // to read a response of a decoupled model.
+  for (const Tensor& input : message.inputs()) {
+    if (input.memory_type() != TRITONSERVER_MEMORY_CPU) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNSUPPORTED,
+          (std::string("input '") + input.name() +
+           "' must be in CPU memory")
+              .c_str());
+    }
+
+    char* buffer;
+    RETURN_IF_ERROR(shm->Buffer(input.offset(), input.byte_size(), &buffer));
+    RETURN_IF_ERROR(TRITONSERVER_InferenceRequestAddInput(
+        request, input.name().c_str(),
+        static_cast<TRITONSERVER_DataType>(input.dtype()),
+        input.dims().data(), input.dims_size()));
+    RETURN_IF_ERROR(TRITONSERVER_InferenceRequestAppendInputData(
+        request, input.name().c_str(), buffer, input.byte_size(),
+        TRITONSERVER_MEMORY_CPU, 0));
+  }
+
+  for (const std::string& output_name : message.requested_output_names()) {
+    RETURN_IF_ERROR(TRITONSERVER_InferenceRequestAddRequestedOutput(
+        request, output_name.c_str()));
+  }
+
+  return nullptr;
+}
+
+// Copy the outputs of 'response' to 'shm' and add them to 'message'.
+TRITONSERVER_Error*
+WriteOutputs(
+    TRITONSERVER_InferenceResponse* response, SharedMemory* shm,
+    InferenceResponse* message)
+{
+  uint32_t output_count;
+  RETURN_IF_ERROR(
+      TRITONSERVER_InferenceResponseOutputCount(response, &output_count));
+  for (uint32_t i = 0; i < output_count; ++i) {
+    const char* name;
+    TRITONSERVER_DataType datatype;
+    const int64_t* shape;
+    uint64_t dim_count;
+    const void* base;
+    size_t byte_size;
+    TRITONSERVER_MemoryType memory_type;
+    int64_t memory_type_id;
+    void* userp;
+    RETURN_IF_ERROR(TRITONSERVER_InferenceResponseOutput(
+        response, i, &name, &datatype, &shape, &dim_count, &base, &byte_size,
+        &memory_type, &memory_type_id, &userp));
+
+    uint64_t offset;
+    char* buffer;
+    RETURN_IF_ERROR(shm->Allocate(byte_size, &offset, &buffer));
+    if (byte_size != 0) {
+      memcpy(buffer, base, byte_size);
+    }
+
+    Tensor* output = message->add_outputs();
+    output->set_name(name);
+    output->set_dtype(static_cast<int>(datatype));
+    for (uint64_t d = 0; d < dim_count; ++d) {
+      output->add_dims(shape[d]);
+    }
+    output->set_offset(offset);
+    output->set_byte_size(byte_size);
+    output->set_memory_type(TRITONSERVER_MEMORY_CPU);
+    output->set_memory_type_id(0);
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
+BlsServer::BlsServer(TRITONSERVER_Server* server)
+    : server_(server), allocator_(nullptr)
+{
+}
+
+TRITONSERVER_Error*
+BlsServer::Create(
+    TRITONSERVER_Server* server, std::unique_ptr<BlsServer>* bls_server)
+{
+  std::unique_ptr<BlsServer> bls(new BlsServer(server));
+  RETURN_IF_ERROR(TRITONSERVER_ResponseAllocatorNew(
+      &bls->allocator_, ResponseAlloc, ResponseRelease, nullptr));
+
+  char tmp_dir_name[] = "/tmp/XXXXXX";
+  if (mkdtemp(tmp_dir_name) == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed to create the socket directory of the BLS "
+                     "server: ") +
+         strerror(errno))
+            .c_str());
+  }
+  bls->tmp_dir_ = tmp_dir_name;
+  bls->address_ = std::string("unix://") + tmp_dir_name + "/bls.socket";
+
+  grpc::ServerBuilder builder;
+  builder.AddListeningPort(bls->address_, grpc::InsecureServerCredentials());
+  builder.RegisterService(bls.get());
+  bls->grpc_server_ = builder.BuildAndStart();
+  if (bls->grpc_server_ == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed to start the BLS server on '") + bls->address_ +
+         "'")
+            .c_str());
+  }
+
+  *bls_server = std::move(bls);
+  return nullptr;
+}
+
+BlsServer::~BlsServer()
+{
+  // Waits for the requests that are running
+  if (grpc_server_ != nullptr) {
+    grpc_server_->Shutdown();
+  }
+
+  if (!tmp_dir_.empty()) {
+    unlink(address_.substr(strlen("unix://")).c_str());
+    rmdir(tmp_dir_.c_str());
+  }
+
+  if (allocator_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_ResponseAllocatorDelete(allocator_),
+        "failed to delete the response allocator of the BLS server");
+  }
+}
+
+void
+BlsServer::RegisterRegion(SharedMemory* shm, BufferPool* buffer_pool)
+{
+  std::shared_ptr<Region> region = std::make_shared<Region>();
+  region->shm = shm;
+  region->buffer_pool = buffer_pool;
+
+  std::lock_guard<std::mutex> lk(mu_);
+  regions_[shm->Name()] = region;
+}
+
+void
+BlsServer::UnregisterRegion(SharedMemory* shm)
+{
+  std::shared_ptr<Region> region;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = regions_.find(shm->Name());
+    if ((it == regions_.end()) || (it->second->shm != shm)) {
+      return;
+    }
+    region = it->second;
+    regions_.erase(it);
+  }
+
+  std::lock_guard<std::mutex> lk(region->mu);
+  region->shm = nullptr;
+}
+
+grpc::Status
+BlsServer::Infer(
+    grpc::ServerContext* context, const ModelInferRequest* request,
+    InferenceResponse* response)
+{
+  std::shared_ptr<Region> region;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = regions_.find(request->shm_region_name());
+    if (it != regions_.end()) {
+      region = it->second;
+    }
+  }
+
+  std::unique_lock<std::mutex> region_lk;
+  if (region != nullptr) {
+    region_lk = std::unique_lock<std::mutex>(region->mu);
+  }
+
+  TRITONSERVER_Error* err;
+  if ((region == nullptr) || (region->shm == nullptr)) {
+    err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("unknown shared memory region '") +
+         request->shm_region_name() + "'")
+            .c_str());
+  } else {
+    err = Run(region.get(), *request, response);
+  }
+
+  // Errors are returned in the response, the status is only used for
+  // transport errors.
+  if (err != nullptr) {
+    response->Clear();
+    response->set_failed(true);
+    response->mutable_error()->set_message(TRITONSERVER_ErrorMessage(err));
+    TRITONSERVER_ErrorDelete(err);
+  }
+  return grpc::Status::OK;
+}
+
+TRITONSERVER_Error*
+BlsServer::Run(
+    Region* region, const ModelInferRequest& request,
+    InferenceResponse* response)
+{
+  SharedMemory* shm = region->shm;
+  TRITONSERVER_InferenceRequest* irequest;
+  RETURN_IF_ERROR(TRITONSERVER_InferenceRequestNew(
+      &irequest, server_, request.model_name().c_str(),
+      request.model_version()));
+
+  // The request is deleted by RequestRelease once Triton owns it
+  InferCall call;
+  call.buffer_pool = region->buffer_pool;
+  TRITONSERVER_Error* err = BuildRequest(shm, request.request(), irequest);
+  if (err == nullptr) {
+    err = TRITONSERVER_InferenceRequestSetReleaseCallback(
+        irequest, RequestRelease, &call);
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_InferenceRequestSetResponseCallback(
+        irequest, allocator_, &call, ResponseComplete, &call);
+  }
+  if (err == nullptr) {
+    err = TRITONSERVER_ServerInferAsync(server_, irequest, nullptr);
+  }
+  if (err != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_InferenceRequestDelete(irequest),
+        "failed to delete an inference request of a Python model");
+    return err;
+  }
+
+  {
+    std::unique_lock<std::mutex> lk(call.mu);
+    call.cv.wait(lk, [&call] { return call.complete && call.released; });
+  }
+
+  if (call.response == nullptr) {
+    err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("model '") + request.model_name() +
+         "' completed the request without a response")
+            .c_str());
+  } else {
+    // The error belongs to the response
+    TRITONSERVER_Error* response_err =
+        TRITONSERVER_InferenceResponseError(call.response);
+    if (response_err != nullptr) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ErrorCode(response_err),
+          TRITONSERVER_ErrorMessage(response_err));
+    } else {
+      err = WriteOutputs(call.response, shm, response);
+    }
+    LOG_IF_ERROR(
+        TRITONSERVER_InferenceResponseDelete(call.response),
+        "failed to delete an inference response");
+  }
+
+  for (BackendMemory* buffer : call.buffers) {
+    call.buffer_pool->Release(buffer);
+  }
+  return err;
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,101 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <grpcpp/server.h>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+#include "buffer_pool.h"
+#include "python_host.grpc.pb.h"
+#include "shm_manager.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// Serves the inference requests that the Python models send to the other
+// models loaded in Triton. The interpreters connect to a gRPC server on a
+// domain socket that is shared by all the models of the backend, and every
+// request is run with the in-process API of 'server'. The tensors stay in
+// the shared memory region of the execution that sends the request: the
+// inputs are passed to Triton without a copy and the outputs are written to
+// the region once the request is complete. Only the regions that are
+// registered can be used. The outputs are staged in the buffer pool of the
+// instance that owns the region.
+class BlsServer : public PythonInterpreter::Service {
+ public:
+  static TRITONSERVER_Error* Create(
+      TRITONSERVER_Server* server, std::unique_ptr<BlsServer>* bls_server);
+
+  ~BlsServer();
+
+  // Address of the server, passed to the interpreters as their --bls-socket
+  const std::string& Address() const { return address_; }
+
+  // Make the shared memory region 'shm' available to the requests until it
+  // is unregistered, their outputs are staged in 'buffer_pool'.
+  // Unregistering a region waits for the request that uses it, if any.
+  void RegisterRegion(SharedMemory* shm, BufferPool* buffer_pool);
+  void UnregisterRegion(SharedMemory* shm);
+
+  grpc::Status Infer(
+      grpc::ServerContext* context, const ModelInferRequest* request,
+      InferenceResponse* response) override;
+
+ private:
+  // A registered region. The requests that use the same region are run one
+  // at a time since their outputs are allocated from the region.
+  struct Region {
+    std::mutex mu;
+    SharedMemory* shm;
+    BufferPool* buffer_pool;
+  };
+
+  BlsServer(TRITONSERVER_Server* server);
+
+  // Run 'request' with its tensors in the region and fill 'response' with
+  // its outputs.
+  TRITONSERVER_Error* Run(
+      Region* region, const ModelInferRequest& request,
+      InferenceResponse* response);
+
+  TRITONSERVER_Server* server_;
+  TRITONSERVER_ResponseAllocator* allocator_;
+
+  // Temporary directory that contains the domain socket
+  std::string tmp_dir_;
+  std::string address_;
+  std::unique_ptr<grpc::Server> grpc_server_;
+
+  std::mutex mu_;
+  std::unordered_map<std::string, std::shared_ptr<Region>> regions_;
+};
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,154 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "buffer_pool.h"
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Smallest size class, smaller buffers aren't worth keeping apart
+constexpr size_t kMinClassByteSize = 4096;
+
+size_t
+SizeClass(const size_t byte_size)
+{
+  size_t class_byte_size = kMinClassByteSize;
+  while (class_byte_size < byte_size) {
+    class_byte_size <<= 1;
+  }
+  return class_byte_size;
+}
+
+}  // namespace
+
+BufferPool::BufferPool(
+    TRITONBACKEND_MemoryManager* manager,
+    const std::vector<BackendMemory::AllocationType>& alloc_types,
+    const size_t max_byte_size)
+    : manager_(manager), alloc_types_(alloc_types),
+      max_byte_size_(max_byte_size), byte_size_(0), hit_metric_(nullptr),
+      miss_metric_(nullptr), byte_size_metric_(nullptr)
+{
+}
+
+TRITONSERVER_Error*
+BufferPool::Create(
+    TRITONBACKEND_MemoryManager* manager,
+    const std::vector<BackendMemory::AllocationType>& alloc_types,
+    const size_t max_byte_size, std::unique_ptr<BufferPool>* pool)
+{
+  if (alloc_types.empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "a buffer pool needs at least one allocation type");
+  }
+
+  pool->reset(new BufferPool(manager, alloc_types, max_byte_size));
+  return nullptr;
+}
+
+BufferPool::~BufferPool()
+{
+  for (auto& size_class : free_buffers_) {
+    for (BackendMemory* buffer : size_class.second) {
+      delete buffer;
+    }
+  }
+}
+
+TRITONSERVER_Error*
+BufferPool::Acquire(const size_t byte_size, BackendMemory** buffer)
+{
+  const size_t class_byte_size = SizeClass(byte_size);
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = free_buffers_.find(class_byte_size);
+    if ((it != free_buffers_.end()) && !it->second.empty()) {
+      *buffer = it->second.back();
+      it->second.pop_back();
+      byte_size_ -= class_byte_size;
+      if (hit_metric_ != nullptr) {
+        LOG_IF_ERROR(
+            TRITONSERVER_MetricIncrement(hit_metric_, 1),
+            "failed to increment the buffer pool hit metric");
+      }
+      if (byte_size_metric_ != nullptr) {
+        LOG_IF_ERROR(
+            TRITONSERVER_MetricSet(byte_size_metric_, byte_size_),
+            "failed to set the buffer pool size metric");
+      }
+      return nullptr;
+    }
+  }
+
+  if (miss_metric_ != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricIncrement(miss_metric_, 1),
+        "failed to increment the buffer pool miss metric");
+  }
+  return BackendMemory::Create(
+      manager_, alloc_types_, 0 /* memory_type_id */, class_byte_size,
+      buffer);
+}
+
+void
+BufferPool::Release(BackendMemory* buffer)
+{
+  // A buffer from Acquire has the size of its class
+  const size_t class_byte_size = buffer->ByteSize();
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (byte_size_ + class_byte_size <= max_byte_size_) {
+      free_buffers_[class_byte_size].push_back(buffer);
+      byte_size_ += class_byte_size;
+      if (byte_size_metric_ != nullptr) {
+        LOG_IF_ERROR(
+            TRITONSERVER_MetricSet(byte_size_metric_, byte_size_),
+            "failed to set the buffer pool size metric");
+      }
+      return;
+    }
+  }
+
+  delete buffer;
+}
+
+void
+BufferPool::SetMetrics(
+    TRITONSERVER_Metric* hit, TRITONSERVER_Metric* miss,
+    TRITONSERVER_Metric* byte_size)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  hit_metric_ = hit;
+  miss_metric_ = miss;
+  byte_size_metric_ = byte_size;
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,93 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "triton/backend/backend_memory.h"
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// A pool of the staging buffers of a model instance, allocated with
+// BackendMemory. Buffers are rounded up to a power-of-two size class and a
+// released buffer is kept for the next buffer of its class, so fixed-shape
+// traffic stops allocating once the pool is warm. Up to 'max_byte_size'
+// bytes are kept, the buffers that don't fit are freed. The allocation
+// types are tried in order, e.g. pinned memory first with a fallback to
+// pageable memory.
+class BufferPool {
+ public:
+  static TRITONSERVER_Error* Create(
+      TRITONBACKEND_MemoryManager* manager,
+      const std::vector<BackendMemory::AllocationType>& alloc_types,
+      const size_t max_byte_size, std::unique_ptr<BufferPool>* pool);
+
+  ~BufferPool();
+
+  // Get a buffer of at least 'byte_size' bytes.
+  TRITONSERVER_Error* Acquire(const size_t byte_size, BackendMemory** buffer);
+
+  // Give back a buffer returned by Acquire.
+  void Release(BackendMemory* buffer);
+
+  // Report the acquisitions that reuse a buffer and those that allocate one
+  // to the 'hit' and 'miss' counters, and the number of bytes kept by the
+  // pool to the 'byte_size' gauge. The metrics must outlive the pool.
+  void SetMetrics(
+      TRITONSERVER_Metric* hit, TRITONSERVER_Metric* miss,
+      TRITONSERVER_Metric* byte_size);
+
+ private:
+  BufferPool(
+      TRITONBACKEND_MemoryManager* manager,
+      const std::vector<BackendMemory::AllocationType>& alloc_types,
+      const size_t max_byte_size);
+
+  TRITONBACKEND_MemoryManager* manager_;
+  const std::vector<BackendMemory::AllocationType> alloc_types_;
+  const size_t max_byte_size_;
+
+  std::mutex mu_;
+  size_t byte_size_;
+
+  // Free buffers by size class
+  std::unordered_map<size_t, std::vector<BackendMemory*>> free_buffers_;
+
+  TRITONSERVER_Metric* hit_metric_;
+  TRITONSERVER_Metric* miss_metric_;
+  TRITONSERVER_Metric* byte_size_metric_;
+};
+
+}}}  // namespace triton::backend::python
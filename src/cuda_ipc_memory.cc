@@ -0,0 +1,129 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "cuda_ipc_memory.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Same alignment as the tensors in the shared memory region, it is also
+// sufficient for every datatype the device kernels may load.
+constexpr uint64_t kAlignment = 256;
+
+TRITONSERVER_Error*
+CudaError(const std::string& msg, const cudaError_t err)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL,
+      (msg + ": " + std::string(cudaGetErrorString(err))).c_str());
+}
+
+}  // namespace
+
+CudaIpcMemory::CudaIpcMemory(const int device_id, const size_t byte_size)
+    : device_id_(device_id), byte_size_(byte_size), base_(nullptr), used_(0)
+{
+}
+
+TRITONSERVER_Error*
+CudaIpcMemory::Create(
+    const int device_id, const size_t byte_size,
+    std::unique_ptr<CudaIpcMemory>* cuda_memory)
+{
+  std::unique_ptr<CudaIpcMemory> memory(
+      new CudaIpcMemory(device_id, byte_size));
+
+  int current_device;
+  cudaError_t err = cudaGetDevice(&current_device);
+  if (err != cudaSuccess) {
+    return CudaError("failed to get current CUDA device", err);
+  }
+
+  err = cudaSetDevice(device_id);
+  if (err != cudaSuccess) {
+    return CudaError(
+        "failed to set CUDA device to " + std::to_string(device_id), err);
+  }
+
+  void* base;
+  err = cudaMalloc(&base, byte_size);
+  if (err == cudaSuccess) {
+    memory->base_ = reinterpret_cast<char*>(base);
+    err = cudaIpcGetMemHandle(&memory->handle_, base);
+  }
+  cudaSetDevice(current_device);
+  if (err != cudaSuccess) {
+    return CudaError(
+        "failed to create CUDA IPC memory of " + std::to_string(byte_size) +
+            " bytes on device " + std::to_string(device_id),
+        err);
+  }
+
+  *cuda_memory = std::move(memory);
+  return nullptr;
+}
+
+CudaIpcMemory::~CudaIpcMemory()
+{
+  if (base_ != nullptr) {
+    cudaFree(base_);
+  }
+}
+
+TRITONSERVER_Error*
+CudaIpcMemory::Allocate(const size_t byte_size, uint64_t* offset, char** buffer)
+{
+  const uint64_t aligned_offset = (used_ + kAlignment - 1) & ~(kAlignment - 1);
+  if ((aligned_offset + byte_size) > byte_size_) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE, "CUDA IPC memory is full");
+  }
+
+  used_ = aligned_offset + byte_size;
+  *offset = aligned_offset;
+  *buffer = base_ + aligned_offset;
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+CudaIpcMemory::Buffer(
+    const uint64_t offset, const size_t byte_size, char** buffer)
+{
+  if ((offset + byte_size) > byte_size_) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("tensor at offset ") + std::to_string(offset) +
+         " with size " + std::to_string(byte_size) +
+         " is out of the bounds of the CUDA IPC memory")
+            .c_str());
+  }
+
+  *buffer = base_ + offset;
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
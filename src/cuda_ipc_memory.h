@@ -0,0 +1,83 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cuda_runtime_api.h>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// A device memory buffer that is shared with the Python interpreter of a
+// model instance through a CUDA IPC handle. Like SharedMemory, tensors are
+// placed in the buffer with a bump allocator that is reset before every
+// execution. The interpreter opens the handle once and then reads the inputs
+// and writes the outputs that live on the GPU without going through host
+// memory. The buffer has a fixed size, tensors that don't fit are exchanged
+// through the shared memory region instead.
+class CudaIpcMemory {
+ public:
+  static TRITONSERVER_Error* Create(
+      const int device_id, const size_t byte_size,
+      std::unique_ptr<CudaIpcMemory>* cuda_memory);
+
+  ~CudaIpcMemory();
+
+  // Allocate 'byte_size' bytes in the buffer. Returns an error with code
+  // TRITONSERVER_ERROR_UNAVAILABLE if there is not enough space left.
+  TRITONSERVER_Error* Allocate(
+      const size_t byte_size, uint64_t* offset, char** buffer);
+
+  // Get a device pointer to 'byte_size' bytes located at 'offset'.
+  TRITONSERVER_Error* Buffer(
+      const uint64_t offset, const size_t byte_size, char** buffer);
+
+  // Release all the allocations.
+  void Reset() { used_ = 0; }
+
+  const cudaIpcMemHandle_t& Handle() const { return handle_; }
+  int DeviceId() const { return device_id_; }
+  size_t ByteSize() const { return byte_size_; }
+
+  // Offset of the first unallocated byte. The interpreter allocates its
+  // outputs after this offset.
+  uint64_t Used() const { return used_; }
+
+ private:
+  CudaIpcMemory(const int device_id, const size_t byte_size);
+
+  int device_id_;
+  size_t byte_size_;
+  char* base_;
+  uint64_t used_;
+  cudaIpcMemHandle_t handle_;
+};
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,507 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+// Python.h must be included before the standard headers
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include "embedded_interpreter.h"
+
+#include <dlfcn.h>
+#include <mutex>
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#endif  // TRITON_ENABLE_GPU
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// The interpreter is started once and never finalized, the extension modules
+// that the models import can't be unloaded safely.
+std::once_flag interpreter_once;
+std::string interpreter_error;
+
+// Holds the GIL for the lifetime of the object.
+class GilLock {
+ public:
+  GilLock() : state_(PyGILState_Ensure()) {}
+  ~GilLock() { PyGILState_Release(state_); }
+
+ private:
+  PyGILState_STATE state_;
+};
+
+// Get the traceback of the current Python exception and clear it.
+std::string
+PythonErrorMessage()
+{
+  PyObject* type = nullptr;
+  PyObject* value = nullptr;
+  PyObject* traceback = nullptr;
+  PyErr_Fetch(&type, &value, &traceback);
+  if (type == nullptr) {
+    return "unknown Python error";
+  }
+  PyErr_NormalizeException(&type, &value, &traceback);
+
+  std::string message;
+  PyObject* traceback_module = PyImport_ImportModule("traceback");
+  if (traceback_module != nullptr) {
+    PyObject* lines = PyObject_CallMethod(
+        traceback_module, "format_exception", "OOO", type,
+        (value != nullptr) ? value : Py_None,
+        (traceback != nullptr) ? traceback : Py_None);
+    if (lines != nullptr) {
+      for (Py_ssize_t i = 0; i < PyList_Size(lines); ++i) {
+        const char* line = PyUnicode_AsUTF8(PyList_GetItem(lines, i));
+        if (line != nullptr) {
+          message += line;
+        }
+      }
+      Py_DECREF(lines);
+    }
+    Py_DECREF(traceback_module);
+  }
+
+  if (message.empty() && (value != nullptr)) {
+    PyObject* str = PyObject_Str(value);
+    if ((str != nullptr) && (PyUnicode_AsUTF8(str) != nullptr)) {
+      message = PyUnicode_AsUTF8(str);
+    }
+    Py_XDECREF(str);
+  }
+
+  PyErr_Clear();
+  Py_XDECREF(type);
+  Py_XDECREF(value);
+  Py_XDECREF(traceback);
+  return message.empty() ? "unknown Python error" : message;
+}
+
+TRITONSERVER_Error*
+PythonError(const std::string& msg)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL, (msg + ": " + PythonErrorMessage()).c_str());
+}
+
+void
+StartInterpreter(const std::string& python_lib)
+{
+#ifdef TRITON_PYTHON_LIBRARY
+  // Triton loads the backend with RTLD_LOCAL, the symbols of libpython must
+  // be global for the extension modules like numpy to find them.
+  if (dlopen(TRITON_PYTHON_LIBRARY, RTLD_NOW | RTLD_GLOBAL) == nullptr) {
+    interpreter_error = std::string("failed to load ") +
+                        TRITON_PYTHON_LIBRARY + ": " + dlerror();
+    return;
+  }
+#endif  // TRITON_PYTHON_LIBRARY
+
+  // The signals of the process are handled by Triton
+  Py_InitializeEx(0);
+#if PY_VERSION_HEX < 0x03070000
+  PyEval_InitThreads();
+#endif
+
+  // embedded.py and the modules that it imports are installed with the
+  // backend
+  PyObject* sys_path = PySys_GetObject("path");
+  PyObject* lib = PyUnicode_FromString(python_lib.c_str());
+  if ((sys_path == nullptr) || (lib == nullptr) ||
+      (PyList_Insert(sys_path, 0, lib) != 0)) {
+    interpreter_error = "failed to add '" + python_lib +
+                        "' to the Python path: " + PythonErrorMessage();
+  }
+  Py_XDECREF(lib);
+
+  // Every call into the interpreter takes the GIL
+  PyEval_SaveThread();
+}
+
+void
+SynchronizeStream(cudaStream_t stream, const bool cuda_copy)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (cuda_copy) {
+    cudaStreamSynchronize(stream);
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+}  // namespace
+
+EmbeddedModel::EmbeddedModel(PyObject* model, BufferPool* buffer_pool)
+    : model_(model), buffer_pool_(buffer_pool)
+{
+}
+
+TRITONSERVER_Error*
+EmbeddedModel::Create(
+    const std::string& python_lib, const std::string& model_path,
+    const InitializationCommand& init, BufferPool* buffer_pool,
+    std::unique_ptr<EmbeddedModel>* model)
+{
+  std::call_once(interpreter_once, StartInterpreter, python_lib);
+  if (!interpreter_error.empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        ("failed to start the embedded Python interpreter: " +
+         interpreter_error)
+            .c_str());
+  }
+
+  GilLock gil;
+  PyObject* args = PyDict_New();
+  if (args == nullptr) {
+    return PythonError("failed to create the arguments of 'initialize'");
+  }
+  for (const auto& arg : init.args()) {
+    PyObject* value =
+        PyUnicode_FromStringAndSize(arg.value().data(), arg.value().size());
+    if ((value == nullptr) ||
+        (PyDict_SetItemString(args, arg.key().c_str(), value) != 0)) {
+      Py_XDECREF(value);
+      Py_DECREF(args);
+      return PythonError("failed to create the arguments of 'initialize'");
+    }
+    Py_DECREF(value);
+  }
+
+  PyObject* py_model = nullptr;
+  PyObject* embedded_module = PyImport_ImportModule("embedded");
+  if (embedded_module != nullptr) {
+    py_model = PyObject_CallMethod(
+        embedded_module, "EmbeddedModel", "sO", model_path.c_str(), args);
+    Py_DECREF(embedded_module);
+  }
+  Py_DECREF(args);
+  if (py_model == nullptr) {
+    return PythonError(
+        "failed to initialize the Python model '" + model_path + "'");
+  }
+
+  model->reset(new EmbeddedModel(py_model, buffer_pool));
+  return nullptr;
+}
+
+EmbeddedModel::~EmbeddedModel()
+{
+  GilLock gil;
+  PyObject* result = PyObject_CallMethod(model_, "finalize", nullptr);
+  if (result == nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_ERROR,
+        ("failed to finalize the Python model: " + PythonErrorMessage())
+            .c_str());
+  }
+  Py_XDECREF(result);
+  Py_DECREF(model_);
+}
+
+void
+EmbeddedModel::ReleaseInputCopies()
+{
+  for (BackendMemory* input_copy : input_copies_) {
+    buffer_pool_->Release(input_copy);
+  }
+  input_copies_.clear();
+}
+
+TRITONSERVER_Error*
+EmbeddedModel::Execute(
+    const std::vector<TRITONBACKEND_Request*>& requests,
+    const std::vector<EmbeddedRequestInfo>& request_infos,
+    std::vector<TRITONBACKEND_Response*>* responses, cudaStream_t stream,
+    std::vector<CachedResponse>* cached_responses, ExecuteTimings* timings)
+{
+  GilLock gil;
+
+  uint64_t input_start_ns = 0;
+  SET_TIMESTAMP(input_start_ns);
+
+  PyObject* py_requests = PyList_New(requests.size());
+  if (py_requests == nullptr) {
+    return PythonError("failed to create the requests");
+  }
+  bool cuda_copy = false;
+  TRITONSERVER_Error* err = BuildRequests(
+      requests, request_infos, stream, py_requests, &cuda_copy);
+  SynchronizeStream(stream, cuda_copy);
+  if (err != nullptr) {
+    Py_DECREF(py_requests);
+    ReleaseInputCopies();
+    return err;
+  }
+
+  uint64_t compute_start_ns = 0;
+  SET_TIMESTAMP(compute_start_ns);
+  PyObject* py_responses =
+      PyObject_CallMethod(model_, "execute", "O", py_requests);
+  Py_DECREF(py_requests);
+  uint64_t output_start_ns = 0;
+  SET_TIMESTAMP(output_start_ns);
+  if (py_responses == nullptr) {
+    ReleaseInputCopies();
+    return PythonError("failed to execute the Python model");
+  }
+
+  if (cached_responses != nullptr) {
+    cached_responses->clear();
+    cached_responses->resize(requests.size());
+  }
+
+  cuda_copy = false;
+  for (size_t r = 0; r < requests.size(); ++r) {
+    TRITONBACKEND_Response* response = (*responses)[r];
+    if (response == nullptr) {
+      continue;
+    }
+
+    // The model returns the error message of a failed response
+    PyObject* py_outputs = PyList_GetItem(py_responses, r);
+    TRITONSERVER_Error* response_err = nullptr;
+    if (PyUnicode_Check(py_outputs)) {
+      const char* message = PyUnicode_AsUTF8(py_outputs);
+      response_err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (message != nullptr) ? message : "failed to read the error message");
+      PyErr_Clear();
+    } else {
+      response_err = WriteResponse(
+          py_outputs, response, stream,
+          (cached_responses != nullptr) ? &(*cached_responses)[r] : nullptr,
+          &cuda_copy);
+    }
+
+    if (response_err != nullptr) {
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, response_err),
+          "failed sending response");
+      TRITONSERVER_ErrorDelete(response_err);
+      (*responses)[r] = nullptr;
+    }
+  }
+
+  // The arrays of the model are read by the copies until they complete
+  SynchronizeStream(stream, cuda_copy);
+  Py_DECREF(py_responses);
+  ReleaseInputCopies();
+
+  uint64_t output_end_ns = 0;
+  SET_TIMESTAMP(output_end_ns);
+  timings->set_input_ns(compute_start_ns - input_start_ns);
+  timings->set_compute_ns(output_start_ns - compute_start_ns);
+  timings->set_output_ns(output_end_ns - output_start_ns);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+EmbeddedModel::BuildRequests(
+    const std::vector<TRITONBACKEND_Request*>& requests,
+    const std::vector<EmbeddedRequestInfo>& request_infos,
+    cudaStream_t stream, PyObject* py_requests, bool* cuda_copy)
+{
+  for (size_t r = 0; r < requests.size(); ++r) {
+    TRITONBACKEND_Request* request = requests[r];
+
+    const char* id;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestId(request, &id));
+    uint64_t correlation_id;
+    RETURN_IF_ERROR(
+        TRITONBACKEND_RequestCorrelationId(request, &correlation_id));
+    uint32_t input_count;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestInputCount(request, &input_count));
+    uint32_t output_count;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestOutputCount(request, &output_count));
+
+    // The lists are filled once they are owned by 'py_requests', so that
+    // they are released with it on error
+    PyObject* py_inputs = PyList_New(input_count);
+    PyObject* py_output_names = PyList_New(output_count);
+    PyObject* py_request = Py_BuildValue(
+        "(sKNNIK)", id, static_cast<unsigned long long>(correlation_id),
+        py_inputs, py_output_names,
+        static_cast<unsigned int>(request_infos[r].sequence_flags),
+        static_cast<unsigned long long>(request_infos[r].timeout_us));
+    if (py_request == nullptr) {
+      return PythonError("failed to create a request");
+    }
+    PyList_SET_ITEM(py_requests, r, py_request);
+
+    for (uint32_t i = 0; i < output_count; ++i) {
+      const char* output_name;
+      RETURN_IF_ERROR(
+          TRITONBACKEND_RequestOutputName(request, i, &output_name));
+      PyObject* py_output_name = PyUnicode_FromString(output_name);
+      if (py_output_name == nullptr) {
+        return PythonError("failed to create a requested output name");
+      }
+      PyList_SET_ITEM(py_output_names, i, py_output_name);
+    }
+
+    for (uint32_t i = 0; i < input_count; ++i) {
+      const char* input_name;
+      RETURN_IF_ERROR(TRITONBACKEND_RequestInputName(request, i, &input_name));
+      TRITONBACKEND_Input* input;
+      RETURN_IF_ERROR(TRITONBACKEND_RequestInput(request, input_name, &input));
+
+      TRITONSERVER_DataType dtype;
+      const int64_t* shape;
+      uint32_t dims_count;
+      uint64_t byte_size;
+      uint32_t buffer_count;
+      RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+          input, nullptr, &dtype, &shape, &dims_count, &byte_size,
+          &buffer_count));
+
+      // An input in a single buffer in CPU memory is passed to the model
+      // without copying it
+      const void* data = nullptr;
+      if (buffer_count == 1) {
+        const void* buffer;
+        uint64_t buffer_byte_size;
+        TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+        int64_t memory_type_id = 0;
+        RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+            input, 0, &buffer, &buffer_byte_size, &memory_type,
+            &memory_type_id));
+        if (memory_type != TRITONSERVER_MEMORY_GPU) {
+          data = buffer;
+        }
+      }
+
+      if (data == nullptr) {
+        BackendMemory* input_copy;
+        RETURN_IF_ERROR(buffer_pool_->Acquire(byte_size, &input_copy));
+        input_copies_.push_back(input_copy);
+
+        size_t offset = 0;
+        for (uint32_t b = 0; b < buffer_count; ++b) {
+          const void* buffer;
+          uint64_t buffer_byte_size;
+          TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+          int64_t memory_type_id = 0;
+          RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+              input, b, &buffer, &buffer_byte_size, &memory_type,
+              &memory_type_id));
+          bool cuda_used = false;
+          RETURN_IF_ERROR(CopyBuffer(
+              input_name, memory_type, memory_type_id,
+              input_copy->MemoryType(), 0, buffer_byte_size, buffer,
+              input_copy->MemoryPtr() + offset, stream, &cuda_used));
+          *cuda_copy |= cuda_used;
+          offset += buffer_byte_size;
+        }
+        data = input_copy->MemoryPtr();
+      }
+
+      PyObject* py_shape = PyTuple_New(dims_count);
+      if (py_shape == nullptr) {
+        return PythonError("failed to create the shape of an input");
+      }
+      for (uint32_t d = 0; d < dims_count; ++d) {
+        PyTuple_SET_ITEM(py_shape, d, PyLong_FromLongLong(shape[d]));
+      }
+      PyObject* py_data = PyMemoryView_FromMemory(
+          static_cast<char*>(const_cast<void*>(data)), byte_size, PyBUF_READ);
+      PyObject* py_input = Py_BuildValue(
+          "(siNN)", input_name, static_cast<int>(dtype), py_shape, py_data);
+      if (py_input == nullptr) {
+        return PythonError("failed to create an input");
+      }
+      PyList_SET_ITEM(py_inputs, i, py_input);
+    }
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+EmbeddedModel::WriteResponse(
+    PyObject* py_outputs, TRITONBACKEND_Response* response,
+    cudaStream_t stream, CachedResponse* cached_response, bool* cuda_copy)
+{
+  for (Py_ssize_t i = 0; i < PyList_Size(py_outputs); ++i) {
+    const char* name;
+    int dtype;
+    PyObject* py_shape;
+    PyObject* py_data;
+    if (!PyArg_ParseTuple(
+            PyList_GetItem(py_outputs, i), "siOO", &name, &dtype, &py_shape,
+            &py_data)) {
+      return PythonError("invalid output returned by the Python model");
+    }
+
+    std::vector<int64_t> shape(PyTuple_Size(py_shape));
+    for (size_t d = 0; d < shape.size(); ++d) {
+      shape[d] = PyLong_AsLongLong(PyTuple_GetItem(py_shape, d));
+    }
+
+    Py_buffer view;
+    if (PyObject_GetBuffer(py_data, &view, PyBUF_C_CONTIGUOUS) != 0) {
+      return PythonError(
+          std::string("failed to read the data of output '") + name + "'");
+    }
+
+    TRITONBACKEND_Output* output;
+    TRITONSERVER_Error* err = TRITONBACKEND_ResponseOutput(
+        response, &output, name, static_cast<TRITONSERVER_DataType>(dtype),
+        shape.data(), shape.size());
+
+    void* buffer;
+    TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t memory_type_id = 0;
+    if (err == nullptr) {
+      err = TRITONBACKEND_OutputBuffer(
+          output, &buffer, view.len, &memory_type, &memory_type_id);
+    }
+
+    bool cuda_used = false;
+    if (err == nullptr) {
+      err = CopyBuffer(
+          name, TRITONSERVER_MEMORY_CPU, 0, memory_type, memory_type_id,
+          view.len, view.buf, buffer, stream, &cuda_used);
+    }
+    *cuda_copy |= cuda_used;
+
+    if ((err == nullptr) && (cached_response != nullptr)) {
+      cached_response->push_back(CachedOutput{
+          name, static_cast<TRITONSERVER_DataType>(dtype), shape,
+          std::string(static_cast<const char*>(view.buf), view.len)});
+    }
+    PyBuffer_Release(&view);
+    RETURN_IF_ERROR(err);
+  }
+
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
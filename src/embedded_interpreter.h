@@ -0,0 +1,118 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "buffer_pool.h"
+#include "python_host.pb.h"
+#include "response_cache.h"
+#include "triton/backend/backend_common.h"
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+// Declared by Python.h, which is only included by the implementation
+typedef struct _object PyObject;
+
+namespace triton { namespace backend { namespace python {
+
+// Values of a request that the backend computes for the embedded model
+struct EmbeddedRequestInfo {
+  // SequenceFlag bits, 0 if the model doesn't use the sequence batcher
+  uint32_t sequence_flags;
+  // Time left before the request times out, 0 if it has no timeout
+  uint64_t timeout_us;
+};
+
+// A Python model run by the CPython interpreter embedded in the backend
+// process instead of by a startup.py process. The requests are passed to the
+// model without going through gRPC: the inputs in CPU memory are exposed to
+// numpy through the buffer protocol over the Triton input buffers, and the
+// outputs are copied to the Triton output buffers from the arrays returned by
+// the model. All the embedded models share one interpreter, so only one of
+// them runs Python code at a time.
+class EmbeddedModel {
+ public:
+  // Import the model at 'model_path' with embedded.py from 'python_lib' and
+  // call its 'initialize' function with the arguments of 'init'. The
+  // interpreter is started when the first model is created. The inputs that
+  // have to be gathered are copied to buffers of 'buffer_pool'.
+  static TRITONSERVER_Error* Create(
+      const std::string& python_lib, const std::string& model_path,
+      const InitializationCommand& init, BufferPool* buffer_pool,
+      std::unique_ptr<EmbeddedModel>* model);
+
+  // Calls the 'finalize' function of the model.
+  ~EmbeddedModel();
+
+  // Run the model on 'requests' and add the outputs to 'responses', which
+  // are left to the caller to send. 'request_infos' has the values of every
+  // request computed by the backend. A response is set to nullptr when an
+  // error response is sent for it instead. If 'cached_responses' is not
+  // nullptr, it receives a copy of the outputs of every response. The
+  // execution fails as a whole if the execute function of the model raises
+  // an exception.
+  TRITONSERVER_Error* Execute(
+      const std::vector<TRITONBACKEND_Request*>& requests,
+      const std::vector<EmbeddedRequestInfo>& request_infos,
+      std::vector<TRITONBACKEND_Response*>* responses, cudaStream_t stream,
+      std::vector<CachedResponse>* cached_responses, ExecuteTimings* timings);
+
+ private:
+  EmbeddedModel(PyObject* model, BufferPool* buffer_pool);
+
+  // Build the argument of EmbeddedModel.execute in embedded.py. The inputs
+  // that are not in a single buffer in CPU memory are gathered in
+  // 'input_copies_'.
+  TRITONSERVER_Error* BuildRequests(
+      const std::vector<TRITONBACKEND_Request*>& requests,
+      const std::vector<EmbeddedRequestInfo>& request_infos,
+      cudaStream_t stream,
+      PyObject* py_requests, bool* cuda_copy);
+
+  // Write the outputs returned by EmbeddedModel.execute for a request to
+  // 'response'.
+  TRITONSERVER_Error* WriteResponse(
+      PyObject* py_outputs, TRITONBACKEND_Response* response,
+      cudaStream_t stream, CachedResponse* cached_response, bool* cuda_copy);
+
+  // Give the buffers of the gathered inputs back to the pool.
+  void ReleaseInputCopies();
+
+  // The EmbeddedModel object of embedded.py
+  PyObject* model_;
+
+  // Given back to the pool at the end of every execution, so gathering an
+  // input doesn't allocate once the pool has buffers of its size
+  BufferPool* buffer_pool_;
+  std::vector<BackendMemory*> input_copies_;
+};
+
+}}}  // namespace triton::backend::python
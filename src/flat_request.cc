@@ -0,0 +1,139 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "flat_request.h"
+
+#include <cstring>
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// The Python interpreter reads the sections as packed arrays
+static_assert(sizeof(FlatRequestsHeader) == 24, "unexpected header size");
+static_assert(sizeof(FlatRequest) == 48, "unexpected request size");
+static_assert(sizeof(FlatTensor) == 48, "unexpected tensor size");
+static_assert(sizeof(FlatString) == 8, "unexpected string size");
+
+template <typename T>
+char*
+CopySection(const std::vector<T>& section, char* dst)
+{
+  const size_t byte_size = section.size() * sizeof(T);
+  if (byte_size != 0) {
+    memcpy(dst, section.data(), byte_size);
+  }
+  return dst + byte_size;
+}
+
+}  // namespace
+
+void
+FlatRequestWriter::AddString(
+    const std::string& str, uint32_t* offset, uint32_t* byte_size)
+{
+  *offset = strings_.size();
+  *byte_size = str.size();
+  strings_.append(str);
+}
+
+TRITONSERVER_Error*
+FlatRequestWriter::Write(
+    const google::protobuf::RepeatedPtrField<InferenceRequest>& requests,
+    SharedMemory* shm, uint64_t* offset, uint64_t* byte_size)
+{
+  requests_.clear();
+  tensors_.clear();
+  output_names_.clear();
+  dims_.clear();
+  strings_.clear();
+
+  for (const InferenceRequest& request : requests) {
+    requests_.emplace_back();
+    FlatRequest& flat_request = requests_.back();
+    flat_request.correlation_id = request.correlation_id();
+    flat_request.first_input = tensors_.size();
+    flat_request.input_count = request.inputs_size();
+    AddString(
+        request.id(), &flat_request.id_offset, &flat_request.id_byte_size);
+    flat_request.first_output_name = output_names_.size();
+    flat_request.output_name_count = request.requested_output_names_size();
+    flat_request.sequence_flags = request.sequence_flags();
+    flat_request.reserved = 0;
+    flat_request.timeout_us = request.timeout_us();
+
+    for (const Tensor& input : request.inputs()) {
+      tensors_.emplace_back();
+      FlatTensor& flat_tensor = tensors_.back();
+      flat_tensor.offset = input.offset();
+      flat_tensor.byte_size = input.byte_size();
+      flat_tensor.memory_type_id = input.memory_type_id();
+      flat_tensor.dtype = input.dtype();
+      flat_tensor.memory_type = input.memory_type();
+      AddString(
+          input.name(), &flat_tensor.name_offset, &flat_tensor.name_byte_size);
+      flat_tensor.first_dim = dims_.size();
+      flat_tensor.dims_count = input.dims_size();
+      dims_.insert(dims_.end(), input.dims().begin(), input.dims().end());
+    }
+
+    for (const std::string& name : request.requested_output_names()) {
+      output_names_.emplace_back();
+      AddString(
+          name, &output_names_.back().offset, &output_names_.back().byte_size);
+    }
+  }
+
+  FlatRequestsHeader header;
+  header.request_count = requests_.size();
+  header.tensor_count = tensors_.size();
+  header.output_name_count = output_names_.size();
+  header.dim_count = dims_.size();
+  header.strings_byte_size = strings_.size();
+
+  *byte_size = sizeof(header) + requests_.size() * sizeof(FlatRequest) +
+               tensors_.size() * sizeof(FlatTensor) +
+               output_names_.size() * sizeof(FlatString) +
+               dims_.size() * sizeof(int64_t) + strings_.size();
+
+  char* buffer;
+  RETURN_IF_ERROR(shm->Allocate(*byte_size, offset, &buffer));
+
+  memcpy(buffer, &header, sizeof(header));
+  buffer += sizeof(header);
+  buffer = CopySection(requests_, buffer);
+  buffer = CopySection(tensors_, buffer);
+  buffer = CopySection(output_names_, buffer);
+  buffer = CopySection(dims_, buffer);
+  memcpy(buffer, strings_.data(), strings_.size());
+
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,117 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "python_host.pb.h"
+#include "shm_manager.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+//
+// Flat layout of the requests of an execution. It is written to the shared
+// memory region of the execution in a single allocation, so that the Python
+// interpreter reads it in place instead of parsing nested protobuf messages.
+// The integers are in the byte order of the host and every section is a
+// packed array of 8-byte aligned records. The layout must match the FLAT_*
+// dtypes in startup.py.
+//
+//   FlatRequestsHeader
+//   FlatRequest[request_count]
+//   FlatTensor[tensor_count]
+//   FlatString[output_name_count]   requested output names
+//   int64_t[dim_count]              dims of the tensors
+//   char[strings_byte_size]         request ids and names, not NUL-terminated
+//
+// Indices and string offsets are relative to the start of their section.
+//
+struct FlatRequestsHeader {
+  uint32_t request_count;
+  uint32_t tensor_count;
+  uint32_t output_name_count;
+  uint32_t dim_count;
+  uint64_t strings_byte_size;
+};
+
+struct FlatRequest {
+  uint64_t correlation_id;
+  uint32_t first_input;
+  uint32_t input_count;
+  uint32_t id_offset;
+  uint32_t id_byte_size;
+  uint32_t first_output_name;
+  uint32_t output_name_count;
+  uint32_t sequence_flags;
+  uint32_t reserved;
+  uint64_t timeout_us;
+};
+
+struct FlatTensor {
+  uint64_t offset;
+  uint64_t byte_size;
+  int64_t memory_type_id;
+  int32_t dtype;
+  int32_t memory_type;
+  uint32_t name_offset;
+  uint32_t name_byte_size;
+  uint32_t first_dim;
+  uint32_t dims_count;
+};
+
+struct FlatString {
+  uint32_t offset;
+  uint32_t byte_size;
+};
+
+// Writes the flat layout of the requests of an execution. The writer keeps
+// its buffers between executions so that it doesn't allocate once they are
+// large enough.
+class FlatRequestWriter {
+ public:
+  // Write 'requests' to 'shm' and return the location of the layout.
+  TRITONSERVER_Error* Write(
+      const google::protobuf::RepeatedPtrField<InferenceRequest>& requests,
+      SharedMemory* shm, uint64_t* offset, uint64_t* byte_size);
+
+ private:
+  // Append 'str' to the strings and return its location.
+  void AddString(
+      const std::string& str, uint32_t* offset, uint32_t* byte_size);
+
+  std::vector<FlatRequest> requests_;
+  std::vector<FlatTensor> tensors_;
+  std::vector<FlatString> output_names_;
+  std::vector<int64_t> dims_;
+  std::string strings_;
+};
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,192 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "fork_server.h"
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Largest request the fork server accepts, must match 'fork_server_main' in
+// startup.py.
+constexpr size_t kMaxRequestByteSize = 64 * 1024;
+
+TRITONSERVER_Error*
+ErrnoError(const std::string& msg)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL,
+      (msg + ": " + std::string(strerror(errno))).c_str());
+}
+
+}  // namespace
+
+ForkServer::ForkServer() : pid_(-1), fd_(-1), timeout_ms_(0) {}
+
+TRITONSERVER_Error*
+ForkServer::Create(
+    const std::string& python_runtime, const std::string& startup_path,
+    const std::string& preload_modules, const int64_t timeout_ms,
+    std::unique_ptr<ForkServer>* server)
+{
+  // Both ends are close-on-exec, the child clears the flag on its end before
+  // it runs startup.py.
+  int sockets[2];
+  if (socketpair(AF_UNIX, SOCK_SEQPACKET | SOCK_CLOEXEC, 0, sockets) == -1) {
+    return ErrnoError("failed to create the fork server socket");
+  }
+  const std::string fd = std::to_string(sockets[1]);
+
+  const char* commandline[] = {python_runtime.c_str(),
+                               startup_path.c_str(),
+                               "--fork-server-fd",
+                               fd.c_str(),
+                               "--preload-modules",
+                               preload_modules.c_str(),
+                               nullptr};
+
+  std::unique_ptr<ForkServer> fork_server(new ForkServer());
+  fork_server->timeout_ms_ = timeout_ms;
+  fork_server->pid_ = fork();
+  if (fork_server->pid_ == 0) {
+    fcntl(sockets[1], F_SETFD, 0);
+    execvp(commandline[0], (char**)commandline);
+    _exit(1);
+  }
+
+  close(sockets[1]);
+  if (fork_server->pid_ == -1) {
+    close(sockets[0]);
+    return ErrnoError("failed to start the fork server");
+  }
+  fork_server->fd_ = sockets[0];
+
+  *server = std::move(fork_server);
+  return nullptr;
+}
+
+ForkServer::~ForkServer()
+{
+  // The fork server exits when its socket is closed. The interpreters that
+  // it forked are stopped by their model instances.
+  if (fd_ != -1) {
+    close(fd_);
+  }
+  if (pid_ > 0) {
+    int status;
+    waitpid(pid_, &status, 0);
+  }
+}
+
+TRITONSERVER_Error*
+ForkServer::Fork(
+    const std::vector<std::string>& args, const int control_fd, pid_t* pid)
+{
+  // The arguments are sent as consecutive NUL-terminated strings, with
+  // 'control_fd' attached to the same message.
+  std::string request;
+  for (const auto& arg : args) {
+    request.append(arg.c_str(), arg.size() + 1);
+  }
+  if (request.size() > kMaxRequestByteSize) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "interpreter arguments are too long for the fork server");
+  }
+
+  struct iovec iov;
+  iov.iov_base = const_cast<char*>(request.data());
+  iov.iov_len = request.size();
+
+  char control[CMSG_SPACE(sizeof(int))];
+  memset(control, 0, sizeof(control));
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = &iov;
+  msg.msg_iovlen = 1;
+  msg.msg_control = control;
+  msg.msg_controllen = sizeof(control);
+
+  struct cmsghdr* cmsg = CMSG_FIRSTHDR(&msg);
+  cmsg->cmsg_level = SOL_SOCKET;
+  cmsg->cmsg_type = SCM_RIGHTS;
+  cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+  memcpy(CMSG_DATA(cmsg), &control_fd, sizeof(int));
+
+  std::lock_guard<std::mutex> lk(mu_);
+  if (fd_ == -1) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE, "the fork server is not running");
+  }
+  if (sendmsg(fd_, &msg, MSG_NOSIGNAL) == -1) {
+    return ErrnoError("failed to send a request to the fork server");
+  }
+
+  struct pollfd pfd;
+  pfd.fd = fd_;
+  pfd.events = POLLIN;
+  int ret;
+  do {
+    ret = poll(&pfd, 1, timeout_ms_);
+  } while ((ret == -1) && (errno == EINTR));
+  int64_t reply;
+  ssize_t byte_size = -1;
+  if (ret == 1) {
+    byte_size = recv(fd_, &reply, sizeof(reply), 0);
+  }
+
+  // A late reply would be taken as the reply to the next request, so the
+  // fork server is not used again once a request fails.
+  if (byte_size != sizeof(reply)) {
+    close(fd_);
+    fd_ = -1;
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (ret == 0) ? "timed out waiting for the fork server"
+                   : "the fork server exited unexpectedly");
+  }
+
+  // The reply is the pid of the new interpreter, or the negated errno of the
+  // failed fork.
+  if (reply <= 0) {
+    errno = -reply;
+    return ErrnoError("the fork server failed to fork an interpreter");
+  }
+
+  *pid = reply;
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
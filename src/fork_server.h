@@ -0,0 +1,75 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <sys/types.h>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// A Python process that imports startup.py, and the modules listed in
+// 'preload_modules', once and then forks the interpreters of the model
+// instances on request. The forked interpreters share the pages of the
+// imported modules copy-on-write, so they skip most of the import time of a
+// fresh interpreter. Requests are sent over a SOCK_SEQPACKET socket pair, the
+// layout of the messages must match 'fork_server_main' in startup.py.
+class ForkServer {
+ public:
+  static TRITONSERVER_Error* Create(
+      const std::string& python_runtime, const std::string& startup_path,
+      const std::string& preload_modules, const int64_t timeout_ms,
+      std::unique_ptr<ForkServer>* server);
+
+  ~ForkServer();
+
+  // Fork an interpreter that runs startup.py with 'args'. 'control_fd' is
+  // passed to the interpreter as its --control-fd and can be closed by the
+  // caller once this returns. The interpreter is not a child of this
+  // process, it is reaped by the fork server.
+  TRITONSERVER_Error* Fork(
+      const std::vector<std::string>& args, const int control_fd, pid_t* pid);
+
+ private:
+  ForkServer();
+
+  std::mutex mu_;
+  pid_t pid_;
+  int fd_;
+
+  // How long to wait for the fork server to reply, it only starts handling
+  // requests once the modules are imported.
+  int64_t timeout_ms_;
+};
+
+}}}  // namespace triton::backend::python
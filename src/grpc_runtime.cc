@@ -0,0 +1,89 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "grpc_runtime.h"
+
+#include <grpc/grpc.h>
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+void
+CompletionLoop(grpc::CompletionQueue* queue)
+{
+  void* tag;
+  bool ok;
+  while (queue->Next(&tag, &ok)) {
+    reinterpret_cast<CompletionTag*>(tag)->Complete(ok);
+  }
+}
+
+}  // namespace
+
+TRITONSERVER_Error*
+GrpcRuntime::Create(
+    const size_t thread_count, std::unique_ptr<GrpcRuntime>* runtime)
+{
+  grpc_init();
+  std::unique_ptr<GrpcRuntime> grpc_runtime(new GrpcRuntime());
+  for (size_t i = 0; i < thread_count; ++i) {
+    grpc_runtime->queues_.emplace_back(new grpc::CompletionQueue());
+    grpc_runtime->threads_.emplace_back(
+        CompletionLoop, grpc_runtime->queues_.back().get());
+  }
+
+  *runtime = std::move(grpc_runtime);
+  return nullptr;
+}
+
+GrpcRuntime::~GrpcRuntime()
+{
+  for (auto& queue : queues_) {
+    queue->Shutdown();
+  }
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+  queues_.clear();
+
+  // FIXME currently GRPC client uses an async thread for cleaning up and
+  // shutting down the connection, however, as reported in
+  // https://github.com/grpc/grpc/issues/22479 the clean up thread may
+  // continue to live after resources have been deallocated an cause a
+  // segfault. This is a workaround to do a blocking shutdown of the GRPC
+  // client, it is only done once the backend is finalized.
+  grpc_shutdown_blocking();
+}
+
+grpc::CompletionQueue*
+GrpcRuntime::NextCompletionQueue()
+{
+  return queues_[next_queue_.fetch_add(1) % queues_.size()].get();
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,77 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <grpcpp/completion_queue.h>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// Tag of the asynchronous operations sent to the completion queues of
+// GrpcRuntime. Complete() is called on the thread of the queue when the
+// operation is done.
+class CompletionTag {
+ public:
+  virtual ~CompletionTag() = default;
+  virtual void Complete(const bool ok) = 0;
+};
+
+// The gRPC library and the completion queues shared by the model instances
+// of the backend. gRPC is initialized once for the backend so that unloading
+// a model doesn't wait for a blocking shutdown of the library, and the
+// asynchronous executions of all the instances are handled by a fixed set of
+// threads, one per queue. The tags of the queues must be CompletionTags.
+class GrpcRuntime {
+ public:
+  static TRITONSERVER_Error* Create(
+      const size_t thread_count, std::unique_ptr<GrpcRuntime>* runtime);
+
+  // The channels and servers of the backend must be destroyed first, and
+  // every operation sent to the queues must be done.
+  ~GrpcRuntime();
+
+  // Get one of the completion queues, they are handed out in turn so that
+  // the instances are spread over the threads.
+  grpc::CompletionQueue* NextCompletionQueue();
+
+  size_t ThreadCount() const { return queues_.size(); }
+
+ private:
+  GrpcRuntime() : next_queue_(0) {}
+
+  std::vector<std::unique_ptr<grpc::CompletionQueue>> queues_;
+  std::vector<std::thread> threads_;
+  std::atomic<size_t> next_queue_;
+};
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,64 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "output_index.h"
+
+#include <algorithm>
+
+namespace triton { namespace backend { namespace python {
+
+void
+OutputIndex::Build(const InferenceResponse& response)
+{
+  response_ = &response;
+  entries_.clear();
+  for (int i = 0; i < response.outputs_size(); ++i) {
+    entries_.emplace_back(&response.outputs(i).name(), i);
+  }
+  std::sort(
+      entries_.begin(), entries_.end(),
+      [](const std::pair<const std::string*, int>& a,
+         const std::pair<const std::string*, int>& b) {
+        return *a.first < *b.first;
+      });
+}
+
+const Tensor*
+OutputIndex::Find(const char* name) const
+{
+  auto it = std::lower_bound(
+      entries_.begin(), entries_.end(), name,
+      [](const std::pair<const std::string*, int>& entry, const char* name) {
+        return entry.first->compare(name) < 0;
+      });
+  if ((it == entries_.end()) || (it->first->compare(name) != 0)) {
+    return nullptr;
+  }
+  return &response_->outputs(it->second);
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,347 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "placement.h"
+
+#include <linux/mempolicy.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include "triton/backend/backend_common.h"
+#include "triton/common/triton_json.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Parse a list of CPUs or NUMA nodes in the format of the cpulist files of
+// sysfs, e.g. "0-3,8".
+TRITONSERVER_Error*
+ParseList(const std::string& list, std::vector<int>* values)
+{
+  values->clear();
+  std::stringstream ss(list);
+  std::string range;
+  while (std::getline(ss, range, ',')) {
+    range.erase(
+        std::remove_if(range.begin(), range.end(), ::isspace), range.end());
+    if (range.empty()) {
+      continue;
+    }
+
+    int first, last;
+    const size_t dash = range.find('-');
+    try {
+      first = std::stoi(range.substr(0, dash));
+      last = (dash == std::string::npos) ? first
+                                         : std::stoi(range.substr(dash + 1));
+    }
+    catch (const std::exception&) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("invalid CPU list '") + list + "'").c_str());
+    }
+    if ((first < 0) || (last < first)) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("invalid CPU list '") + list + "'").c_str());
+    }
+    for (int value = first; value <= last; ++value) {
+      values->push_back(value);
+    }
+  }
+
+  return nullptr;
+}
+
+// Read the sysfs file at 'path', false if it doesn't exist.
+bool
+ReadSysfs(const std::string& path, std::string* contents)
+{
+  std::ifstream file(path);
+  if (!file) {
+    return false;
+  }
+  std::getline(file, *contents);
+  return true;
+}
+
+// CPUs of 'numa_node' that this process may run on.
+TRITONSERVER_Error*
+NodeCpus(const int numa_node, std::vector<int>* cpus)
+{
+  std::string cpulist;
+  if (!ReadSysfs(
+          "/sys/devices/system/node/node" + std::to_string(numa_node) +
+              "/cpulist",
+          &cpulist)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("NUMA node ") + std::to_string(numa_node) +
+         " doesn't exist")
+            .c_str());
+  }
+  std::vector<int> node_cpus;
+  RETURN_IF_ERROR(ParseList(cpulist, &node_cpus));
+
+  // Triton may itself be restricted to some of the CPUs, e.g. by a cgroup
+  cpu_set_t allowed;
+  CPU_ZERO(&allowed);
+  if (sched_getaffinity(0, sizeof(allowed), &allowed) == -1) {
+    *cpus = node_cpus;
+    return nullptr;
+  }
+  cpus->clear();
+  for (const int cpu : node_cpus) {
+    if ((cpu < CPU_SETSIZE) && CPU_ISSET(cpu, &allowed)) {
+      cpus->push_back(cpu);
+    }
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
+Placement::Placement() : numa_node_(-1)
+{
+  CPU_ZERO(&cpu_set_);
+  memset(node_mask_, 0, sizeof(node_mask_));
+}
+
+TRITONSERVER_Error*
+Placement::Init(const std::vector<int>& cpus, const int numa_node)
+{
+  for (const int cpu : cpus) {
+    if (cpu >= CPU_SETSIZE) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("CPU ") + std::to_string(cpu) + " is out of range")
+              .c_str());
+    }
+    CPU_SET(cpu, &cpu_set_);
+  }
+  cpus_ = cpus;
+
+  if (numa_node >= kMaxNumaNodes) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("NUMA node ") + std::to_string(numa_node) +
+         " is out of range")
+            .c_str());
+  }
+  if (numa_node >= 0) {
+    constexpr int bits = 8 * sizeof(unsigned long);
+    node_mask_[numa_node / bits] |= 1UL << (numa_node % bits);
+  }
+  numa_node_ = numa_node;
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+Placement::FromHostPolicy(
+    TRITONSERVER_Message* host_policy, Placement* placement)
+{
+  const char* base;
+  size_t byte_size;
+  RETURN_IF_ERROR(
+      TRITONSERVER_MessageSerializeToJson(host_policy, &base, &byte_size));
+  triton::common::TritonJson::Value policies;
+  RETURN_IF_ERROR(policies.Parse(base, byte_size));
+
+  // The message has the settings of the policy of the instance only, keyed
+  // by its name
+  std::vector<std::string> names;
+  RETURN_IF_ERROR(policies.Members(&names));
+  if (names.empty()) {
+    *placement = Placement();
+    return nullptr;
+  }
+  triton::common::TritonJson::Value settings;
+  RETURN_IF_ERROR(policies.MemberAsObject(names[0].c_str(), &settings));
+
+  int numa_node = -1;
+  triton::common::TritonJson::Value numa_node_setting;
+  if (settings.Find("numa-node", &numa_node_setting)) {
+    std::string numa_node_str;
+    RETURN_IF_ERROR(numa_node_setting.AsString(&numa_node_str));
+    std::vector<int> numa_nodes;
+    RETURN_IF_ERROR(ParseList(numa_node_str, &numa_nodes));
+    if (numa_nodes.size() != 1) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("invalid numa-node '") + numa_node_str +
+           "' in host policy '" + names[0] + "'")
+              .c_str());
+    }
+    numa_node = numa_nodes[0];
+  }
+
+  // The interpreter runs on the CPUs of its NUMA node unless the CPUs are
+  // set too
+  std::vector<int> cpus;
+  triton::common::TritonJson::Value cpu_cores_setting;
+  if (settings.Find("cpu-cores", &cpu_cores_setting)) {
+    std::string cpu_cores;
+    RETURN_IF_ERROR(cpu_cores_setting.AsString(&cpu_cores));
+    RETURN_IF_ERROR(ParseList(cpu_cores, &cpus));
+  } else if (numa_node != -1) {
+    RETURN_IF_ERROR(NodeCpus(numa_node, &cpus));
+  }
+
+  Placement result;
+  RETURN_IF_ERROR(result.Init(cpus, numa_node));
+  *placement = result;
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+Placement::Spread(const size_t index, Placement* placement)
+{
+  *placement = Placement();
+
+  std::string online;
+  if (!ReadSysfs("/sys/devices/system/node/online", &online)) {
+    return nullptr;
+  }
+  std::vector<int> numa_nodes;
+  RETURN_IF_ERROR(ParseList(online, &numa_nodes));
+
+  // Skip the nodes without CPUs, such as memory-only nodes, and those whose
+  // CPUs this process may not use
+  std::vector<std::pair<int, std::vector<int>>> nodes;
+  for (const int numa_node : numa_nodes) {
+    std::vector<int> cpus;
+    RETURN_IF_ERROR(NodeCpus(numa_node, &cpus));
+    if (!cpus.empty()) {
+      nodes.emplace_back(numa_node, std::move(cpus));
+    }
+  }
+  if (nodes.empty()) {
+    return nullptr;
+  }
+
+  const auto& node = nodes[index % nodes.size()];
+  return placement->Init(node.second, node.first);
+}
+
+bool
+Placement::operator==(const Placement& rhs) const
+{
+  return (cpus_ == rhs.cpus_) && (numa_node_ == rhs.numa_node_);
+}
+
+std::string
+Placement::CpuList() const
+{
+  std::string list;
+  for (size_t i = 0; i < cpus_.size(); ++i) {
+    size_t last = i;
+    while (((last + 1) < cpus_.size()) &&
+           (cpus_[last + 1] == (cpus_[last] + 1))) {
+      ++last;
+    }
+    if (!list.empty()) {
+      list += ",";
+    }
+    list += std::to_string(cpus_[i]);
+    if (last != i) {
+      list += "-" + std::to_string(cpus_[last]);
+    }
+    i = last;
+  }
+
+  return list;
+}
+
+void
+Placement::Apply() const
+{
+  if (!cpus_.empty()) {
+    sched_setaffinity(0, sizeof(cpu_set_), &cpu_set_);
+  }
+  if (numa_node_ != -1) {
+    syscall(
+        SYS_set_mempolicy, MPOL_PREFERRED, node_mask_,
+        8 * sizeof(node_mask_) + 1);
+  }
+}
+
+std::string
+Placement::ToString() const
+{
+  if (Empty()) {
+    return "any CPU";
+  }
+
+  std::string description;
+  if (!cpus_.empty()) {
+    description = "CPUs " + CpuList();
+  }
+  if (numa_node_ != -1) {
+    description += (description.empty() ? "" : " and ") +
+                   std::string("NUMA node ") + std::to_string(numa_node_);
+  }
+
+  return description;
+}
+
+TRITONSERVER_Error*
+BindToNumaNode(void* base, const size_t byte_size, const int numa_node)
+{
+  if ((numa_node < 0) || (numa_node >= kMaxNumaNodes)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("NUMA node ") + std::to_string(numa_node) +
+         " is out of range")
+            .c_str());
+  }
+
+  constexpr int bits = 8 * sizeof(unsigned long);
+  unsigned long node_mask[kMaxNumaNodes / bits] = {};
+  node_mask[numa_node / bits] |= 1UL << (numa_node % bits);
+  if (syscall(
+          SYS_mbind, base, byte_size, MPOL_PREFERRED, node_mask,
+          8 * sizeof(node_mask) + 1, 0) == -1) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNSUPPORTED,
+        (std::string("failed to bind memory to NUMA node ") +
+         std::to_string(numa_node) + ": " + strerror(errno))
+            .c_str());
+  }
+
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
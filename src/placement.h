@@ -0,0 +1,97 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <sched.h>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// Highest NUMA node number that an interpreter can be placed on, plus one.
+constexpr int kMaxNumaNodes = 1024;
+
+// CPUs and NUMA node that an interpreter process runs on. An interpreter is
+// placed either by the host policy of its instance, i.e. the 'numa-node' and
+// 'cpu-cores' settings of the --host-policy option of Triton, or by spreading
+// the interpreters of the model over the NUMA nodes of the host.
+class Placement {
+ public:
+  // A placement that doesn't restrict the interpreter.
+  Placement();
+
+  // Get the placement of an instance from its 'host_policy'. The placement is
+  // empty if the policy has no NUMA or CPU settings.
+  static TRITONSERVER_Error* FromHostPolicy(
+      TRITONSERVER_Message* host_policy, Placement* placement);
+
+  // Get the placement of the 'index'th interpreter when the interpreters are
+  // spread round-robin over the NUMA nodes that this process may run on. The
+  // placement is empty if the host doesn't report its NUMA nodes.
+  static TRITONSERVER_Error* Spread(const size_t index, Placement* placement);
+
+  bool Empty() const { return cpus_.empty() && (numa_node_ == -1); }
+  bool operator==(const Placement& rhs) const;
+
+  // CPUs in the format of the cpulist files of sysfs, e.g. "0-3,8".
+  std::string CpuList() const;
+
+  // Number of CPUs that the interpreter may run on, 0 if it isn't restricted.
+  size_t CpuCount() const { return cpus_.size(); }
+
+  // NUMA node that the memory is allocated on, -1 if there is none.
+  int NumaNode() const { return numa_node_; }
+
+  // Restrict the calling process to the placement. Only makes system calls
+  // so that it can be called between fork and exec. The placement is best
+  // effort, the errors are ignored.
+  void Apply() const;
+
+  // Description for the logs, e.g. "CPUs 0-3,8 and NUMA node 0".
+  std::string ToString() const;
+
+ private:
+  TRITONSERVER_Error* Init(const std::vector<int>& cpus, const int numa_node);
+
+  std::vector<int> cpus_;
+  int numa_node_;
+
+  // The placement in the format of the system calls, prepared in advance
+  // since it is applied after forking.
+  cpu_set_t cpu_set_;
+  unsigned long node_mask_[kMaxNumaNodes / (8 * sizeof(unsigned long))];
+};
+
+// Prefer NUMA node 'numa_node' for the pages of the mapping at 'base'.
+TRITONSERVER_Error* BindToNumaNode(
+    void* base, const size_t byte_size, const int numa_node);
+
+}}}  // namespace triton::backend::python
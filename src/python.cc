@@ -24,35 +24,70 @@
 // (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 // OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
-#include <grpc/grpc.h>
+#include <google/protobuf/arena.h>
 #include <grpc/support/time.h>
 #include <grpcpp/channel.h>
 #include <grpcpp/client_context.h>
 #include <grpcpp/create_channel.h>
 #include <grpcpp/security/credentials.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/file.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
 #include <sys/wait.h>
 #include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <cctype>
 #include <chrono>
+#include <climits>
+#include <condition_variable>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <functional>
 #include <memory>
+#include <mutex>
 #include <numeric>
 #include <sstream>
 #include <string>
 #include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <vector>
 
+#include "bls_server.h"
+#include "buffer_pool.h"
+#include "flat_request.h"
+#include "fork_server.h"
+#include "grpc_runtime.h"
+#include "output_index.h"
+#include "placement.h"
 #include "python_host.grpc.pb.h"
+#include "request_scheduler.h"
+#include "response_cache.h"
+#include "shm_manager.h"
 #include "triton/backend/backend_common.h"
 #include "triton/backend/backend_input_collector.h"
 #include "triton/backend/backend_memory.h"
 #include "triton/backend/backend_model.h"
 #include "triton/backend/backend_model_instance.h"
+#include "triton/backend/backend_output_responder.h"
 #include "triton/common/triton_json.h"
 #include "triton/core/tritonbackend.h"
 #include "triton/core/tritonserver.h"
+#include "warmup.h"
+
+#ifdef TRITON_ENABLE_GPU
+#include <cuda_runtime_api.h>
+#include "cuda_ipc_memory.h"
+#endif  // TRITON_ENABLE_GPU
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+#include "embedded_interpreter.h"
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
 
 namespace triton { namespace backend { namespace python {
 
@@ -93,12 +128,481 @@ namespace triton { namespace backend { namespace python {
 
 constexpr int MAX_GRPC_MESSAGE_SIZE = INT32_MAX;
 
+// How long to wait before trying again when an interpreter that exited
+// can't be restarted
+constexpr int RESTART_RETRY_DELAY_MS = 1000;
+
+// Returns true if 'output_name' is one of the outputs requested by 'request'
+bool
+IsOutputRequested(
+    TRITONBACKEND_Request* request, const std::string& output_name)
+{
+  uint32_t requested_output_count = 0;
+  LOG_IF_ERROR(
+      TRITONBACKEND_RequestOutputCount(request, &requested_output_count),
+      "failed getting requested output count");
+  for (uint32_t i = 0; i < requested_output_count; ++i) {
+    const char* requested_output_name;
+    if (TRITONBACKEND_RequestOutputName(request, i, &requested_output_name) ==
+            nullptr &&
+        output_name == requested_output_name) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
 class ModelState;
 
 struct BackendState {
+  // Destroyed last, once the gRPC objects of the backend are gone
+  std::unique_ptr<GrpcRuntime> grpc_runtime;
+
   std::string python_lib;
   std::string python_runtime;
   int64_t grpc_timeout;
+  int64_t shm_default_byte_size;
+  int64_t shm_growth_byte_size;
+  int64_t cuda_ipc_byte_size;
+  int64_t startup_timeout;
+
+  // Forks the interpreters when the fork server is enabled
+  std::unique_ptr<ForkServer> fork_server;
+
+  // A weight store used by the loaded models. The lock file of the store is
+  // kept locked in shared mode while it is used, so that other servers
+  // using the same directory neither remove it nor clear it.
+  struct WeightStoreRef {
+    int64_t model_count;
+    int lock_fd;
+  };
+
+  // Directory that the weight stores of the models are created in, and the
+  // stores that the loaded models use
+  std::string weight_store_dir;
+  std::mutex weight_store_mu;
+  std::unordered_map<std::string, WeightStoreRef> weight_store_refs;
+
+  // Runs the inference requests that the Python models send to the other
+  // models, started when the first model is loaded
+  std::mutex bls_server_mu;
+  std::unique_ptr<BlsServer> bls_server;
+
+  // Counter of the time spent in every stage of the executions, null if
+  // metrics are not available
+  TRITONSERVER_MetricFamily* stage_duration_family = nullptr;
+
+  // Counter of the lookups in the response caches of the models, null if
+  // metrics are not available
+  TRITONSERVER_MetricFamily* cache_lookup_family = nullptr;
+
+  // Acquisitions from the buffer pools of the instances and the bytes kept
+  // by the pools, null if metrics are not available
+  TRITONSERVER_MetricFamily* buffer_pool_acquisition_family = nullptr;
+  TRITONSERVER_MetricFamily* buffer_pool_size_family = nullptr;
+
+  ~BackendState()
+  {
+    if (stage_duration_family != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricFamilyDelete(stage_duration_family),
+          "failed to delete the stage duration metric family");
+    }
+    if (cache_lookup_family != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricFamilyDelete(cache_lookup_family),
+          "failed to delete the response cache metric family");
+    }
+    for (TRITONSERVER_MetricFamily* family :
+         {buffer_pool_acquisition_family, buffer_pool_size_family}) {
+      if (family != nullptr) {
+        LOG_IF_ERROR(
+            TRITONSERVER_MetricFamilyDelete(family),
+            "failed to delete a buffer pool metric family");
+      }
+    }
+  }
+};
+
+// Stages of an execution whose duration is reported for every instance
+enum ExecutionStage {
+  // Collecting the inputs and building the ExecuteRequest
+  STAGE_PREPARE,
+  // The gRPC round trip, excluding the time spent in the interpreter
+  STAGE_TRANSPORT,
+  // The stages of ExecuteTimings in the interpreter
+  STAGE_PYTHON_INPUT,
+  STAGE_PYTHON_COMPUTE,
+  STAGE_PYTHON_OUTPUT,
+  // Copying the outputs and sending the responses
+  STAGE_RESPONSE,
+  STAGE_COUNT
+};
+
+const char* const EXECUTION_STAGE_NAMES[STAGE_COUNT] = {
+    "prepare",        "transport",      "python_input",
+    "python_compute", "python_output", "response"};
+
+// A Python interpreter process running startup.py.
+struct InterpreterProcess {
+  pid_t pid;
+
+  // Temporary directory that contains the gRPC domain socket of the
+  // interpreter. Its name is unique, so it is also used to name the shared
+  // memory regions of the model instance.
+  std::string tmp_dir;
+  std::string domain_socket;
+
+  // Backend end of a socket pair shared with the interpreter. startup.py
+  // writes a byte to it once its gRPC server is listening, and it is closed
+  // when either process exits, so each side notices right away when the
+  // other one is gone.
+  int control_fd;
+
+  // CPUs and NUMA node that the interpreter runs on
+  Placement placement;
+};
+
+// Time that an interpreter has to exit after SIGTERM before it is killed, a
+// model that is stuck in 'execute' would otherwise keep it running forever
+constexpr int kInterpreterStopTimeoutMs = 5000;
+
+// Wait up to 'timeout_ms' milliseconds for 'interpreter' to exit, and reap
+// it if it is a child of this process. Returns whether it has exited.
+bool
+WaitForInterpreterExit(InterpreterProcess* interpreter, const int timeout_ms)
+{
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(timeout_ms);
+  while (true) {
+    int status;
+    const pid_t pid = waitpid(interpreter->pid, &status, WNOHANG);
+    if (pid == interpreter->pid) {
+      return true;
+    }
+
+    const int remaining_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())
+            .count();
+    if ((pid == -1) && (errno == ECHILD) && (interpreter->control_fd != -1)) {
+      // The interpreter was forked by the fork server, which reaps it. Only
+      // the interpreter holds the other end of the control socket, so the
+      // end of the stream tells that it has exited, even if its pid has
+      // been reused since.
+      pollfd fd{interpreter->control_fd, POLLIN, 0};
+      if (poll(&fd, 1, std::max(remaining_ms, 0)) > 0) {
+        char data;
+        const ssize_t byte_count = read(interpreter->control_fd, &data, 1);
+        if (byte_count <= 0) {
+          return true;
+        }
+        continue;
+      }
+    } else if ((pid == -1) && (errno == ECHILD)) {
+      if (kill(interpreter->pid, 0) == -1) {
+        return true;
+      }
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    } else {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    if (remaining_ms <= 0) {
+      return false;
+    }
+  }
+}
+
+// Stop 'interpreter' and remove its domain socket.
+void
+TerminateInterpreter(InterpreterProcess* interpreter)
+{
+  // The interpreter exits when the control socket is shut down. The backend
+  // end is kept open until then to notice when it has exited.
+  if (interpreter->control_fd != -1) {
+    shutdown(interpreter->control_fd, SHUT_WR);
+  }
+
+  kill(interpreter->pid, SIGTERM);
+  if (!WaitForInterpreterExit(interpreter, kInterpreterStopTimeoutMs)) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        (std::string("Python interpreter ") + std::to_string(interpreter->pid) +
+         " didn't exit after " + std::to_string(kInterpreterStopTimeoutMs) +
+         " ms, killing it")
+            .c_str());
+    kill(interpreter->pid, SIGKILL);
+    WaitForInterpreterExit(interpreter, kInterpreterStopTimeoutMs);
+  }
+
+  if (interpreter->control_fd != -1) {
+    close(interpreter->control_fd);
+  }
+
+  // We want to remove "unix://" from the beginning of domain_socket
+  unlink(interpreter->domain_socket.substr(strlen("unix://")).c_str());
+  rmdir(interpreter->tmp_dir.c_str());
+}
+
+// Lock file of a weight store, see BackendState::WeightStoreRef
+constexpr char kWeightStoreLock[] = ".lock";
+
+// Remove the arrays of the weight store at 'path', and the store itself with
+// its lock file if 'remove_store' is true.
+void
+ClearWeightStore(const std::string& path, const bool remove_store)
+{
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if ((name != ".") && (name != "..") &&
+        (remove_store || (name != kWeightStoreLock))) {
+      unlink((path + "/" + name).c_str());
+    }
+  }
+  closedir(dir);
+  if (remove_store) {
+    rmdir(path.c_str());
+  }
+}
+
+// Escape 'path' so that it can be used in a file name. Every character other
+// than a letter, a digit, '-' or '.' is replaced by '_' and its hexadecimal
+// value, so different paths have different names.
+std::string
+EscapeFileName(const std::string& path)
+{
+  static const char kHexDigits[] = "0123456789abcdef";
+  std::string name;
+  for (const char c : path) {
+    if (isalnum(static_cast<unsigned char>(c)) || (c == '-') || (c == '.')) {
+      name += c;
+    } else {
+      name += '_';
+      name += kHexDigits[(static_cast<unsigned char>(c) >> 4) & 0xf];
+      name += kHexDigits[static_cast<unsigned char>(c) & 0xf];
+    }
+  }
+  return name;
+}
+
+// Get the latest modification time of 'path' and of the files under it, in
+// nanoseconds.
+void
+LatestModificationTime(const std::string& path, int64_t* mtime_ns)
+{
+  struct stat st;
+  if (lstat(path.c_str(), &st) == -1) {
+    return;
+  }
+  *mtime_ns = std::max<int64_t>(
+      *mtime_ns, (static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000) +
+                     st.st_mtim.tv_nsec);
+  if (!S_ISDIR(st.st_mode)) {
+    return;
+  }
+
+  DIR* dir = opendir(path.c_str());
+  if (dir == nullptr) {
+    return;
+  }
+  while (struct dirent* entry = readdir(dir)) {
+    const std::string name = entry->d_name;
+    if ((name != ".") && (name != "..")) {
+      LatestModificationTime(path + "/" + name, mtime_ns);
+    }
+  }
+  closedir(dir);
+}
+
+// Open and lock the lock file of the weight store at 'path', creating the
+// store if it doesn't exist. The lock is shared once the store is ready. A
+// store that no other server has locked may have been left incomplete by a
+// server that didn't exit cleanly, so its arrays are removed first.
+TRITONSERVER_Error*
+LockWeightStore(const std::string& path, int* lock_fd)
+{
+  const std::string lock_path = path + "/" + kWeightStoreLock;
+
+  // Another server may remove the store between the calls, which is noticed
+  // when the locked file isn't the lock file of the store anymore
+  for (int attempt = 0; attempt < 8; ++attempt) {
+    if ((mkdir(path.c_str(), S_IRWXU) == -1) && (errno != EEXIST)) {
+      break;
+    }
+    const int fd = open(lock_path.c_str(), O_RDWR | O_CREAT, S_IRUSR | S_IWUSR);
+    if (fd == -1) {
+      continue;
+    }
+
+    const bool exclusive = (flock(fd, LOCK_EX | LOCK_NB) == 0);
+    if (!exclusive && (flock(fd, LOCK_SH) == -1)) {
+      close(fd);
+      break;
+    }
+
+    struct stat locked_st;
+    struct stat st;
+    if ((fstat(fd, &locked_st) == -1) || (stat(lock_path.c_str(), &st) == -1) ||
+        (locked_st.st_ino != st.st_ino) || (locked_st.st_dev != st.st_dev)) {
+      close(fd);
+      continue;
+    }
+
+    if (exclusive) {
+      ClearWeightStore(path, false /* remove_store */);
+      flock(fd, LOCK_SH);
+    }
+    *lock_fd = fd;
+    return nullptr;
+  }
+
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL,
+      (std::string("failed to create the weight store '") + path +
+       "': " + strerror(errno))
+          .c_str());
+}
+
+// Release the lock of the weight store at 'path', and remove the store if no
+// other server uses it.
+void
+UnlockWeightStore(const std::string& path, const int lock_fd)
+{
+  if (flock(lock_fd, LOCK_EX | LOCK_NB) == 0) {
+    ClearWeightStore(path, true /* remove_store */);
+  }
+  close(lock_fd);
+}
+
+// Get the time left before 'request', received at 'receive_ns', times out.
+// 'timeout_us' is 0 if the request has no timeout and at least 1 otherwise,
+// 'expired' tells whether the timeout has already passed.
+TRITONSERVER_Error*
+RemainingTimeout(
+    TRITONBACKEND_Request* request, const uint64_t receive_ns,
+    uint64_t* timeout_us, bool* expired)
+{
+  *expired = false;
+  RETURN_IF_ERROR(
+      TRITONBACKEND_RequestTimeoutMicroseconds(request, timeout_us));
+  if (*timeout_us == 0) {
+    return nullptr;
+  }
+
+  uint64_t now_ns = 0;
+  SET_TIMESTAMP(now_ns);
+  const uint64_t elapsed_us = (now_ns - receive_ns) / 1000;
+  if (elapsed_us >= *timeout_us) {
+    *expired = true;
+    *timeout_us = 1;
+  } else {
+    *timeout_us -= elapsed_us;
+  }
+
+  return nullptr;
+}
+
+// Next operation of a decoupled execution to complete on the completion queue
+enum StreamOperation { STREAM_START, STREAM_READ, STREAM_FINISH };
+
+class ModelInstanceState;
+
+// State of a single execution on the Python interpreter. Every slot owns a
+// shared memory region so that multiple executions can be in flight at the
+// same time. The slot is the tag of its asynchronous executions.
+struct ExecuteSlot : public CompletionTag {
+  explicit ExecuteSlot(ModelInstanceState* instance)
+      : instance(instance),
+        execute_request(
+            *google::protobuf::Arena::CreateMessage<ExecuteRequest>(&arena)),
+        execute_response(
+            *google::protobuf::Arena::CreateMessage<ExecuteResponse>(&arena)),
+        flat_execute_request(
+            *google::protobuf::Arena::CreateMessage<ExecuteRequest>(&arena)),
+        stream_response(*google::protobuf::Arena::CreateMessage<
+                        ExecuteStreamResponse>(&arena))
+  {
+  }
+
+  void Complete(const bool ok) override;
+
+  // Tag of the asynchronous operations of the slot, the completion queues
+  // expect a CompletionTag
+  void* Tag() { return static_cast<CompletionTag*>(this); }
+
+  ModelInstanceState* instance;
+
+  // The messages of the slot are allocated on its arena and are cleared,
+  // not destroyed, between executions. They keep their sub-messages and the
+  // capacity of their strings and repeated fields, so once the messages are
+  // large enough an execution doesn't allocate any metadata, and messages
+  // that grow take their memory from the arena instead of the heap.
+  google::protobuf::Arena arena;
+  std::unique_ptr<SharedMemory> shm_pool;
+  ExecuteRequest& execute_request;
+  ExecuteResponse& execute_response;
+
+  // A grpc::ClientContext can't be reused, a new one is created for every
+  // execution.
+  std::unique_ptr<grpc::ClientContext> context;
+  std::unique_ptr<grpc::ClientAsyncResponseReader<ExecuteResponse>> reader;
+  grpc::Status status;
+
+  std::vector<TRITONBACKEND_Request*> requests;
+  std::vector<TRITONBACKEND_Response*> responses;
+  // When the backend received the requests, which may wait for a free slot
+  // before the execution starts
+  uint64_t receive_ns;
+  uint64_t exec_start_ns;
+  uint64_t compute_start_ns;
+
+  // Total batch size of the execution when the requests are combined, and
+  // the batch size of every request.
+  uint64_t batch_size;
+  std::vector<int64_t> request_batch_sizes;
+
+  // Outputs of the response that is being processed by name, kept here to
+  // reuse its storage.
+  OutputIndex output_index;
+
+#ifdef TRITON_ENABLE_GPU
+  // Device memory for the tensors that are in GPU memory. Only created when
+  // CUDA IPC is enabled for the model and the instance is on a GPU.
+  std::unique_ptr<CudaIpcMemory> cuda_pool;
+#endif  // TRITON_ENABLE_GPU
+
+  // Message that is sent instead of 'execute_request' when the requests are
+  // written to the shared memory region in the flat layout.
+  ExecuteRequest& flat_execute_request;
+  FlatRequestWriter flat_request_writer;
+
+  // Decoupled executions stream the responses of the Python model. The
+  // factory of a request is null once the request is complete.
+  std::unique_ptr<grpc::ClientReader<ExecuteStreamResponse>> stream_reader;
+  std::unique_ptr<grpc::ClientAsyncReader<ExecuteStreamResponse>>
+      async_stream_reader;
+  StreamOperation stream_operation;
+  ExecuteStreamResponse& stream_response;
+  std::vector<TRITONBACKEND_ResponseFactory*> response_factories;
+  std::vector<bool> request_failed;
+
+  // Response cache key of every request, not cacheable if the response of
+  // the request can't be cached.
+  std::vector<CacheKey> cache_keys;
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  // Outputs of the embedded model that are added to the response cache
+  std::vector<CachedResponse> cached_responses;
+
+  // Values of the requests computed by the backend for the embedded model
+  std::vector<EmbeddedRequestInfo> request_infos;
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
 };
 
 class ModelInstanceState : public BackendModelInstance {
@@ -109,14 +613,29 @@ class ModelInstanceState : public BackendModelInstance {
 
   ~ModelInstanceState();
 
-  // Creates a python child process running startup.py
+  // Connects the instance to a python child process running startup.py
   TRITONSERVER_Error* CreatePythonInterpreter();
 
+  // Execute the warmup samples of the model in the interpreter, so that the
+  // first requests don't pay for the lazy initialization of the model.
+  TRITONSERVER_Error* Warmup();
+
+  // Send the requests to the Python interpreter, in one or more executions
+  // depending on the scheduling policy of the model. Depending on the
+  // pipeline depth of the model, the responses may be sent after this
+  // function returns.
+  TRITONSERVER_Error* ProcessRequests(
+      TRITONBACKEND_Request** requests, const uint32_t request_count);
+
   // Load Triton inputs to the appropriate Protobufs
   TRITONSERVER_Error* GetInputTensor(
       const uint32_t iidx, TRITONBACKEND_Request* request, Tensor* input_tensor,
-      std::vector<TRITONBACKEND_Response*>& responses, size_t r,
-      uint32_t& batch_size);
+      ExecuteSlot* slot, std::vector<TRITONBACKEND_Response*>& responses,
+      size_t r, bool* cuda_copy);
+
+  // Handle the completion of an asynchronous operation of the execution on
+  // 'slot', called on the thread of the completion queue of the instance.
+  void HandleCompletion(ExecuteSlot* slot, const bool ok);
 
   // TODO: Create getter and setters
   std::unique_ptr<PythonInterpreter::Stub> stub;
@@ -127,17 +646,187 @@ class ModelInstanceState : public BackendModelInstance {
 
   TRITONSERVER_Error* ConnectPythonInterpreter();
 
-  std::string pymodule_path_;
+  // Execute 'sample' once in the interpreter using 'slot'.
+  TRITONSERVER_Error* ExecuteWarmupSample(
+      ExecuteSlot* slot, const WarmupSample& sample);
+
+  // Send the requests to the Python interpreter in a single execution. The
+  // requests are left to the caller if an error is returned.
+  TRITONSERVER_Error* ExecuteRequests(
+      TRITONBACKEND_Request** requests, const uint32_t request_count);
+
+  // Add the arguments of the 'initialize' function of the model to
+  // 'command'.
+  void InitializationArgs(InitializationCommand* command);
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  // Create the model in the interpreter embedded in the backend, used
+  // instead of a Python interpreter process.
+  TRITONSERVER_Error* CreateEmbeddedModel();
+
+  // Execute the requests of 'slot' with the embedded model and send their
+  // responses.
+  void ExecuteEmbedded(ExecuteSlot* slot);
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
+
+  // Wait until the interpreter reports that its gRPC server is listening.
+  TRITONSERVER_Error* WaitForInterpreter();
+
+  // Create the shared memory region of every execution slot, named after the
+  // current interpreter.
+  TRITONSERVER_Error* CreateSharedMemoryRegions();
+
+  // Watch the control socket of the interpreter and restart the interpreter
+  // as soon as it exits, so that the instance recovers without reloading the
+  // model.
+  void SupervisorLoop();
+  TRITONSERVER_Error* RestartInterpreter();
+
+  // Wait until an execution slot is available. Returns nullptr if the
+  // interpreter is being restarted.
+  ExecuteSlot* AcquireSlot();
+  void ReleaseSlot(ExecuteSlot* slot);
+
+  // Build the ExecuteRequest of 'slot' from its Triton requests.
+  void PrepareExecuteRequest(ExecuteSlot* slot);
+
+  // Write the requests of 'slot' to its shared memory region in the flat
+  // layout and build the message that only refers to them.
+  void PrepareFlatExecuteRequest(ExecuteSlot* slot);
+
+  // The message that is sent to the interpreter for 'slot'
+  const ExecuteRequest& ExecuteRequestMessage(ExecuteSlot* slot) const;
+
+  // Combine all the requests of 'slot' into a single InferenceRequest whose
+  // inputs are concatenated along the batch dimension.
+  TRITONSERVER_Error* PrepareBatchedExecuteRequest(
+      ExecuteSlot* slot, bool* cuda_copy);
+
+  // Allocate the buffer that 'input' is collected into and record its
+  // location in 'input_tensor'. Inputs that are in GPU memory are kept on the
+  // device when CUDA IPC is enabled.
+  TRITONSERVER_Error* AllocateInputBuffer(
+      ExecuteSlot* slot, TRITONBACKEND_Input* input, const uint64_t byte_size,
+      Tensor* input_tensor, char** buffer);
+
+  // Get the data of a tensor returned by the Python model.
+  TRITONSERVER_Error* OutputTensorBuffer(
+      ExecuteSlot* slot, const Tensor& output_tensor, char** buffer,
+      TRITONSERVER_MemoryType* memory_type, int64_t* memory_type_id);
+
+  // Wait for the copies issued on the CUDA stream of the instance.
+  void SynchronizeCudaStream(const bool cuda_copy);
+
+  // Send the responses of a finished execution and release its requests.
+  void ProcessResponses(ExecuteSlot* slot);
+
+  // Fail the requests of 'slot' that are cancelled or whose timeout has
+  // passed while they waited for a free slot, and release them. Only the
+  // other requests are left in the slot.
+  void DropExpiredRequests(ExecuteSlot* slot);
+
+  // Kill the interpreter if 'slot' has failed because the execution timeout
+  // of the model has passed, since the model may never return. The
+  // supervisor then restarts the interpreter.
+  void AbortTimedOutExecution(ExecuteSlot* slot);
+
+  // Respond to the requests of 'slot' whose response is in the response
+  // cache of the model and release them. Only the other requests are left in
+  // the slot, with their cache key.
+  void RespondFromCache(ExecuteSlot* slot);
+
+  // Add the outputs of 'cached_response' to 'response'.
+  TRITONSERVER_Error* WriteCachedResponse(
+      TRITONBACKEND_Response* response, const CachedResponse& cached_response);
+
+  // Send response 'r' of 'slot' with the outputs of 'inference_response'.
+  // Returns false if an error response was sent instead, which completes
+  // the request.
+  bool SendResponse(
+      ExecuteSlot* slot, const uint32_t r,
+      const InferenceResponse& inference_response, const uint32_t send_flags);
+
+  // Report the statistics of the execution of 'slot' and release its
+  // requests.
+  void FinishExecution(ExecuteSlot* slot, const uint64_t compute_end_ns);
+
+  // Execute the requests of 'slot' with a decoupled model. Every response
+  // that the model sends is forwarded as soon as it is received.
+  void ExecuteStream(ExecuteSlot* slot);
+
+  // Handle the completion of the current operation of the stream of 'slot'
+  // when the executions are sent asynchronously.
+  void ProcessStreamEvent(ExecuteSlot* slot, const bool ok);
+
+  // Forward the message of the stream of 'slot' that was just received.
+  void ProcessStreamResponse(ExecuteSlot* slot);
+
+  // Complete the requests that the model didn't complete once the stream of
+  // 'slot' has ended, and release them.
+  void FinishStream(ExecuteSlot* slot);
+
+  // Create the stage duration metrics of the instance.
+  TRITONSERVER_Error* CreateStageMetrics();
+
+  // Create the buffer pool of the instance and its metrics.
+  TRITONSERVER_Error* CreateBufferPool();
+  TRITONSERVER_Error* CreateBufferPoolMetrics();
+
+  // Report the duration of the stages of the execution of 'slot', and get
+  // the part of the execution that the model's execute function ran, which
+  // is reported as the compute time of the requests.
+  void ReportExecutionStages(
+      ExecuteSlot* slot, const uint64_t compute_end_ns,
+      const uint64_t exec_end_ns, uint64_t* infer_start_ns,
+      uint64_t* infer_end_ns);
+
+  // Scatter the outputs of a combined InferenceRequest to the responses of
+  // the individual requests.
+  void ProcessBatchedResponse(ExecuteSlot* slot);
+
+  // Copy the elements of a BYTES output that belong to every request.
+  // BackendOutputResponder only handles fixed-size datatypes.
+  TRITONSERVER_Error* ScatterBytesOutput(
+      ExecuteSlot* slot, const Tensor& output, const char* output_data);
+
   ModelState* model_state_;
-  std::string domain_socket_;
-  TRITONBACKEND_ModelInstance* triton_model_instance_;
-  const std::string name_;
   bool connected_ = false;
 
  private:
-  TRITONBACKEND_Model* triton_model_;
-  pid_t interpreter_pid_;
-  std::vector<BackendMemory*> input_tensor_memories_;
+  std::unique_ptr<InterpreterProcess> interpreter_;
+
+  // Placement of the interpreter set by the host policy of the instance,
+  // empty if the placement policy of the model is used
+  Placement placement_;
+
+  // Staging buffers of the inputs that the embedded model gathers and of the
+  // outputs of the requests that the model sends to other models
+  std::unique_ptr<BufferPool> buffer_pool_;
+  std::vector<TRITONSERVER_Metric*> buffer_pool_metrics_;
+
+  std::vector<std::unique_ptr<ExecuteSlot>> slots_;
+  std::vector<ExecuteSlot*> free_slots_;
+  std::mutex slot_mu_;
+  std::condition_variable slot_cv_;
+
+  // False while the interpreter is being restarted, guarded by 'slot_mu_'
+  bool interpreter_available_ = true;
+
+  // One metric per ExecutionStage, empty if metrics are not available
+  std::vector<TRITONSERVER_Metric*> stage_metrics_;
+
+  // Written to when the instance is destroyed, to stop the supervisor
+  int stop_pipe_[2] = {-1, -1};
+  std::thread supervisor_thread_;
+
+  // Shared with other instances, the executions that are sent
+  // asynchronously are handled by the thread of the queue
+  grpc::CompletionQueue* completion_queue_ = nullptr;
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  // The model when it runs in the embedded interpreter, null otherwise
+  std::unique_ptr<EmbeddedModel> embedded_model_;
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
 };
 
 class ModelState : public BackendModel {
@@ -145,180 +834,635 @@ class ModelState : public BackendModel {
   static TRITONSERVER_Error* Create(
       TRITONBACKEND_Model* triton_model, ModelState** state);
 
+  ~ModelState();
+
   // Get backend state
   BackendState* StateForBackend() { return backend_state_; }
 
+  // Maximum number of executions that an instance sends to its Python
+  // interpreter without waiting for the previous ones to finish.
+  int64_t PipelineDepth() const { return pipeline_depth_; }
+
+  // Number of workers that run the Python model in every interpreter, and
+  // whether they are threads or pre-forked processes.
+  int64_t WorkerCount() const { return worker_count_; }
+  const std::string& WorkerType() const { return worker_type_; }
+
+  // Whether the requests of an execution are combined into a single batched
+  // request before they are sent to the Python model.
+  bool BatchedExecution() const { return batched_execution_; }
+
+  // Start the interpreters of the instances in the model configuration
+  // before the instances are created, so that they import the model in
+  // parallel.
+  TRITONSERVER_Error* LaunchInterpreters();
+
+  // Create the metrics of the lookups in the response cache.
+  TRITONSERVER_Error* CreateCacheMetrics();
+
+  // Get an interpreter for a new instance. Unless 'placement' is set, a
+  // launched interpreter is used if there is one left, otherwise a new one is
+  // started.
+  TRITONSERVER_Error* AcquireInterpreter(
+      const Placement& placement,
+      std::unique_ptr<InterpreterProcess>* interpreter);
+
+  // Whether the requests are sent to the interpreter in the flat layout of
+  // flat_request.h instead of as protobuf messages.
+  bool FlatRequests() const { return flat_requests_; }
+
+  // Whether the tensors in GPU memory are shared with the Python model
+  // through CUDA IPC instead of being copied to the host.
+  bool EnableCudaIpc() const { return enable_cuda_ipc_; }
+
+  // Number of interpreters kept launched in addition to those of the
+  // instances, so that new instances don't wait for an interpreter to start.
+  int64_t WarmSpareCount() const { return warm_spare_count_; }
+
+  // Whether the model uses the decoupled transaction policy, in which case
+  // the Python model may send any number of responses for every request.
+  bool IsDecoupled() const { return decoupled_; }
+
+  // Cache of the responses of the model, null if it is disabled.
+  ResponseCache* Cache() { return response_cache_.get(); }
+
+  // Count a lookup in the response cache in the metrics of the model.
+  void RecordCacheLookup(const bool hit);
+
+  // Whether the model runs in the Python interpreter embedded in the backend
+  // instead of in interpreter processes.
+  bool EmbeddedInterpreter() const { return interpreter_mode_ == "embedded"; }
+
+  // Location of the model file, <repository>/<version>/model.py
+  std::string ModelPath();
+
+  // Whether the model uses the sequence batcher, in which case the
+  // interpreter keeps the state of every sequence between its requests.
+  bool SequenceBatching() const { return sequence_batching_; }
+
+  // Time that an execution may take in the interpreter, in milliseconds. The
+  // interpreter is restarted if it takes longer. 0 if there is no limit.
+  int64_t ExecuteTimeout() const { return execute_timeout_ms_; }
+
+  // Number of bytes of free staging buffers that every instance keeps for
+  // reuse
+  int64_t BufferPoolByteSize() const { return buffer_pool_byte_size_; }
+
+  // How the requests that Triton passes to an instance are split into
+  // executions, 'fifo' or 'smallest_first', and the input byte size from
+  // which a request is executed on its own with 'smallest_first'.
+  const std::string& SchedulingPolicy() const { return scheduling_policy_; }
+  int64_t LargeRequestByteSize() const { return large_request_byte_size_; }
+
+  // Directory of the arrays that the instances of the model version share
+  // through memory-mapped files. It is kept while a model of the same
+  // repository and version is loaded, so a reload can reuse the arrays.
+  const std::string& WeightStorePath() const { return weight_store_path_; }
+
+  // Samples of the 'model_warmup' section of the model configuration
+  const std::vector<WarmupSample>& WarmupSamples() const
+  {
+    return warmup_samples_;
+  }
+
+  // Get the SequenceFlag bits of 'request' from its flags and from the
+  // control inputs of the sequence batcher.
+  TRITONSERVER_Error* SequenceFlags(
+      TRITONBACKEND_Request* request, uint32_t* flags);
+
  private:
   ModelState(TRITONBACKEND_Model* triton_model);
+
+  // Fork and exec a new interpreter running startup.py for this model on
+  // 'placement'.
+  TRITONSERVER_Error* LaunchInterpreter(
+      const Placement& placement,
+      std::unique_ptr<InterpreterProcess>* interpreter);
+
+  // Get the placement of the next interpreter launched for an instance
+  // without a placement of its own.
+  TRITONSERVER_Error* NextPlacement(Placement* placement);
+
+  // Number of threads of the math libraries in an interpreter on
+  // 'placement', 0 if it is left to the libraries.
+  int64_t InterpreterThreadCount(const Placement& placement) const;
+
+  // Read the model configuration parameter 'key'. 'value' is left unchanged
+  // if the parameter is not set.
+  TRITONSERVER_Error* ReadParameter(const std::string& key, std::string* value);
+
+  // A control input of the sequence batcher. 'flag' is set when the input
+  // has 'true_value', except for SEQUENCE_FLAG_NOT_READY which is set when
+  // the READY input doesn't have it.
+  struct SequenceControl {
+    std::string name;
+    SequenceFlag flag;
+    double true_value;
+  };
+
+  // Read the START, END and READY control inputs of the sequence batcher
+  // configuration.
+  TRITONSERVER_Error* ParseSequenceControls(
+      triton::common::TritonJson::Value& sequence_batching);
+
+  // Take a reference to the weight store of the model version, creating it
+  // if no other loaded model uses it, and release it.
+  TRITONSERVER_Error* AcquireWeightStore();
+  void ReleaseWeightStore();
+
+  // Start the BLS server of the backend if no other model has.
+  TRITONSERVER_Error* StartBlsServer();
+
   BackendState* backend_state_;
+  int64_t pipeline_depth_;
+  int64_t worker_count_;
+  std::string worker_type_;
+  bool batched_execution_;
+  bool enable_cuda_ipc_;
+  bool flat_requests_;
+  int64_t warm_spare_count_;
+  bool decoupled_;
+  std::string interpreter_mode_;
+  bool sequence_batching_;
+  std::vector<SequenceControl> sequence_controls_;
+  std::string cpu_affinity_policy_;
+  int64_t interpreter_thread_count_;
+  std::atomic<uint64_t> placement_index_;
+  std::string weight_store_path_;
+  int64_t execute_timeout_ms_;
+  int64_t buffer_pool_byte_size_;
+  std::string scheduling_policy_;
+  int64_t large_request_byte_size_;
+  std::vector<WarmupSample> warmup_samples_;
+
+  std::unique_ptr<ResponseCache> response_cache_;
+  TRITONSERVER_Metric* cache_hit_metric_ = nullptr;
+  TRITONSERVER_Metric* cache_miss_metric_ = nullptr;
+
+  // Interpreters launched for instances that haven't been created yet
+  std::mutex interpreter_mu_;
+  std::vector<std::unique_ptr<InterpreterProcess>> launched_interpreters_;
 };
 
 TRITONSERVER_Error*
 ModelInstanceState::CreatePythonInterpreter()
 {
-  const char* subinterpreter_commandline[] = {
-      nullptr, nullptr,           "--socket", nullptr, "--model-path",
-      nullptr, "--instance-name", nullptr,    nullptr};
+  RETURN_IF_ERROR(CreateBufferPool());
 
-  constexpr int max_tmpfile_name = 255;
-  char tmp_dir_name[max_tmpfile_name] = "/tmp/XXXXXX";
-  char full_socket_name[max_tmpfile_name];
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  if (model_state_->EmbeddedInterpreter()) {
+    return CreateEmbeddedModel();
+  }
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
 
-  // Create a temporary directory and use <tmp_dir>/unix.socket for GRPC socket
-  // This is the only way that we can make sure that the unix socket path used
-  // for GRPC is unique
-  char* tmp_dir_response = mkdtemp(tmp_dir_name);
+  // The host policy of the instance is owned by the instance
+  TRITONSERVER_Message* host_policy;
+  RETURN_IF_ERROR(TRITONBACKEND_ModelInstanceHostPolicy(
+      TritonModelInstance(), &host_policy));
+  RETURN_IF_ERROR(Placement::FromHostPolicy(host_policy, &placement_));
 
-  if (!tmp_dir_response) {
-    TRITONSERVER_Error* err = TRITONSERVER_ErrorNew(
+  // The interpreter is usually already running, it is launched when the
+  // model is loaded
+  RETURN_IF_ERROR(model_state_->AcquireInterpreter(placement_, &interpreter_));
+
+  if (model_state_->StateForBackend()->stage_duration_family != nullptr) {
+    LOG_IF_ERROR(
+        CreateStageMetrics(), "failed to create the stage duration metrics");
+  }
+
+  if (pipe2(stop_pipe_, O_CLOEXEC) == -1) {
+    return TRITONSERVER_ErrorNew(
         TRITONSERVER_ERROR_INTERNAL,
-        "Failed to create a temporary socket name");
-    return err;
-  } else {
-    std::stringstream ss;
-    ss << tmp_dir_name << "/unix.socket";
-    snprintf(full_socket_name, max_tmpfile_name, "unix://%s", ss.str().c_str());
-    subinterpreter_commandline[3] = full_socket_name;
-    domain_socket_ = std::string(full_socket_name);
+        (std::string("failed to create the supervisor pipe of ") + Name() +
+         ": " + strerror(errno))
+            .c_str());
   }
 
-  uint64_t model_version = model_state_->Version();
-  const char* model_path = model_state_->RepositoryPath().c_str();
+  const int64_t pipeline_depth = model_state_->PipelineDepth();
+  for (int64_t i = 0; i < pipeline_depth; ++i) {
+    std::unique_ptr<ExecuteSlot> slot(new ExecuteSlot(this));
+#ifdef TRITON_ENABLE_GPU
+    if (model_state_->EnableCudaIpc() &&
+        (Kind() == TRITONSERVER_INSTANCEGROUPKIND_GPU)) {
+      RETURN_IF_ERROR(CudaIpcMemory::Create(
+          DeviceId(), model_state_->StateForBackend()->cuda_ipc_byte_size,
+          &slot->cuda_pool));
+    }
+#endif  // TRITON_ENABLE_GPU
+    free_slots_.push_back(slot.get());
+    slots_.emplace_back(std::move(slot));
+  }
 
-  std::stringstream ss;
-  // Use <path>/version/model.py as the model location
-  ss << model_path << "/" << model_version << "/model.py";
-  pymodule_path_ = ss.str();
-  interpreter_pid_ = fork();
-
-  if (interpreter_pid_ == 0) {
-    // Use the python available in $PATH
-    std::string python_interpreter_path =
-        model_state_->StateForBackend()->python_runtime;
-
-    std::stringstream ss;
-    ss << model_state_->StateForBackend()->python_lib << "/startup.py";
-    std::string python_interpreter_startup = ss.str();
-
-    subinterpreter_commandline[0] = python_interpreter_path.c_str();
-    subinterpreter_commandline[1] = python_interpreter_startup.c_str();
-    subinterpreter_commandline[5] = pymodule_path_.c_str();
-    subinterpreter_commandline[7] = name_.c_str();
-    if (execvp(
-            subinterpreter_commandline[0],
-            (char**)subinterpreter_commandline) == -1) {
-      std::stringstream ss;
-      ss << "Cannot run interpreter host. Errno = " << errno << '\n'
-         << "python_interpreter_path: " << python_interpreter_path << '\n'
-         << "python_interpreter_startup: " << python_interpreter_startup << '\n'
-         << "pymodule_path_: " << pymodule_path_ << '\n'
-         << "instance_name: " << name_ << '\n';
-      std::string log_message = ss.str();
-      LOG_MESSAGE(TRITONSERVER_LOG_ERROR, log_message.c_str());
+  RETURN_IF_ERROR(CreateSharedMemoryRegions());
+  RETURN_IF_ERROR(ConnectPythonInterpreter());
 
-      return TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_INVALID_ARG,
-          (std::string("Failed to initialize model instance ") + name_)
-              .c_str());
-    }
-  } else {
-    RETURN_IF_ERROR(ConnectPythonInterpreter());
+  // With a single slot the executions are sent synchronously
+  if (pipeline_depth > 1) {
+    completion_queue_ =
+        model_state_->StateForBackend()->grpc_runtime->NextCompletionQueue();
   }
+  supervisor_thread_ = std::thread(&ModelInstanceState::SupervisorLoop, this);
 
   return nullptr;
 }
 
 TRITONSERVER_Error*
-ModelInstanceState::ConnectPythonInterpreter()
+ModelInstanceState::CreateSharedMemoryRegions()
 {
-  grpc_init();
-  grpc::ChannelArguments arguments;
-  arguments.SetMaxSendMessageSize(MAX_GRPC_MESSAGE_SIZE);
-  arguments.SetMaxReceiveMessageSize(MAX_GRPC_MESSAGE_SIZE);
-  auto grpc_channel = grpc::CreateCustomChannel(
-      domain_socket_, grpc::InsecureChannelCredentials(), arguments);
-
-  stub = PythonInterpreter::NewStub(grpc_channel);
-
-  std::shared_ptr<InitializationCommand> initialization_params(
-      new InitializationCommand());
-
-  std::vector<std::string> keys;
-  LOG_IF_ERROR(Model()->ModelConfig().Members(&keys), "can't get key names");
-  std::string val;
+  // Tensors are exchanged through shared memory regions, one per execution
+  // slot, that are named after the temporary directory of the interpreter so
+  // that they are unique too.
+  BlsServer* bls_server = model_state_->StateForBackend()->bls_server.get();
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    std::string shm_region_name =
+        std::string("/triton_python_backend_shm_region_") +
+        interpreter_->tmp_dir.substr(strlen("/tmp/")) + "_" +
+        std::to_string(i);
+
+    // The region of a previous interpreter is removed first, its name may be
+    // reused by the interpreter of another instance.
+    if (slots_[i]->shm_pool != nullptr) {
+      bls_server->UnregisterRegion(slots_[i]->shm_pool.get());
+    }
+    slots_[i]->shm_pool.reset();
+    RETURN_IF_ERROR(SharedMemory::Create(
+        shm_region_name,
+        model_state_->StateForBackend()->shm_default_byte_size,
+        model_state_->StateForBackend()->shm_growth_byte_size,
+        interpreter_->placement.NumaNode(), &slots_[i]->shm_pool));
+    bls_server->RegisterRegion(slots_[i]->shm_pool.get(), buffer_pool_.get());
+  }
 
-  const auto insert_model_param =
-      [&initialization_params](const std::string& key, const std::string& val) {
-        auto* value_pair = initialization_params->add_args();
-        value_pair->set_key(key);
-        value_pair->set_value(val);
-      };
+  return nullptr;
+}
 
-  triton::common::TritonJson::WriteBuffer buffer;
-  Model()->ModelConfig().Write(&buffer);
+void
+ModelInstanceState::SupervisorLoop()
+{
+  while (true) {
+    struct pollfd fds[2] = {
+        {interpreter_->control_fd, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_ERROR,
+          (std::string("failed to watch the Python interpreter of ") + Name() +
+           ": " + strerror(errno))
+              .c_str());
+      return;
+    }
+    if (fds[1].revents != 0) {
+      return;
+    }
+    if (fds[0].revents == 0) {
+      continue;
+    }
 
-  insert_model_param("model_config", std::move(buffer.MutableContents()));
-  insert_model_param(
-      "model_instance_kind", TRITONSERVER_InstanceGroupKindString(kind_));
-  insert_model_param("model_instance_name", name_);
-  insert_model_param("model_instance_device_id", std::to_string(device_id_));
-  insert_model_param("model_repository", model_state_->RepositoryPath());
-  insert_model_param("model_version", std::to_string(model_state_->Version()));
-  insert_model_param("model_name", model_state_->Name());
+    // startup.py doesn't write to the socket once it is ready, so the socket
+    // only becomes readable again when the interpreter exits.
+    char data;
+    const ssize_t byte_count = read(interpreter_->control_fd, &data, 1);
+    if ((byte_count > 0) || ((byte_count == -1) && (errno == EINTR))) {
+      continue;
+    }
 
-  // GRPC timeout
-  int64_t grpc_timeout = model_state_->StateForBackend()->grpc_timeout;
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_ERROR,
+        (std::string("Python interpreter of ") + Name() +
+         " exited unexpectedly, restarting it")
+            .c_str());
+
+    // The executions in flight fail as soon as gRPC notices that the socket
+    // of the interpreter is closed, new ones fail until the interpreter is
+    // back.
+    {
+      std::unique_lock<std::mutex> lk(slot_mu_);
+      interpreter_available_ = false;
+      slot_cv_.notify_all();
+      slot_cv_.wait(lk, [this] { return free_slots_.size() == slots_.size(); });
+    }
+    connected_ = false;
 
-  // Attempting to connect to the python runtime
-  grpc::Status status;
-  constexpr uint8_t conn_attempts = 5;
-  for (int i = 0; i < conn_attempts; ++i) {
-    grpc::ClientContext context;
-    Empty null_msg;
-    status = stub->Init(&context, *initialization_params, &null_msg);
-    if (status.ok()) {
+    while (true) {
+      TRITONSERVER_Error* err = RestartInterpreter();
+      if (err == nullptr) {
+        break;
+      }
       LOG_MESSAGE(
-          TRITONSERVER_LOG_VERBOSE,
-          (std::string("GRPC connection was successful ") + name_ +
-           " (device " + std::to_string(device_id_) + ")")
+          TRITONSERVER_LOG_ERROR,
+          (std::string("failed to restart the Python interpreter of ") +
+           Name() + ": " + TRITONSERVER_ErrorMessage(err))
               .c_str());
-      connected_ = true;
-      return nullptr;
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(grpc_timeout));
+      TRITONSERVER_ErrorDelete(err);
+
+      // Try again unless the instance is being destroyed
+      struct pollfd stop_poll = {stop_pipe_[0], POLLIN, 0};
+      int count;
+      do {
+        count = poll(&stop_poll, 1, RESTART_RETRY_DELAY_MS);
+      } while ((count == -1) && (errno == EINTR));
+      if (count != 0) {
+        return;
+      }
     }
-  }
 
-  return TRITONSERVER_ErrorNew(
-      TRITONSERVER_ERROR_INTERNAL, status.error_message().c_str());
+    {
+      std::lock_guard<std::mutex> lk(slot_mu_);
+      interpreter_available_ = true;
+    }
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_INFO,
+        (std::string("restarted the Python interpreter of ") + Name())
+            .c_str());
+  }
 }
 
-ModelInstanceState::ModelInstanceState(
-    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance)
-    : BackendModelInstance(model_state, triton_model_instance),
-      model_state_(model_state)
+TRITONSERVER_Error*
+ModelInstanceState::RestartInterpreter()
 {
+  if (interpreter_ != nullptr) {
+    TerminateInterpreter(interpreter_.get());
+    interpreter_.reset();
+  }
+  stub.reset();
+
+  // A spare interpreter is used if the model keeps one
+  RETURN_IF_ERROR(model_state_->AcquireInterpreter(placement_, &interpreter_));
+  RETURN_IF_ERROR(CreateSharedMemoryRegions());
+  return ConnectPythonInterpreter();
 }
 
 TRITONSERVER_Error*
-ModelInstanceState::Create(
-    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance,
-    ModelInstanceState** state)
+ModelInstanceState::WaitForInterpreter()
 {
-  try {
-    *state = new ModelInstanceState(model_state, triton_model_instance);
-  }
-  catch (const BackendModelInstanceException& ex) {
-    RETURN_ERROR_IF_TRUE(
-        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
-        std::string("unexpected nullptr in BackendModelInstanceException"));
-    RETURN_IF_ERROR(ex.err_);
-  }
+  const int64_t startup_timeout =
+      model_state_->StateForBackend()->startup_timeout;
+  const auto deadline = std::chrono::steady_clock::now() +
+                        std::chrono::milliseconds(startup_timeout);
+
+  while (true) {
+    const int64_t remaining_ms =
+        std::chrono::duration_cast<std::chrono::milliseconds>(
+            deadline - std::chrono::steady_clock::now())
+            .count();
+    if (remaining_ms <= 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNAVAILABLE,
+          (std::string("Python interpreter of ") + Name() +
+           " was not ready after " + std::to_string(startup_timeout) + " ms")
+              .c_str());
+    }
+
+    struct pollfd fds[2] = {
+        {interpreter_->control_fd, POLLIN, 0}, {stop_pipe_[0], POLLIN, 0}};
+    const int count = poll(fds, 2, remaining_ms);
+    if (count == -1) {
+      if (errno == EINTR) {
+        continue;
+      }
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("failed to wait for the Python interpreter of ") +
+           Name() + ": " + strerror(errno))
+              .c_str());
+    }
+    if (fds[1].revents != 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNAVAILABLE,
+          (Name() + " is being destroyed").c_str());
+    }
+    if (count == 0) {
+      continue;
+    }
+
+    // The socket is closed without any data if the interpreter exits before
+    // its server is listening, e.g. when model.py can't be imported.
+    char ready;
+    ssize_t byte_count;
+    do {
+      byte_count = read(interpreter_->control_fd, &ready, 1);
+    } while ((byte_count == -1) && (errno == EINTR));
+    if (byte_count != 1) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("Python interpreter of ") + Name() +
+           " exited during startup, check the server log for the error "
+           "reported by the model")
+              .c_str());
+    }
+
+    return nullptr;
+  }
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::ConnectPythonInterpreter()
+{
+  RETURN_IF_ERROR(WaitForInterpreter());
+
+  grpc::ChannelArguments arguments;
+  arguments.SetMaxSendMessageSize(MAX_GRPC_MESSAGE_SIZE);
+  arguments.SetMaxReceiveMessageSize(MAX_GRPC_MESSAGE_SIZE);
+  auto grpc_channel = grpc::CreateCustomChannel(
+      interpreter_->domain_socket, grpc::InsecureChannelCredentials(),
+      arguments);
+
+  // The server is already listening, so the connection is only waited for
+  // as long as the gRPC timeout
+  const int64_t grpc_timeout = model_state_->StateForBackend()->grpc_timeout;
+  if (!grpc_channel->WaitForConnected(
+          std::chrono::system_clock::now() +
+          std::chrono::milliseconds(grpc_timeout))) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (std::string("failed to connect to the Python interpreter of ") +
+         Name() + " within " + std::to_string(grpc_timeout) + " ms")
+            .c_str());
+  }
+
+  stub = PythonInterpreter::NewStub(grpc_channel);
+
+  std::shared_ptr<InitializationCommand> initialization_params(
+      new InitializationCommand());
+  InitializationArgs(initialization_params.get());
+
+  grpc::ClientContext context;
+  Empty null_msg;
+  grpc::Status status =
+      stub->Init(&context, *initialization_params, &null_msg);
+  if (!status.ok()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL, status.error_message().c_str());
+  }
+
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_VERBOSE,
+      (std::string("GRPC connection was successful ") + name_ + " (device " +
+       std::to_string(device_id_) + ")")
+          .c_str());
+  connected_ = true;
+  return nullptr;
+}
+
+void
+ModelInstanceState::InitializationArgs(InitializationCommand* command)
+{
+  const auto insert_model_param =
+      [command](const std::string& key, const std::string& val) {
+        auto* value_pair = command->add_args();
+        value_pair->set_key(key);
+        value_pair->set_value(val);
+      };
+
+  triton::common::TritonJson::WriteBuffer buffer;
+  Model()->ModelConfig().Write(&buffer);
+
+  insert_model_param("model_config", std::move(buffer.MutableContents()));
+  insert_model_param(
+      "model_instance_kind", TRITONSERVER_InstanceGroupKindString(kind_));
+  insert_model_param("model_instance_name", name_);
+  insert_model_param("model_instance_device_id", std::to_string(device_id_));
+  insert_model_param("model_repository", model_state_->RepositoryPath());
+  insert_model_param("model_version", std::to_string(model_state_->Version()));
+  insert_model_param("model_name", model_state_->Name());
+  insert_model_param("model_weight_store", model_state_->WeightStorePath());
+}
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+TRITONSERVER_Error*
+ModelInstanceState::CreateEmbeddedModel()
+{
+  if (model_state_->StateForBackend()->stage_duration_family != nullptr) {
+    LOG_IF_ERROR(
+        CreateStageMetrics(), "failed to create the stage duration metrics");
+  }
+
+  // The tensors are not exchanged through shared memory, the slot only
+  // holds the state of the execution
+  std::unique_ptr<ExecuteSlot> slot(new ExecuteSlot(this));
+  free_slots_.push_back(slot.get());
+  slots_.emplace_back(std::move(slot));
+
+  InitializationCommand initialization_params;
+  InitializationArgs(&initialization_params);
+  RETURN_IF_ERROR(EmbeddedModel::Create(
+      model_state_->StateForBackend()->python_lib, model_state_->ModelPath(),
+      initialization_params, buffer_pool_.get(), &embedded_model_));
+
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_VERBOSE,
+      (std::string("created embedded Python model for ") + name_ +
+       " (device " + std::to_string(device_id_) + ")")
+          .c_str());
+  return nullptr;
+}
+
+void
+ModelInstanceState::ExecuteEmbedded(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  const uint32_t request_count = slot->requests.size();
+  ResponseCache* cache = model_state_->Cache();
+
+  slot->execute_response.Clear();
+  slot->batch_size = 1;
+
+  slot->request_infos.assign(request_count, EmbeddedRequestInfo{0, 0});
+  for (uint32_t r = 0; r < request_count; ++r) {
+    EmbeddedRequestInfo& request_info = slot->request_infos[r];
+    if (model_state_->SequenceBatching()) {
+      GUARDED_RESPOND_IF_ERROR(
+          responses, r,
+          model_state_->SequenceFlags(
+              slot->requests[r], &request_info.sequence_flags));
+    }
+    bool expired;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        RemainingTimeout(
+            slot->requests[r], slot->receive_ns, &request_info.timeout_us,
+            &expired));
+  }
+
+  slot->compute_start_ns = 0;
+  SET_TIMESTAMP(slot->compute_start_ns);
+  TRITONSERVER_Error* err = embedded_model_->Execute(
+      slot->requests, slot->request_infos, &responses, CudaStream(),
+      (cache != nullptr) ? &slot->cached_responses : nullptr,
+      slot->execute_response.mutable_timings());
+  uint64_t compute_end_ns = 0;
+  SET_TIMESTAMP(compute_end_ns);
+  if (err != nullptr) {
+    SendErrorForResponses(&responses, request_count, err);
+  }
+
+  for (uint32_t r = 0; r < request_count; ++r) {
+    if (responses[r] == nullptr) {
+      continue;
+    }
+
+    // If error happens at this stage, we can only log it
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, nullptr),
+        "failed sending response");
+    if ((cache != nullptr) && slot->cache_keys[r].cacheable) {
+      LOG_IF_ERROR(
+          cache->Insert(
+              slot->cache_keys[r], slot->requests[r],
+              std::move(slot->cached_responses[r])),
+          "failed to cache a response");
+    }
+  }
+
+  FinishExecution(slot, compute_end_ns);
+}
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
+
+ModelInstanceState::ModelInstanceState(
+    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance)
+    : BackendModelInstance(model_state, triton_model_instance),
+      model_state_(model_state)
+{
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::Create(
+    ModelState* model_state, TRITONBACKEND_ModelInstance* triton_model_instance,
+    ModelInstanceState** state)
+{
+  try {
+    *state = new ModelInstanceState(model_state, triton_model_instance);
+  }
+  catch (const BackendModelInstanceException& ex) {
+    RETURN_ERROR_IF_TRUE(
+        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
+        std::string("unexpected nullptr in BackendModelInstanceException"));
+    RETURN_IF_ERROR(ex.err_);
+  }
   return nullptr;  // success
 }
 
 ModelInstanceState::~ModelInstanceState()
 {
+  // Wait for the executions that are still in flight
+  {
+    std::unique_lock<std::mutex> lk(slot_mu_);
+    slot_cv_.wait(lk, [this] { return free_slots_.size() == slots_.size(); });
+  }
+  if (supervisor_thread_.joinable()) {
+    const char stop = 0;
+    while ((write(stop_pipe_[1], &stop, 1) == -1) && (errno == EINTR)) {
+    }
+    supervisor_thread_.join();
+  }
+  for (int fd : stop_pipe_) {
+    if (fd != -1) {
+      close(fd);
+    }
+  }
   // Intentional empty scope, without this empty scope
   // GRPC will NOT shutdown gracefully
   {
@@ -337,40 +1481,38 @@ ModelInstanceState::~ModelInstanceState()
     }
   }
 
-  // Remove input tensor memories
-  for (BackendMemory* mem : input_tensor_memories_) {
-    delete mem;
+  // Waits for the inference requests that the model is still sending
+  BlsServer* bls_server = model_state_->StateForBackend()->bls_server.get();
+  for (auto& slot : slots_) {
+    if (slot->shm_pool != nullptr) {
+      bls_server->UnregisterRegion(slot->shm_pool.get());
+    }
   }
-  input_tensor_memories_.clear();
-
-  stub.reset();
 
-  int status;
-  kill(interpreter_pid_, SIGTERM);
-  waitpid(interpreter_pid_, &status, 0);
+  for (TRITONSERVER_Metric* metric : stage_metrics_) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricDelete(metric),
+        "failed to delete a stage duration metric");
+  }
 
-  // Check if the domain socket has been set.
-  if (domain_socket_ != "") {
-    // We want to remove "unix://" from the beginning of domain_socket_
-    unlink(domain_socket_.substr(strlen("unix://")).c_str());
+  for (TRITONSERVER_Metric* metric : buffer_pool_metrics_) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricDelete(metric),
+        "failed to delete a buffer pool metric");
+  }
 
-    // FIXME currently GRPC client uses an async thread for cleaning up and
-    // shutting down the connection, however, as reported in
-    // https://github.com/grpc/grpc/issues/22479 the clean up thread may
-    // continue to live after resources have been deallocated an cause a
-    // segfault. This is a workaround to do a blocking shutdown of the GRPC
-    // client
-    grpc_shutdown_blocking();
+  stub.reset();
 
-    LOG_MESSAGE(TRITONSERVER_LOG_VERBOSE, "GRPC shutdown complete");
+  if (interpreter_ != nullptr) {
+    TerminateInterpreter(interpreter_.get());
   }
 }
 
 TRITONSERVER_Error*
 ModelInstanceState::GetInputTensor(
     const uint32_t iidx, TRITONBACKEND_Request* request, Tensor* input_tensor,
-    std::vector<TRITONBACKEND_Response*>& responses, size_t r,
-    uint32_t& batch_size)
+    ExecuteSlot* slot, std::vector<TRITONBACKEND_Response*>& responses,
+    size_t r, bool* cuda_copy)
 {
   const char* input_name;
   // Load iidx'th input name
@@ -398,13 +1540,7 @@ ModelInstanceState::GetInputTensor(
   // sends each request individually to the python model
   BackendInputCollector collector(
       &request, 1, &responses, Model()->TritonMemoryManager(),
-      false /* pinned_enable */, CudaStream());
-
-  if (input_byte_size >= MAX_GRPC_MESSAGE_SIZE)
-    return TRITONSERVER_ErrorNew(
-        TRITONSERVER_ERROR_UNSUPPORTED,
-        "Python backend does not support input size larger than 2GBs, consider "
-        "parititioning your input into multiple inputs.");
+      model_state_->EnablePinnedInput(), CudaStream());
 
   // Update input_tensor
   input_tensor->set_name(input_name);
@@ -414,56 +1550,2712 @@ ModelInstanceState::GetInputTensor(
     input_tensor->add_dims(input_shape[j]);
   }
 
-  // Load raw data into input_tensor raw data.
-  std::string* data_buffer = input_tensor->mutable_raw_data();
-  data_buffer->resize(input_byte_size);
-
-  char* input_buffer = (char*)data_buffer->c_str();
+  // Collect the input directly into the memory shared with the Python
+  // interpreter, only the location of the data is sent to it.
+  char* input_buffer;
+  RETURN_IF_ERROR(AllocateInputBuffer(
+      slot, in, input_byte_size, input_tensor, &input_buffer));
 
   collector.ProcessTensor(
-      input_name, input_buffer, input_byte_size, TRITONSERVER_MEMORY_CPU, 0);
+      input_name, input_buffer, input_byte_size,
+      static_cast<TRITONSERVER_MemoryType>(input_tensor->memory_type()),
+      input_tensor->memory_type_id());
+  *cuda_copy |= collector.Finalize();
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::AllocateInputBuffer(
+    ExecuteSlot* slot, TRITONBACKEND_Input* input, const uint64_t byte_size,
+    Tensor* input_tensor, char** buffer)
+{
+  uint64_t offset;
+  *buffer = nullptr;
+
+#ifdef TRITON_ENABLE_GPU
+  if (slot->cuda_pool != nullptr) {
+    const void* src_buffer;
+    uint64_t src_byte_size;
+    TRITONSERVER_MemoryType src_memory_type = TRITONSERVER_MEMORY_GPU;
+    int64_t src_memory_type_id = DeviceId();
+    RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+        input, 0, &src_buffer, &src_byte_size, &src_memory_type,
+        &src_memory_type_id));
+
+    // The input stays in the shared memory region when CUDA IPC memory is
+    // full
+    if (src_memory_type == TRITONSERVER_MEMORY_GPU) {
+      TRITONSERVER_Error* err =
+          slot->cuda_pool->Allocate(byte_size, &offset, buffer);
+      if (err == nullptr) {
+        input_tensor->set_memory_type(TRITONSERVER_MEMORY_GPU);
+        input_tensor->set_memory_type_id(slot->cuda_pool->DeviceId());
+      } else {
+        TRITONSERVER_ErrorDelete(err);
+      }
+    }
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  if (*buffer == nullptr) {
+    RETURN_IF_ERROR(slot->shm_pool->Allocate(byte_size, &offset, buffer));
+    input_tensor->set_memory_type(TRITONSERVER_MEMORY_CPU);
+    input_tensor->set_memory_type_id(0);
+  }
+
+  input_tensor->set_offset(offset);
+  input_tensor->set_byte_size(byte_size);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::OutputTensorBuffer(
+    ExecuteSlot* slot, const Tensor& output_tensor, char** buffer,
+    TRITONSERVER_MemoryType* memory_type, int64_t* memory_type_id)
+{
+  if (output_tensor.memory_type() == TRITONSERVER_MEMORY_GPU) {
+#ifdef TRITON_ENABLE_GPU
+    if (slot->cuda_pool != nullptr) {
+      *memory_type = TRITONSERVER_MEMORY_GPU;
+      *memory_type_id = slot->cuda_pool->DeviceId();
+      return slot->cuda_pool->Buffer(
+          output_tensor.offset(), output_tensor.byte_size(), buffer);
+    }
+#endif  // TRITON_ENABLE_GPU
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("output tensor '") + output_tensor.name() +
+         "' is in GPU memory but CUDA IPC is not enabled")
+            .c_str());
+  }
+
+  *memory_type = TRITONSERVER_MEMORY_CPU;
+  *memory_type_id = 0;
+  return slot->shm_pool->Buffer(
+      output_tensor.offset(), output_tensor.byte_size(), buffer);
+}
+
+void
+ModelInstanceState::SynchronizeCudaStream(const bool cuda_copy)
+{
+#ifdef TRITON_ENABLE_GPU
+  if (cuda_copy) {
+    cudaStreamSynchronize(CudaStream());
+  }
+#endif  // TRITON_ENABLE_GPU
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::Warmup()
+{
+  const std::vector<WarmupSample>& samples = model_state_->WarmupSamples();
+  if (samples.empty()) {
+    return nullptr;
+  }
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  if (embedded_model_ != nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        (std::string("the warmup samples of ") + Name() +
+         " are not executed in the embedded interpreter")
+            .c_str());
+    return nullptr;
+  }
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
+
+  ExecuteSlot* slot = AcquireSlot();
+  if (slot == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (std::string("Python interpreter of ") + Name() + " is restarting")
+            .c_str());
+  }
+
+  uint64_t warmup_start_ns = 0;
+  SET_TIMESTAMP(warmup_start_ns);
+  for (const WarmupSample& sample : samples) {
+    for (uint64_t i = 0; i < sample.count; ++i) {
+      uint64_t start_ns = 0;
+      SET_TIMESTAMP(start_ns);
+      TRITONSERVER_Error* err = ExecuteWarmupSample(slot, sample);
+      if (err != nullptr) {
+        ReleaseSlot(slot);
+        TRITONSERVER_Error* warmup_err = TRITONSERVER_ErrorNew(
+            TRITONSERVER_ErrorCode(err),
+            (std::string("warmup sample '") + sample.name + "' of " +
+             Name() + " failed: " + TRITONSERVER_ErrorMessage(err))
+                .c_str());
+        TRITONSERVER_ErrorDelete(err);
+        return warmup_err;
+      }
+      uint64_t end_ns = 0;
+      SET_TIMESTAMP(end_ns);
+
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_VERBOSE,
+          (std::string("warmup sample '") + sample.name + "' of " + Name() +
+           " (" + std::to_string(i + 1) + "/" + std::to_string(sample.count) +
+           ") took " + std::to_string((end_ns - start_ns) / 1000) + " us")
+              .c_str());
+    }
+  }
+  ReleaseSlot(slot);
+
+  uint64_t warmup_end_ns = 0;
+  SET_TIMESTAMP(warmup_end_ns);
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_INFO,
+      (std::string("warmed up ") + Name() + " with " +
+       std::to_string(samples.size()) + " samples in " +
+       std::to_string((warmup_end_ns - warmup_start_ns) / 1000000) + " ms")
+          .c_str());
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::ExecuteWarmupSample(
+    ExecuteSlot* slot, const WarmupSample& sample)
+{
+  slot->shm_pool->Reset();
+  slot->execute_request.Clear();
+  slot->execute_request.set_shm_region_name(slot->shm_pool->Name());
+
+  InferenceRequest* request = slot->execute_request.add_requests();
+  request->set_id(sample.name);
+  // The sample is a sequence of its own, the interpreter doesn't keep its
+  // state
+  if (model_state_->SequenceBatching()) {
+    request->set_sequence_flags(SEQUENCE_FLAG_START | SEQUENCE_FLAG_END);
+  }
+  for (const WarmupInput& input : sample.inputs) {
+    Tensor* input_tensor = request->add_inputs();
+    input_tensor->set_name(input.name);
+    input_tensor->set_dtype(static_cast<int>(input.dtype));
+    for (const int64_t dim : input.dims) {
+      input_tensor->add_dims(dim);
+    }
+
+    uint64_t offset;
+    char* buffer;
+    RETURN_IF_ERROR(
+        slot->shm_pool->Allocate(input.data.size(), &offset, &buffer));
+    memcpy(buffer, input.data.data(), input.data.size());
+    input_tensor->set_offset(offset);
+    input_tensor->set_byte_size(input.data.size());
+    input_tensor->set_memory_type(TRITONSERVER_MEMORY_CPU);
+    input_tensor->set_memory_type_id(0);
+  }
+  for (const std::string& output_name : sample.requested_output_names) {
+    request->add_requested_output_names(output_name);
+  }
+
+  slot->context.reset(new grpc::ClientContext());
+  if (model_state_->ExecuteTimeout() > 0) {
+    slot->context->set_deadline(
+        std::chrono::system_clock::now() +
+        std::chrono::milliseconds(model_state_->ExecuteTimeout()));
+  }
+
+  // Only the errors of the responses are checked, their outputs are
+  // discarded with the shared memory region on the next execution.
+  std::string error_message;
+  if (model_state_->IsDecoupled()) {
+    slot->stream_reader =
+        stub->ExecuteStream(slot->context.get(), slot->execute_request);
+    while (slot->stream_reader->Read(&slot->stream_response)) {
+      const InferenceResponse& response = slot->stream_response.response();
+      if (response.failed() && error_message.empty()) {
+        error_message = response.error().message();
+      }
+    }
+    slot->status = slot->stream_reader->Finish();
+  } else {
+    slot->execute_response.Clear();
+    slot->status = stub->Execute(
+        slot->context.get(), slot->execute_request, &slot->execute_response);
+    for (const InferenceResponse& response :
+         slot->execute_response.responses()) {
+      if (response.failed() && error_message.empty()) {
+        error_message = response.error().message();
+      }
+    }
+  }
+
+  if (!slot->status.ok()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("execution failed: ") + slot->status.error_message())
+            .c_str());
+  }
+  if (!error_message.empty()) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL, error_message.c_str());
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::ProcessRequests(
+    TRITONBACKEND_Request** requests, const uint32_t request_count)
+{
+  if (model_state_->SchedulingPolicy() == "fifo") {
+    return ExecuteRequests(requests, request_count);
+  }
+
+  std::vector<std::vector<TRITONBACKEND_Request*>> executions;
+  RETURN_IF_ERROR(ScheduleRequests(
+      requests, request_count, model_state_->LargeRequestByteSize(),
+      &executions));
+
+  // Triton only takes the requests back if nothing has been done with them,
+  // the requests of the later executions are failed here instead.
+  for (size_t e = 0; e < executions.size(); ++e) {
+    std::vector<TRITONBACKEND_Request*>& execution = executions[e];
+    TRITONSERVER_Error* err =
+        ExecuteRequests(execution.data(), execution.size());
+    if (err == nullptr) {
+      continue;
+    }
+    if (e == 0) {
+      return err;
+    }
+    LOG_IF_ERROR(
+        RequestsRespondWithError(execution.data(), execution.size(), err),
+        "failed sending error responses");
+    TRITONSERVER_ErrorDelete(err);
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::ExecuteRequests(
+    TRITONBACKEND_Request** requests, const uint32_t request_count)
+{
+  uint64_t receive_ns = 0;
+  SET_TIMESTAMP(receive_ns);
+
+  ExecuteSlot* slot = AcquireSlot();
+  if (slot == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNAVAILABLE,
+        (std::string("Python interpreter of ") + Name() + " is restarting")
+            .c_str());
+  }
+
+  uint64_t exec_start_ns = 0;
+  SET_TIMESTAMP(exec_start_ns);
+
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  responses.reserve(request_count);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    TRITONBACKEND_Request* req = requests[r];
+
+    TRITONBACKEND_Response* response;
+    TRITONSERVER_Error* err = TRITONBACKEND_ResponseNew(&response, req);
+    if (err != nullptr) {
+      for (TRITONBACKEND_Response* created_response : responses) {
+        LOG_IF_ERROR(
+            TRITONBACKEND_ResponseDelete(created_response),
+            "failed deleting response");
+      }
+      responses.clear();
+      ReleaseSlot(slot);
+      return err;
+    }
+    responses.push_back(response);
+  }
+
+  slot->requests.assign(requests, requests + request_count);
+  slot->receive_ns = receive_ns;
+  slot->exec_start_ns = exec_start_ns;
+  DropExpiredRequests(slot);
+  if (slot->requests.empty()) {
+    ReleaseSlot(slot);
+    return nullptr;
+  }
+  if (model_state_->Cache() != nullptr) {
+    RespondFromCache(slot);
+    if (slot->requests.empty()) {
+      ReleaseSlot(slot);
+      return nullptr;
+    }
+  }
+
+#ifdef TRITON_ENABLE_EMBEDDED_PYTHON
+  if (embedded_model_ != nullptr) {
+    ExecuteEmbedded(slot);
+    return nullptr;
+  }
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
+
+  PrepareExecuteRequest(slot);
+
+  // ExecuteResponse
+  slot->context.reset(new grpc::ClientContext());
+  if (model_state_->ExecuteTimeout() > 0) {
+    slot->context->set_deadline(
+        std::chrono::system_clock::now() +
+        std::chrono::milliseconds(model_state_->ExecuteTimeout()));
+  }
+  slot->execute_response.Clear();
+
+  slot->compute_start_ns = 0;
+  SET_TIMESTAMP(slot->compute_start_ns);
+
+  if (model_state_->IsDecoupled()) {
+    ExecuteStream(slot);
+  } else if (slots_.size() == 1) {
+    // Perform inference on the Python side
+    slot->status = stub->Execute(
+        slot->context.get(), ExecuteRequestMessage(slot),
+        &slot->execute_response);
+    ProcessResponses(slot);
+  } else {
+    // Send the execution without waiting for it, so that the requests of the
+    // next execution can be collected while the Python model is running.
+    // HandleCompletion handles the response.
+    slot->reader = stub->AsyncExecute(
+        slot->context.get(), ExecuteRequestMessage(slot), completion_queue_);
+    slot->reader->Finish(&slot->execute_response, &slot->status, slot->Tag());
+  }
+
+  return nullptr;
+}
+
+ExecuteSlot*
+ModelInstanceState::AcquireSlot()
+{
+  std::unique_lock<std::mutex> lk(slot_mu_);
+  slot_cv_.wait(
+      lk, [this] { return !interpreter_available_ || !free_slots_.empty(); });
+  if (!interpreter_available_) {
+    return nullptr;
+  }
+  ExecuteSlot* slot = free_slots_.back();
+  free_slots_.pop_back();
+  return slot;
+}
+
+void
+ModelInstanceState::ReleaseSlot(ExecuteSlot* slot)
+{
+  slot->requests.clear();
+  slot->responses.clear();
+  slot->reader.reset();
+  slot->stream_reader.reset();
+  slot->async_stream_reader.reset();
+  slot->response_factories.clear();
+  slot->request_failed.clear();
+  slot->context.reset();
+
+  // Notify while holding the lock, the destructor may be waiting for the
+  // last slot to be released.
+  std::lock_guard<std::mutex> lk(slot_mu_);
+  free_slots_.push_back(slot);
+  slot_cv_.notify_all();
+}
+
+void
+ModelInstanceState::DropExpiredRequests(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Request*>& requests = slot->requests;
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  const size_t request_count = requests.size();
+
+  size_t executed_count = 0;
+  for (size_t r = 0; r < request_count; ++r) {
+    TRITONBACKEND_Request* request = requests[r];
+    TRITONBACKEND_Response* response = responses[r];
+
+    // The request is executed if its state can't be read
+    bool cancelled = false;
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestIsCancelled(request, &cancelled),
+        "failed to check whether a request is cancelled");
+    uint64_t timeout_us;
+    bool expired = false;
+    LOG_IF_ERROR(
+        RemainingTimeout(request, slot->receive_ns, &timeout_us, &expired),
+        "failed to get the timeout of a request");
+
+    // The request that ends a sequence is executed anyway, the interpreter
+    // only releases the state of the sequence after it
+    if ((cancelled || expired) && model_state_->SequenceBatching()) {
+      uint32_t sequence_flags = 0;
+      LOG_IF_ERROR(
+          model_state_->SequenceFlags(request, &sequence_flags),
+          "failed to get the sequence flags of a request");
+      if ((sequence_flags & SEQUENCE_FLAG_END) != 0) {
+        cancelled = false;
+        expired = false;
+      }
+    }
+    if (!cancelled && !expired) {
+      requests[executed_count] = request;
+      responses[executed_count] = response;
+      ++executed_count;
+      continue;
+    }
+
+    TRITONSERVER_Error* err =
+        cancelled ? TRITONSERVER_ErrorNew(
+                        TRITONSERVER_ERROR_CANCELLED, "request was cancelled")
+                  : TRITONSERVER_ErrorNew(
+                        TRITONSERVER_ERROR_UNAVAILABLE,
+                        "request timeout expired before it was executed");
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+        "failed sending response");
+    TRITONSERVER_ErrorDelete(err);
+
+    uint64_t exec_end_ns = 0;
+    SET_TIMESTAMP(exec_end_ns);
+    LOG_IF_ERROR(
+        TRITONBACKEND_ModelInstanceReportStatistics(
+            TritonModelInstance(), request, false /* success */,
+            slot->exec_start_ns, exec_end_ns, exec_end_ns, exec_end_ns),
+        "failed reporting request statistics");
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestRelease(request, TRITONSERVER_REQUEST_RELEASE_ALL),
+        "failed releasing request");
+  }
+
+  requests.resize(executed_count);
+  responses.resize(executed_count);
+}
+
+void
+ModelInstanceState::AbortTimedOutExecution(ExecuteSlot* slot)
+{
+  if ((model_state_->ExecuteTimeout() == 0) ||
+      (slot->status.error_code() != grpc::StatusCode::DEADLINE_EXCEEDED)) {
+    return;
+  }
+
+  // The executions of the other slots fail too, the supervisor waits for
+  // them before it starts a new interpreter
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_ERROR,
+      (std::string("execution of ") + Name() + " did not complete within " +
+       std::to_string(model_state_->ExecuteTimeout()) +
+       " ms, killing its Python interpreter")
+          .c_str());
+  kill(interpreter_->pid, SIGKILL);
+}
+
+void
+ModelInstanceState::RespondFromCache(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Request*>& requests = slot->requests;
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  const size_t request_count = requests.size();
+  ResponseCache* cache = model_state_->Cache();
+
+  size_t executed_count = 0;
+  slot->cache_keys.resize(request_count);
+  for (size_t r = 0; r < request_count; ++r) {
+    TRITONBACKEND_Request* request = requests[r];
+    TRITONBACKEND_Response* response = responses[r];
+    CacheKey& key = slot->cache_keys[executed_count];
+
+    TRITONSERVER_Error* err = ResponseCache::RequestKey(request, &key);
+    if (err != nullptr) {
+      key.cacheable = false;
+    }
+    LOG_IF_ERROR(err, "failed to build the response cache key of a request");
+    std::shared_ptr<const CachedResponse> cached_response;
+    if (key.cacheable) {
+      LOG_IF_ERROR(
+          cache->Lookup(key, request, &cached_response),
+          "failed to look up a response in the response cache");
+      model_state_->RecordCacheLookup(cached_response != nullptr);
+    }
+
+    if (cached_response == nullptr) {
+      requests[executed_count] = request;
+      responses[executed_count] = response;
+      ++executed_count;
+      continue;
+    }
+
+    uint64_t lookup_end_ns = 0;
+    SET_TIMESTAMP(lookup_end_ns);
+
+    err = WriteCachedResponse(response, *cached_response);
+    const bool success = (err == nullptr);
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+        "failed sending response");
+    if (err != nullptr) {
+      TRITONSERVER_ErrorDelete(err);
+    }
+
+    uint64_t exec_end_ns = 0;
+    SET_TIMESTAMP(exec_end_ns);
+
+    // A cached response doesn't run the model, so its compute time is empty
+    LOG_IF_ERROR(
+        TRITONBACKEND_ModelInstanceReportStatistics(
+            TritonModelInstance(), request, success, slot->exec_start_ns,
+            lookup_end_ns, lookup_end_ns, exec_end_ns),
+        "failed reporting request statistics");
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestRelease(request, TRITONSERVER_REQUEST_RELEASE_ALL),
+        "failed releasing request");
+  }
+
+  requests.resize(executed_count);
+  responses.resize(executed_count);
+  slot->cache_keys.resize(executed_count);
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::WriteCachedResponse(
+    TRITONBACKEND_Response* response, const CachedResponse& cached_response)
+{
+  bool cuda_copy = false;
+  for (const CachedOutput& output : cached_response) {
+    TRITONBACKEND_Output* triton_output;
+    RETURN_IF_ERROR(TRITONBACKEND_ResponseOutput(
+        response, &triton_output, output.name.c_str(), output.dtype,
+        output.shape.data(), output.shape.size()));
+
+    void* buffer;
+    TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t memory_type_id = 0;
+    RETURN_IF_ERROR(TRITONBACKEND_OutputBuffer(
+        triton_output, &buffer, output.data.size(), &memory_type,
+        &memory_type_id));
+
+    bool cuda_used = false;
+    RETURN_IF_ERROR(CopyBuffer(
+        output.name, TRITONSERVER_MEMORY_CPU, 0, memory_type, memory_type_id,
+        output.data.size(), output.data.data(), buffer, CudaStream(),
+        &cuda_used));
+    cuda_copy |= cuda_used;
+  }
+
+  // The outputs must be in their buffers before the response is sent
+  SynchronizeCudaStream(cuda_copy);
+  return nullptr;
+}
+
+void
+ModelInstanceState::PrepareExecuteRequest(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  // Tensors of the previous execution in this slot are no longer needed
+  slot->shm_pool->Reset();
+#ifdef TRITON_ENABLE_GPU
+  if (slot->cuda_pool != nullptr) {
+    slot->cuda_pool->Reset();
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  // Create ExecuteRequest
+  slot->execute_request.Clear();
+  slot->execute_request.set_shm_region_name(slot->shm_pool->Name());
+  slot->batch_size = 1;
+
+  // The inputs copied on the CUDA stream must be ready before the execution
+  // is sent to the Python model
+  bool cuda_copy = false;
+  if (model_state_->BatchedExecution()) {
+    TRITONSERVER_Error* err = PrepareBatchedExecuteRequest(slot, &cuda_copy);
+    if (err != nullptr) {
+      // Nothing is sent to the Python model, it receives an empty execution
+      slot->execute_request.clear_requests();
+      SendErrorForResponses(&responses, request_count, err);
+    }
+  }
+
+  for (uint32_t r = 0;
+       (r < request_count) && !model_state_->BatchedExecution(); ++r) {
+    TRITONBACKEND_Request* request = requests[r];
+
+    InferenceRequest* inference_request = slot->execute_request.add_requests();
+
+    uint32_t requested_input_count = 0;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_RequestInputCount(request, &requested_input_count));
+
+    uint32_t requested_output_count = 0;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_RequestOutputCount(request, &requested_output_count));
+
+    for (size_t iidx = 0; iidx < requested_input_count; ++iidx) {
+      Tensor* input_tensor = inference_request->add_inputs();
+      GUARDED_RESPOND_IF_ERROR(
+          responses, r,
+          GetInputTensor(
+              iidx, request, input_tensor, slot, responses, r, &cuda_copy));
+    }
+
+    // Append the list of requested outputs to the inference_request
+    for (size_t iidx = 0; iidx < requested_output_count; ++iidx) {
+      const char* requested_output_name;
+      GUARDED_RESPOND_IF_ERROR(
+          responses, r,
+          TRITONBACKEND_RequestOutputName(
+              request, iidx, &requested_output_name));
+
+      inference_request->add_requested_output_names(requested_output_name);
+    }
+
+    const char* id;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r, TRITONBACKEND_RequestId(request, &id));
+    inference_request->set_id(id);
+
+    uint64_t correlation_id;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_RequestCorrelationId(request, &correlation_id));
+    inference_request->set_correlation_id(correlation_id);
+
+    if (model_state_->SequenceBatching()) {
+      uint32_t sequence_flags = 0;
+      GUARDED_RESPOND_IF_ERROR(
+          responses, r, model_state_->SequenceFlags(request, &sequence_flags));
+      inference_request->set_sequence_flags(sequence_flags);
+    }
+
+    uint64_t timeout_us;
+    bool expired;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        RemainingTimeout(request, slot->receive_ns, &timeout_us, &expired));
+    inference_request->set_timeout_us(timeout_us);
+  }
+
+  SynchronizeCudaStream(cuda_copy);
+
+#ifdef TRITON_ENABLE_GPU
+  if (slot->cuda_pool != nullptr) {
+    CudaIpcMemory* cuda_pool = slot->cuda_pool.get();
+    CudaIpcRegion* cuda_ipc_region =
+        slot->execute_request.mutable_cuda_ipc_region();
+    cuda_ipc_region->set_handle(
+        reinterpret_cast<const char*>(&cuda_pool->Handle()),
+        sizeof(cudaIpcMemHandle_t));
+    cuda_ipc_region->set_device_id(cuda_pool->DeviceId());
+    cuda_ipc_region->set_byte_size(cuda_pool->ByteSize());
+    cuda_ipc_region->set_used(cuda_pool->Used());
+  }
+#endif  // TRITON_ENABLE_GPU
+
+  if (model_state_->FlatRequests()) {
+    PrepareFlatExecuteRequest(slot);
+  }
+}
+
+const ExecuteRequest&
+ModelInstanceState::ExecuteRequestMessage(ExecuteSlot* slot) const
+{
+  return model_state_->FlatRequests() ? slot->flat_execute_request
+                                      : slot->execute_request;
+}
+
+void
+ModelInstanceState::PrepareFlatExecuteRequest(ExecuteSlot* slot)
+{
+  ExecuteRequest& flat_execute_request = slot->flat_execute_request;
+  flat_execute_request.Clear();
+  flat_execute_request.set_shm_region_name(
+      slot->execute_request.shm_region_name());
+  if (slot->execute_request.has_cuda_ipc_region()) {
+    *flat_execute_request.mutable_cuda_ipc_region() =
+        slot->execute_request.cuda_ipc_region();
+  }
+
+  // The interpreter receives an empty execution if all the requests failed
+  if (slot->execute_request.requests_size() == 0) {
+    return;
+  }
+
+  uint64_t offset;
+  uint64_t byte_size;
+  TRITONSERVER_Error* err = slot->flat_request_writer.Write(
+      slot->execute_request.requests(), slot->shm_pool.get(), &offset,
+      &byte_size);
+  if (err != nullptr) {
+    slot->execute_request.clear_requests();
+    SendErrorForResponses(&slot->responses, slot->requests.size(), err);
+    return;
+  }
+
+  flat_execute_request.set_flat_requests_offset(offset);
+  flat_execute_request.set_flat_requests_byte_size(byte_size);
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::PrepareBatchedExecuteRequest(
+    ExecuteSlot* slot, bool* cuda_copy)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  InferenceRequest* inference_request = slot->execute_request.add_requests();
+
+  TRITONBACKEND_Request* first_request = requests[0];
+  uint32_t input_count = 0;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestInputCount(first_request, &input_count));
+
+  slot->request_batch_sizes.clear();
+  for (uint32_t iidx = 0; iidx < input_count; ++iidx) {
+    const char* input_name;
+    RETURN_IF_ERROR(
+        TRITONBACKEND_RequestInputName(first_request, iidx, &input_name));
+
+    TRITONSERVER_DataType batched_dtype = TRITONSERVER_TYPE_INVALID;
+    std::vector<int64_t> batched_shape;
+    uint64_t batched_byte_size = 0;
+    for (uint32_t r = 0; r < request_count; ++r) {
+      TRITONBACKEND_Input* input;
+      RETURN_IF_ERROR(
+          TRITONBACKEND_RequestInput(requests[r], input_name, &input));
+
+      TRITONSERVER_DataType input_dtype;
+      const int64_t* input_shape;
+      uint32_t input_dims_count;
+      uint64_t input_byte_size;
+      RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+          input, nullptr, &input_dtype, &input_shape, &input_dims_count,
+          &input_byte_size, nullptr));
+
+      if (input_dims_count == 0) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("input '") + input_name +
+             "' must have a batch dimension")
+                .c_str());
+      }
+
+      if (r == 0) {
+        batched_dtype = input_dtype;
+        batched_shape.assign(input_shape, input_shape + input_dims_count);
+      } else {
+        if ((input_dtype != batched_dtype) ||
+            (input_dims_count != batched_shape.size()) ||
+            !std::equal(
+                input_shape + 1, input_shape + input_dims_count,
+                batched_shape.begin() + 1)) {
+          return TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INVALID_ARG,
+              (std::string("input '") + input_name +
+               "' has a different datatype or shape across the requests of "
+               "the batch")
+                  .c_str());
+        }
+        batched_shape[0] += input_shape[0];
+      }
+
+      if (iidx == 0) {
+        slot->request_batch_sizes.push_back(input_shape[0]);
+      }
+      batched_byte_size += input_byte_size;
+    }
+
+    if (iidx == 0) {
+      slot->batch_size = batched_shape[0];
+    }
+
+    Tensor* input_tensor = inference_request->add_inputs();
+    input_tensor->set_name(input_name);
+    input_tensor->set_dtype(static_cast<int>(batched_dtype));
+    for (const int64_t dim : batched_shape) {
+      input_tensor->add_dims(dim);
+    }
+
+    // The location of the combined input follows the input of the first
+    // request
+    TRITONBACKEND_Input* first_input;
+    RETURN_IF_ERROR(
+        TRITONBACKEND_RequestInput(first_request, input_name, &first_input));
+    char* input_buffer;
+    RETURN_IF_ERROR(AllocateInputBuffer(
+        slot, first_input, batched_byte_size, input_tensor, &input_buffer));
+
+    // Allocating the next input may remap the shared memory region, so the
+    // copies into this one are finished before that
+    BackendInputCollector collector(
+        requests, request_count, &responses, Model()->TritonMemoryManager(),
+        model_state_->EnablePinnedInput(), CudaStream());
+    collector.ProcessTensor(
+        input_name, input_buffer, batched_byte_size,
+        static_cast<TRITONSERVER_MemoryType>(input_tensor->memory_type()),
+        input_tensor->memory_type_id());
+    *cuda_copy |= collector.Finalize();
+  }
+
+  // Ask for every output that is requested by at least one of the requests
+  std::unordered_set<std::string> requested_output_names;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    uint32_t requested_output_count = 0;
+    RETURN_IF_ERROR(
+        TRITONBACKEND_RequestOutputCount(requests[r], &requested_output_count));
+    for (uint32_t oidx = 0; oidx < requested_output_count; ++oidx) {
+      const char* requested_output_name;
+      RETURN_IF_ERROR(TRITONBACKEND_RequestOutputName(
+          requests[r], oidx, &requested_output_name));
+      if (requested_output_names.insert(requested_output_name).second) {
+        inference_request->add_requested_output_names(requested_output_name);
+      }
+    }
+  }
+
+  const char* id;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestId(first_request, &id));
+  inference_request->set_id(id);
+
+  uint64_t correlation_id;
+  RETURN_IF_ERROR(
+      TRITONBACKEND_RequestCorrelationId(first_request, &correlation_id));
+  inference_request->set_correlation_id(correlation_id);
+
+  return nullptr;
+}
+
+void
+ExecuteSlot::Complete(const bool ok)
+{
+  instance->HandleCompletion(this, ok);
+}
+
+void
+ModelInstanceState::HandleCompletion(ExecuteSlot* slot, const bool ok)
+{
+  if (model_state_->IsDecoupled()) {
+    ProcessStreamEvent(slot, ok);
+    return;
+  }
+  if (!ok) {
+    slot->status =
+        grpc::Status(grpc::StatusCode::CANCELLED, "execution was cancelled");
+  }
+  ProcessResponses(slot);
+}
+
+void
+ModelInstanceState::ProcessResponses(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  uint64_t compute_end_ns = 0;
+  SET_TIMESTAMP(compute_end_ns);
+
+  // If inference fails, release all the requests and send an error response If
+  // inference fails at this stage, it usually indicates a bug in the model code
+  if (!slot->status.ok()) {
+    AbortTimedOutExecution(slot);
+    for (uint32_t r = 0; r < request_count; ++r) {
+      if (responses[r] == nullptr) {
+        continue;
+      }
+      TRITONSERVER_Error* err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          ("GRPC Execute Failed, message: " +
+           std::string(slot->status.error_message()))
+              .c_str());
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+          "failed sending response");
+      responses[r] = nullptr;
+      TRITONSERVER_ErrorDelete(err);
+    }
+
+    for (uint32_t r = 0; r < request_count; ++r) {
+      TRITONBACKEND_Request* request = requests[r];
+      LOG_IF_ERROR(
+          TRITONBACKEND_ModelInstanceReportStatistics(
+              TritonModelInstance(), request, false /* success */,
+              slot->exec_start_ns, slot->compute_start_ns, compute_end_ns,
+              compute_end_ns),
+          "failed reporting request statistics");
+
+      LOG_IF_ERROR(
+          TRITONBACKEND_RequestRelease(
+              request, TRITONSERVER_REQUEST_RELEASE_ALL),
+          "failed releasing request");
+    }
+
+    ReleaseSlot(slot);
+    return;
+  }
+
+  if (model_state_->BatchedExecution()) {
+    ProcessBatchedResponse(slot);
+  } else if (
+      slot->execute_response.responses_size() !=
+      static_cast<int>(request_count)) {
+    SendErrorForResponses(
+        &responses, request_count,
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            (std::string("expected ") + std::to_string(request_count) +
+             " responses, got " +
+             std::to_string(slot->execute_response.responses_size()))
+                .c_str()));
+  }
+
+  for (uint32_t r = 0;
+       (r < request_count) && !model_state_->BatchedExecution(); ++r) {
+    // The request failed before or while it was sent to the Python model
+    if (responses[r] == nullptr) {
+      continue;
+    }
+
+    SendResponse(
+        slot, r, slot->execute_response.responses(r),
+        TRITONSERVER_RESPONSE_COMPLETE_FINAL);
+  }
+
+  FinishExecution(slot, compute_end_ns);
+}
+
+bool
+ModelInstanceState::SendResponse(
+    ExecuteSlot* slot, const uint32_t r,
+    const InferenceResponse& inference_response, const uint32_t send_flags)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Response* response = responses[r];
+  TRITONBACKEND_Request* request = slot->requests[r];
+  uint32_t requested_output_count = 0;
+
+  // The outputs are also kept in the response cache when the model has one,
+  // unless some of them are in GPU memory
+  bool cache_response =
+      (r < slot->cache_keys.size()) && slot->cache_keys[r].cacheable;
+  CachedResponse cached_response;
+
+  if (inference_response.failed()) {
+    TRITONSERVER_Error* err = TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (inference_response.error().message()).c_str());
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseSend(
+            responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+        "failed sending response");
+    responses[r] = nullptr;
+    TRITONSERVER_ErrorDelete(err);
+
+    // If has_error is true, we do not look at the response even if the
+    // response is set.
+    return false;
+  }
+
+  GUARDED_RESPOND_IF_ERROR(
+      responses, r,
+      TRITONBACKEND_RequestOutputCount(request, &requested_output_count));
+  slot->output_index.Build(inference_response);
+
+  bool cuda_copy = false;
+  for (size_t j = 0; j < requested_output_count; ++j) {
+    const char* requested_output_name;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_RequestOutputName(request, j, &requested_output_name));
+    if (responses[r] == nullptr) {
+      break;
+    }
+
+    // Continue to the next output if the model didn't return the requested
+    // one
+    const Tensor* output = slot->output_index.Find(requested_output_name);
+    if (output == nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_ERROR,
+          (std::string("can't find output tensor with name ") +
+           requested_output_name)
+              .c_str());
+      // The incomplete response must not be replayed to the later requests
+      cache_response = false;
+      continue;
+    }
+
+    // Prepare output buffers.
+    const Tensor& python_output_result = *output;
+    TRITONBACKEND_Output* triton_output;
+    TRITONSERVER_DataType triton_dt =
+        static_cast<TRITONSERVER_DataType>(python_output_result.dtype());
+
+    const auto& python_output_dims = python_output_result.dims();
+    const std::string& output_tensor_name = python_output_result.name();
+
+    uint32_t dims_count = python_output_dims.size();
+
+    // The Python model may have left the output on the GPU, the Triton
+    // output buffer is requested in the same memory so that the copy
+    // doesn't go through the host.
+    char* output_data = nullptr;
+    TRITONSERVER_MemoryType output_data_memory_type;
+    int64_t output_data_memory_type_id;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        OutputTensorBuffer(
+            slot, python_output_result, &output_data,
+            &output_data_memory_type, &output_data_memory_type_id));
+
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_ResponseOutput(
+            response, &triton_output, output_tensor_name.c_str(),
+            triton_dt, python_output_dims.data(), dims_count));
+
+    int64_t output_byte_size;
+
+    // Custom handling for TRITONSERVER_TYPE_BYTES
+    if (triton_dt == TRITONSERVER_TYPE_BYTES) {
+      output_byte_size = python_output_result.byte_size();
+    } else {
+      output_byte_size = TRITONSERVER_DataTypeByteSize(triton_dt);
+      for (const int64_t dim : python_output_dims) {
+        output_byte_size *= dim;
+      }
+    }
+
+    if ((responses[r] != nullptr) &&
+        (python_output_result.byte_size() !=
+         static_cast<uint64_t>(output_byte_size))) {
+      GUARDED_RESPOND_IF_ERROR(
+          responses, r,
+          TRITONSERVER_ErrorNew(
+              TRITONSERVER_ERROR_INTERNAL,
+              (std::string("output tensor '") + output_tensor_name +
+               "' has " + std::to_string(python_output_result.byte_size()) +
+               " bytes, expected " + std::to_string(output_byte_size))
+                  .c_str()));
+    }
+
+    void* output_buffer;
+    TRITONSERVER_MemoryType output_memory_type = output_data_memory_type;
+    int64_t output_memory_type_id = output_data_memory_type_id;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_OutputBuffer(
+            triton_output, &output_buffer, output_byte_size,
+            &output_memory_type, &output_memory_type_id));
+
+    if (responses[r] == nullptr) {
+      TRITONSERVER_LogMessage(
+          TRITONSERVER_LOG_ERROR, __FILE__, __LINE__,
+          (std::string("request ") + std::to_string(r) +
+           ": failed to create output buffer.")
+              .c_str());
+      continue;
+    }
+
+    // Copy the Python output from the shared memory region or the CUDA IPC
+    // memory to the Triton output buffer
+    bool cuda_used = false;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        CopyBuffer(
+            output_tensor_name, output_data_memory_type,
+            output_data_memory_type_id, output_memory_type,
+            output_memory_type_id, output_byte_size, output_data,
+            output_buffer, CudaStream(), &cuda_used));
+    cuda_copy |= cuda_used;
+
+    if (cache_response && (responses[r] != nullptr)) {
+      if (output_data_memory_type == TRITONSERVER_MEMORY_GPU) {
+        cache_response = false;
+      } else {
+        cached_response.push_back(CachedOutput{
+            output_tensor_name, triton_dt,
+            std::vector<int64_t>(
+                python_output_dims.begin(), python_output_dims.end()),
+            std::string(output_data, output_byte_size)});
+      }
+    }
+  }
+
+  // The outputs must be in their buffers before the response is sent
+  SynchronizeCudaStream(cuda_copy);
+
+  if (responses[r] == nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_ERROR, (std::string("Request ") + std::to_string(r) +
+                                 ": failed to create output response")
+                                    .c_str());
+    return false;
+  }
+
+  // If error happens at this stage, we can only log it
+  LOG_IF_ERROR(
+      TRITONBACKEND_ResponseSend(responses[r], send_flags, nullptr),
+      "failed sending response");
+
+  if (cache_response) {
+    LOG_IF_ERROR(
+        model_state_->Cache()->Insert(
+            slot->cache_keys[r], request, std::move(cached_response)),
+        "failed to cache a response");
+  }
+  return true;
+}
+
+void
+ModelInstanceState::FinishExecution(
+    ExecuteSlot* slot, const uint64_t compute_end_ns)
+{
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  uint64_t exec_end_ns = 0;
+  SET_TIMESTAMP(exec_end_ns);
+
+  uint64_t infer_start_ns;
+  uint64_t infer_end_ns;
+  ReportExecutionStages(
+      slot, compute_end_ns, exec_end_ns, &infer_start_ns, &infer_end_ns);
+
+  for (uint32_t r = 0; r < request_count; ++r) {
+    TRITONBACKEND_Request* request = requests[r];
+    const bool success = model_state_->IsDecoupled()
+                             ? !slot->request_failed[r]
+                             : (slot->responses[r] != nullptr);
+
+    // Report statistics for the request. Note that there could
+    // still be responses that have not yet been sent but those
+    // cannot be captured in the statistics as they reflect only the
+    // request object. Only the time spent in the execute function of the
+    // model is reported as compute, the transfer to and from the
+    // interpreter is part of the input and output time.
+    LOG_IF_ERROR(
+        TRITONBACKEND_ModelInstanceReportStatistics(
+            TritonModelInstance(), request, success, slot->exec_start_ns,
+            infer_start_ns, infer_end_ns, exec_end_ns),
+        "failed reporting request statistics");
+
+    LOG_IF_ERROR(
+        TRITONBACKEND_RequestRelease(request, TRITONSERVER_REQUEST_RELEASE_ALL),
+        "failed releasing request");
+  }
+
+  // Report the entire batch statistics. Unless the requests are combined,
+  // each one is sent to the Python model individually so the total batch
+  // size is 1.
+  LOG_IF_ERROR(
+      TRITONBACKEND_ModelInstanceReportBatchStatistics(
+          TritonModelInstance(), slot->batch_size, slot->exec_start_ns,
+          infer_start_ns, infer_end_ns, exec_end_ns),
+      "failed reporting batch request statistics");
+
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_VERBOSE,
+      (std::string("TRITONBACKEND_ModelInstanceExecute: model instance name ") +
+       Name() + " released " + std::to_string(request_count) + " requests")
+          .c_str());
+
+  ReleaseSlot(slot);
+}
+
+void
+ModelInstanceState::ExecuteStream(ExecuteSlot* slot)
+{
+  // The responses created for the errors found while the requests were
+  // prepared are replaced by a factory for every request that is executed,
+  // so that the model can send any number of responses for it.
+  const uint32_t request_count = slot->requests.size();
+  slot->response_factories.assign(request_count, nullptr);
+  slot->request_failed.assign(request_count, true);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    GUARDED_RESPOND_IF_ERROR(
+        slot->responses, r,
+        TRITONBACKEND_ResponseFactoryNew(
+            &slot->response_factories[r], slot->requests[r]));
+    if (slot->responses[r] == nullptr) {
+      slot->response_factories[r] = nullptr;
+      continue;
+    }
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseDelete(slot->responses[r]),
+        "failed deleting response");
+    slot->responses[r] = nullptr;
+    slot->request_failed[r] = false;
+  }
+
+  if (slots_.size() == 1) {
+    slot->stream_reader =
+        stub->ExecuteStream(slot->context.get(), ExecuteRequestMessage(slot));
+    while (slot->stream_reader->Read(&slot->stream_response)) {
+      ProcessStreamResponse(slot);
+    }
+    slot->status = slot->stream_reader->Finish();
+    FinishStream(slot);
+  } else {
+    // HandleCompletion reads the stream as the messages arrive
+    slot->stream_operation = STREAM_START;
+    slot->async_stream_reader = stub->AsyncExecuteStream(
+        slot->context.get(), ExecuteRequestMessage(slot), completion_queue_,
+        slot->Tag());
+  }
+}
+
+void
+ModelInstanceState::ProcessStreamEvent(ExecuteSlot* slot, const bool ok)
+{
+  switch (slot->stream_operation) {
+    case STREAM_START:
+    case STREAM_READ:
+      if (ok && (slot->stream_operation == STREAM_READ)) {
+        ProcessStreamResponse(slot);
+      }
+      if (ok) {
+        slot->stream_operation = STREAM_READ;
+        slot->async_stream_reader->Read(&slot->stream_response, slot->Tag());
+      } else {
+        // The stream has ended, get its status
+        slot->stream_operation = STREAM_FINISH;
+        slot->async_stream_reader->Finish(&slot->status, slot->Tag());
+      }
+      break;
+    case STREAM_FINISH:
+      if (!ok) {
+        slot->status = grpc::Status(
+            grpc::StatusCode::CANCELLED, "execution was cancelled");
+      }
+      FinishStream(slot);
+      break;
+  }
+}
+
+void
+ModelInstanceState::ProcessStreamResponse(ExecuteSlot* slot)
+{
+  const ExecuteStreamResponse& stream_response = slot->stream_response;
+  if (stream_response.has_timings()) {
+    *slot->execute_response.mutable_timings() = stream_response.timings();
+  }
+  if (!stream_response.has_response() && !stream_response.final()) {
+    return;
+  }
+
+  // The responses of the requests that failed or are already complete are
+  // dropped
+  const uint32_t r = stream_response.request_index();
+  if ((r >= slot->response_factories.size()) ||
+      (slot->response_factories[r] == nullptr)) {
+    return;
+  }
+
+  TRITONBACKEND_ResponseFactory* factory = slot->response_factories[r];
+  bool complete = stream_response.final();
+  if (stream_response.has_response()) {
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_ResponseNewFromFactory(&slot->responses[r], factory);
+    if (err != nullptr) {
+      LOG_IF_ERROR(err, "failed to create response");
+      return;
+    }
+    if (!SendResponse(
+            slot, r, stream_response.response(),
+            complete ? TRITONSERVER_RESPONSE_COMPLETE_FINAL : 0)) {
+      slot->request_failed[r] = true;
+      complete = true;
+    }
+    slot->responses[r] = nullptr;
+  } else {
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseFactorySendFlags(
+            factory, TRITONSERVER_RESPONSE_COMPLETE_FINAL),
+        "failed sending the final flag of a response");
+  }
+
+  if (complete) {
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseFactoryDelete(factory),
+        "failed deleting response factory");
+    slot->response_factories[r] = nullptr;
+  }
+}
+
+void
+ModelInstanceState::FinishStream(ExecuteSlot* slot)
+{
+  uint64_t compute_end_ns = 0;
+  SET_TIMESTAMP(compute_end_ns);
+  AbortTimedOutExecution(slot);
+
+  // The execute of a cancelled stream may still be running and writing to
+  // the shared memory region of the slot, so the interpreter is restarted
+  // before the region is used again
+  if (slot->status.error_code() == grpc::StatusCode::CANCELLED) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_ERROR,
+        (std::string("decoupled execution of ") + Name() +
+         " was cancelled, killing its Python interpreter")
+            .c_str());
+    kill(interpreter_->pid, SIGKILL);
+  }
+
+  const std::string message =
+      slot->status.ok()
+          ? std::string("the Python model completed the execution without "
+                        "sending the final response of the request")
+          : ("GRPC Execute Failed, message: " + slot->status.error_message());
+  for (size_t r = 0; r < slot->response_factories.size(); ++r) {
+    TRITONBACKEND_ResponseFactory* factory = slot->response_factories[r];
+    if (factory == nullptr) {
+      continue;
+    }
+
+    TRITONBACKEND_Response* response;
+    TRITONSERVER_Error* err =
+        TRITONBACKEND_ResponseNewFromFactory(&response, factory);
+    if (err != nullptr) {
+      LOG_IF_ERROR(err, "failed to create response");
+    } else {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL, message.c_str());
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              response, TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
+          "failed sending response");
+      TRITONSERVER_ErrorDelete(err);
+    }
+
+    LOG_IF_ERROR(
+        TRITONBACKEND_ResponseFactoryDelete(factory),
+        "failed deleting response factory");
+    slot->response_factories[r] = nullptr;
+    slot->request_failed[r] = true;
+  }
+
+  FinishExecution(slot, compute_end_ns);
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::CreateBufferPool()
+{
+  // The staged data often comes from or goes to GPU memory, which is copied
+  // faster from and to pinned memory
+  std::vector<BackendMemory::AllocationType> alloc_types;
+#ifdef TRITON_ENABLE_GPU
+  alloc_types.push_back(BackendMemory::AllocationType::CPU_PINNED);
+#endif  // TRITON_ENABLE_GPU
+  alloc_types.push_back(BackendMemory::AllocationType::CPU);
+  RETURN_IF_ERROR(BufferPool::Create(
+      Model()->TritonMemoryManager(), alloc_types,
+      model_state_->BufferPoolByteSize(), &buffer_pool_));
+
+  if (model_state_->StateForBackend()->buffer_pool_size_family != nullptr) {
+    LOG_IF_ERROR(
+        CreateBufferPoolMetrics(), "failed to create the buffer pool metrics");
+  }
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::CreateBufferPoolMetrics()
+{
+  BackendState* backend_state = model_state_->StateForBackend();
+  const std::string version = std::to_string(model_state_->Version());
+  TRITONSERVER_Metric* metrics[3] = {nullptr, nullptr, nullptr};
+  const char* const results[2] = {"hit", "miss"};
+  TRITONSERVER_Error* err = nullptr;
+  for (int i = 0; (i < 3) && (err == nullptr); ++i) {
+    std::vector<const TRITONSERVER_Parameter*> labels{
+        TRITONSERVER_ParameterNew(
+            "model", TRITONSERVER_PARAMETER_STRING,
+            model_state_->Name().c_str()),
+        TRITONSERVER_ParameterNew(
+            "version", TRITONSERVER_PARAMETER_STRING, version.c_str()),
+        TRITONSERVER_ParameterNew(
+            "instance", TRITONSERVER_PARAMETER_STRING, Name().c_str())};
+    TRITONSERVER_MetricFamily* family = backend_state->buffer_pool_size_family;
+    if (i < 2) {
+      labels.push_back(TRITONSERVER_ParameterNew(
+          "result", TRITONSERVER_PARAMETER_STRING, results[i]));
+      family = backend_state->buffer_pool_acquisition_family;
+    }
+
+    err = TRITONSERVER_MetricNew(
+        &metrics[i], family, labels.data(), labels.size());
+    for (const TRITONSERVER_Parameter* label : labels) {
+      TRITONSERVER_ParameterDelete(const_cast<TRITONSERVER_Parameter*>(label));
+    }
+  }
+
+  for (TRITONSERVER_Metric* metric : metrics) {
+    if (metric != nullptr) {
+      buffer_pool_metrics_.push_back(metric);
+    }
+  }
+  RETURN_IF_ERROR(err);
+  buffer_pool_->SetMetrics(metrics[0], metrics[1], metrics[2]);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::CreateStageMetrics()
+{
+  const std::string version = std::to_string(model_state_->Version());
+  for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+    const TRITONSERVER_Parameter* labels[] = {
+        TRITONSERVER_ParameterNew(
+            "model", TRITONSERVER_PARAMETER_STRING,
+            model_state_->Name().c_str()),
+        TRITONSERVER_ParameterNew(
+            "version", TRITONSERVER_PARAMETER_STRING, version.c_str()),
+        TRITONSERVER_ParameterNew(
+            "instance", TRITONSERVER_PARAMETER_STRING, Name().c_str()),
+        TRITONSERVER_ParameterNew(
+            "stage", TRITONSERVER_PARAMETER_STRING,
+            EXECUTION_STAGE_NAMES[stage])};
+    constexpr uint64_t label_count = sizeof(labels) / sizeof(labels[0]);
+
+    TRITONSERVER_Metric* metric = nullptr;
+    TRITONSERVER_Error* err = TRITONSERVER_MetricNew(
+        &metric, model_state_->StateForBackend()->stage_duration_family,
+        labels, label_count);
+    for (const TRITONSERVER_Parameter* label : labels) {
+      TRITONSERVER_ParameterDelete(const_cast<TRITONSERVER_Parameter*>(label));
+    }
+    RETURN_IF_ERROR(err);
+    stage_metrics_.push_back(metric);
+  }
+
+  return nullptr;
+}
+
+void
+ModelInstanceState::ReportExecutionStages(
+    ExecuteSlot* slot, const uint64_t compute_end_ns,
+    const uint64_t exec_end_ns, uint64_t* infer_start_ns,
+    uint64_t* infer_end_ns)
+{
+  const ExecuteTimings& timings = slot->execute_response.timings();
+  const uint64_t round_trip_ns = compute_end_ns - slot->compute_start_ns;
+  const uint64_t python_ns =
+      timings.input_ns() + timings.compute_ns() + timings.output_ns();
+
+  // The interpreter measures durations with its own clock, so they are
+  // placed in the round trip assuming that the transfer takes the same time
+  // in both directions. Without timings the whole round trip is compute.
+  uint64_t stage_ns[STAGE_COUNT];
+  stage_ns[STAGE_PREPARE] = slot->compute_start_ns - slot->exec_start_ns;
+  stage_ns[STAGE_TRANSPORT] =
+      (python_ns < round_trip_ns) ? (round_trip_ns - python_ns) : 0;
+  stage_ns[STAGE_PYTHON_INPUT] = timings.input_ns();
+  stage_ns[STAGE_PYTHON_COMPUTE] = timings.compute_ns();
+  stage_ns[STAGE_PYTHON_OUTPUT] = timings.output_ns();
+  stage_ns[STAGE_RESPONSE] = exec_end_ns - compute_end_ns;
+
+  if ((python_ns == 0) || (python_ns > round_trip_ns)) {
+    *infer_start_ns = slot->compute_start_ns;
+    *infer_end_ns = compute_end_ns;
+  } else {
+    *infer_start_ns = slot->compute_start_ns +
+                      (stage_ns[STAGE_TRANSPORT] / 2) + timings.input_ns();
+    *infer_end_ns = *infer_start_ns + timings.compute_ns();
+  }
+
+  for (size_t stage = 0; stage < stage_metrics_.size(); ++stage) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricIncrement(
+            stage_metrics_[stage], stage_ns[stage] / 1000.0),
+        "failed to update a stage duration metric");
+  }
+
+  if (TRITONSERVER_LogIsEnabled(TRITONSERVER_LOG_VERBOSE)) {
+    std::string trace = std::string("execution of ") + Name() + " with " +
+                        std::to_string(slot->requests.size()) +
+                        " requests took";
+    for (int stage = 0; stage < STAGE_COUNT; ++stage) {
+      trace += std::string(" ") + EXECUTION_STAGE_NAMES[stage] + "=" +
+               std::to_string(stage_ns[stage] / 1000) + "us";
+    }
+    LOG_MESSAGE(TRITONSERVER_LOG_VERBOSE, trace.c_str());
+  }
+}
+
+void
+ModelInstanceState::ProcessBatchedResponse(ExecuteSlot* slot)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  // The requests have already failed while the inputs were combined
+  if (slot->execute_request.requests_size() == 0) {
+    return;
+  }
+
+  if (slot->execute_response.responses_size() != 1) {
+    SendErrorForResponses(
+        &responses, request_count,
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            "expected a single response for the batched request"));
+    return;
+  }
+
+  const InferenceResponse& inference_response =
+      slot->execute_response.responses(0);
+  if (inference_response.failed()) {
+    SendErrorForResponses(
+        &responses, request_count,
+        TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            inference_response.error().message().c_str()));
+    return;
+  }
+
+  BackendOutputResponder responder(
+      requests, request_count, &responses, Model()->TritonMemoryManager(),
+      true /* first_dim_batching */, model_state_->EnablePinnedOutput(),
+      CudaStream());
+
+  for (const Tensor& output : inference_response.outputs()) {
+    TRITONSERVER_Error* err = nullptr;
+    if ((output.dims_size() == 0) ||
+        (output.dims(0) != static_cast<int64_t>(slot->batch_size))) {
+      err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("output '") + output.name() +
+           "' must have a batch dimension of " +
+           std::to_string(slot->batch_size))
+              .c_str());
+    }
+
+    char* output_data = nullptr;
+    TRITONSERVER_MemoryType output_memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t output_memory_type_id = 0;
+    if (err == nullptr) {
+      err = OutputTensorBuffer(
+          slot, output, &output_data, &output_memory_type,
+          &output_memory_type_id);
+    }
+
+    // The elements of BYTES outputs are always in the shared memory region
+    const TRITONSERVER_DataType output_dtype =
+        static_cast<TRITONSERVER_DataType>(output.dtype());
+    if ((err == nullptr) && (output_dtype == TRITONSERVER_TYPE_BYTES)) {
+      err = ScatterBytesOutput(slot, output, output_data);
+    }
+
+    // The responder reads the size given by the dims, which may not match
+    // the data of the output
+    if ((err == nullptr) && (output_dtype != TRITONSERVER_TYPE_BYTES)) {
+      uint64_t output_byte_size = TRITONSERVER_DataTypeByteSize(output_dtype);
+      for (const int64_t dim : output.dims()) {
+        output_byte_size *= dim;
+      }
+      if (output.byte_size() != output_byte_size) {
+        err = TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            (std::string("output tensor '") + output.name() + "' has " +
+             std::to_string(output.byte_size()) + " bytes, expected " +
+             std::to_string(output_byte_size))
+                .c_str());
+      }
+    }
+
+    if (err != nullptr) {
+      SendErrorForResponses(&responses, request_count, err);
+      // The copies of the previous outputs may still be queued
+      SynchronizeCudaStream(responder.Finalize());
+      return;
+    }
+
+    if (output_dtype != TRITONSERVER_TYPE_BYTES) {
+      std::vector<int64_t> batchn_shape(
+          output.dims().begin(), output.dims().end());
+      responder.ProcessTensor(
+          output.name(), output_dtype, batchn_shape, output_data,
+          output_memory_type, output_memory_type_id);
+    }
+  }
+  SynchronizeCudaStream(responder.Finalize());
+
+  for (uint32_t r = 0; r < request_count; ++r) {
+    if (responses[r] != nullptr) {
+      // If error happens at this stage, we can only log it
+      LOG_IF_ERROR(
+          TRITONBACKEND_ResponseSend(
+              responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, nullptr),
+          "failed sending response");
+    }
+  }
+}
+
+TRITONSERVER_Error*
+ModelInstanceState::ScatterBytesOutput(
+    ExecuteSlot* slot, const Tensor& output, const char* output_data)
+{
+  std::vector<TRITONBACKEND_Response*>& responses = slot->responses;
+  TRITONBACKEND_Request** requests = slot->requests.data();
+  const uint32_t request_count = slot->requests.size();
+
+  int64_t element_count_per_batch = 1;
+  for (int i = 1; i < output.dims_size(); ++i) {
+    element_count_per_batch *= output.dims(i);
+  }
+
+  bool cuda_copy = false;
+  uint64_t offset = 0;
+  for (uint32_t r = 0; r < request_count; ++r) {
+    // Find the serialized elements of this request, every element is
+    // prefixed with its 4-byte length
+    const uint64_t request_offset = offset;
+    const int64_t element_count =
+        slot->request_batch_sizes[r] * element_count_per_batch;
+    for (int64_t e = 0; e < element_count; ++e) {
+      if ((offset + sizeof(uint32_t)) > output.byte_size()) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INTERNAL,
+            (std::string("output '") + output.name() +
+             "' has fewer elements than expected")
+                .c_str());
+      }
+      uint32_t element_byte_size;
+      memcpy(&element_byte_size, output_data + offset, sizeof(uint32_t));
+      offset += sizeof(uint32_t) + element_byte_size;
+    }
+    if (offset > output.byte_size()) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("output '") + output.name() + "' is malformed")
+              .c_str());
+    }
+
+    if ((responses[r] == nullptr) ||
+        !IsOutputRequested(requests[r], output.name())) {
+      continue;
+    }
+
+    std::vector<int64_t> request_shape(
+        output.dims().begin(), output.dims().end());
+    request_shape[0] = slot->request_batch_sizes[r];
+
+    TRITONBACKEND_Output* triton_output;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_ResponseOutput(
+            responses[r], &triton_output, output.name().c_str(),
+            TRITONSERVER_TYPE_BYTES, request_shape.data(),
+            request_shape.size()));
+
+    void* output_buffer;
+    TRITONSERVER_MemoryType output_memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t output_memory_type_id = 0;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        TRITONBACKEND_OutputBuffer(
+            triton_output, &output_buffer, offset - request_offset,
+            &output_memory_type, &output_memory_type_id));
+
+    bool cuda_used = false;
+    GUARDED_RESPOND_IF_ERROR(
+        responses, r,
+        CopyBuffer(
+            output.name(), TRITONSERVER_MEMORY_CPU, 0, output_memory_type,
+            output_memory_type_id, offset - request_offset,
+            output_data + request_offset, output_buffer, CudaStream(),
+            &cuda_used));
+    cuda_copy |= cuda_used;
+  }
+
+  SynchronizeCudaStream(cuda_copy);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::Create(TRITONBACKEND_Model* triton_model, ModelState** state)
+{
+  try {
+    *state = new ModelState(triton_model);
+  }
+  catch (const BackendModelException& ex) {
+    RETURN_ERROR_IF_TRUE(
+        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
+        std::string("unexpected nullptr in BackendModelException"));
+    RETURN_IF_ERROR(ex.err_);
+  }
+
+  return nullptr;  // success
+}
+
+ModelState::ModelState(TRITONBACKEND_Model* triton_model)
+    : BackendModel(triton_model), pipeline_depth_(1), worker_count_(1),
+      worker_type_("thread"), batched_execution_(false),
+      enable_cuda_ipc_(false), flat_requests_(false), warm_spare_count_(0),
+      decoupled_(false), interpreter_mode_("process"),
+      sequence_batching_(false), cpu_affinity_policy_("none"),
+      interpreter_thread_count_(0), placement_index_(0),
+      execute_timeout_ms_(0), buffer_pool_byte_size_(64 * 1024 * 1024),
+      scheduling_policy_("fifo"), large_request_byte_size_(1024 * 1024)
+{
+  TRITONBACKEND_Backend* backend;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      TRITONBACKEND_ModelBackend(triton_model, &backend));
+
+  const char* path = nullptr;
+  TRITONBACKEND_ArtifactType artifact_type;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      TRITONBACKEND_ModelRepository(triton_model, &artifact_type, &path));
+
+  void* bstate;
+  THROW_IF_BACKEND_MODEL_ERROR(TRITONBACKEND_BackendState(backend, &bstate));
+  backend_state_ = reinterpret_cast<BackendState*>(bstate);
+
+  if (artifact_type != TRITONBACKEND_ARTIFACT_FILESYSTEM) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNSUPPORTED,
+        (std::string("unsupported artifact type for model '") + Name() + "'")
+            .c_str()));
+  }
+
+  std::string worker_count;
+  THROW_IF_BACKEND_MODEL_ERROR(ReadParameter("WORKER_COUNT", &worker_count));
+  if (!worker_count.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(worker_count, &worker_count_));
+    if (worker_count_ < 1) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("WORKER_COUNT must be at least 1 for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  THROW_IF_BACKEND_MODEL_ERROR(ReadParameter("WORKER_TYPE", &worker_type_));
+  if ((worker_type_ != "thread") && (worker_type_ != "process")) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("WORKER_TYPE must be 'thread' or 'process' for model '") +
+         Name() + "'")
+            .c_str()));
+  }
+
+  std::string batched_execution;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("BATCHED_EXECUTION", &batched_execution));
+  if (!batched_execution.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseBoolValue(batched_execution, &batched_execution_));
+    if (batched_execution_ && (MaxBatchSize() <= 0)) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("BATCHED_EXECUTION requires max_batch_size > 0 for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  triton::common::TritonJson::Value transaction_policy;
+  if (ModelConfig().Find("model_transaction_policy", &transaction_policy)) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        transaction_policy.MemberAsBool("decoupled", &decoupled_));
+    if (decoupled_ && batched_execution_) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("BATCHED_EXECUTION can't be used with the decoupled "
+                       "transaction policy for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  // Only read by the interpreter, which waits for the final responses of a
+  // decoupled execution for as long as it takes when it isn't set
+  std::string stream_grace_period;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("STREAM_GRACE_PERIOD_MILLISECONDS", &stream_grace_period));
+  if (!stream_grace_period.empty()) {
+    int64_t stream_grace_period_ms = 0;
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(stream_grace_period, &stream_grace_period_ms));
+    if (stream_grace_period_ms < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("STREAM_GRACE_PERIOD_MILLISECONDS must not be "
+                       "negative for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  triton::common::TritonJson::Value sequence_batching;
+  if (ModelConfig().Find("sequence_batching", &sequence_batching)) {
+    sequence_batching_ = true;
+    THROW_IF_BACKEND_MODEL_ERROR(ParseSequenceControls(sequence_batching));
+
+    // The sequence batcher sends all the requests of a sequence to the same
+    // instance, whose interpreter keeps the state of the sequence. Worker
+    // processes would each have their own states.
+    if ((worker_type_ == "process") && (worker_count_ > 1)) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("WORKER_TYPE 'process' with more than one worker "
+                       "can't be used with the sequence batcher for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+    if (batched_execution_) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("BATCHED_EXECUTION can't be used with the sequence "
+                       "batcher for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  std::string enable_cuda_ipc;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("ENABLE_CUDA_IPC", &enable_cuda_ipc));
+  if (!enable_cuda_ipc.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseBoolValue(enable_cuda_ipc, &enable_cuda_ipc_));
+#ifndef TRITON_ENABLE_GPU
+    if (enable_cuda_ipc_) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNSUPPORTED,
+          (std::string("ENABLE_CUDA_IPC requires the python backend to be "
+                       "built with TRITON_ENABLE_GPU for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+#endif  // TRITON_ENABLE_GPU
+  }
+
+  std::string flat_requests;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("FLAT_EXECUTE_REQUEST", &flat_requests));
+  if (!flat_requests.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseBoolValue(flat_requests, &flat_requests_));
+  }
+
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("CPU_AFFINITY_POLICY", &cpu_affinity_policy_));
+  if ((cpu_affinity_policy_ != "none") && (cpu_affinity_policy_ != "spread")) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("CPU_AFFINITY_POLICY must be 'none' or 'spread' for "
+                     "model '") +
+         Name() + "'")
+            .c_str()));
+  }
+
+  // 'auto' divides the CPUs of the interpreter between its workers, -1
+  // stands for it until the placement is known
+  std::string interpreter_thread_count;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("INTERPRETER_THREAD_COUNT", &interpreter_thread_count));
+  if (interpreter_thread_count == "auto") {
+    interpreter_thread_count_ = -1;
+  } else if (!interpreter_thread_count.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(ParseLongLongValue(
+        interpreter_thread_count, &interpreter_thread_count_));
+    if (interpreter_thread_count_ < 1) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("INTERPRETER_THREAD_COUNT must be at least 1 or "
+                       "'auto' for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  std::string execute_timeout;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("EXECUTE_TIMEOUT_MILLISECONDS", &execute_timeout));
+  if (!execute_timeout.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(execute_timeout, &execute_timeout_ms_));
+    if (execute_timeout_ms_ < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("EXECUTE_TIMEOUT_MILLISECONDS must not be negative "
+                       "for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  std::string buffer_pool_byte_size;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("BUFFER_POOL_BYTE_SIZE", &buffer_pool_byte_size));
+  if (!buffer_pool_byte_size.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(buffer_pool_byte_size, &buffer_pool_byte_size_));
+    if (buffer_pool_byte_size_ < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("BUFFER_POOL_BYTE_SIZE must not be negative for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  // The data files of the samples are in the 'warmup' directory of the
+  // model, like for the other backends
+  THROW_IF_BACKEND_MODEL_ERROR(ParseModelWarmup(
+      ModelConfig(), MaxBatchSize(), RepositoryPath() + "/warmup",
+      &warmup_samples_));
+
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("SCHEDULING_POLICY", &scheduling_policy_));
+  if ((scheduling_policy_ != "fifo") &&
+      (scheduling_policy_ != "smallest_first")) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("SCHEDULING_POLICY must be 'fifo' or 'smallest_first' "
+                     "for model '") +
+         Name() + "'")
+            .c_str()));
+  }
+  // The requests of a sequence must reach the model in the order in which
+  // they were sent.
+  if ((scheduling_policy_ != "fifo") && sequence_batching_) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("SCHEDULING_POLICY '") + scheduling_policy_ +
+         "' can't be used with the sequence batcher for model '" + Name() +
+         "'")
+            .c_str()));
+  }
+
+  std::string large_request_byte_size;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("LARGE_REQUEST_BYTE_SIZE", &large_request_byte_size));
+  if (!large_request_byte_size.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(large_request_byte_size, &large_request_byte_size_));
+    if (large_request_byte_size_ < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("LARGE_REQUEST_BYTE_SIZE must not be negative for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  std::string warm_spare_count;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("WARM_SPARE_INTERPRETERS", &warm_spare_count));
+  if (!warm_spare_count.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(warm_spare_count, &warm_spare_count_));
+    if (warm_spare_count_ < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("WARM_SPARE_INTERPRETERS must not be negative for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  // The workers can only be kept busy if the instance sends them enough
+  // executions, so by default there is one execution slot per worker.
+  pipeline_depth_ = worker_count_;
+  std::string pipeline_depth;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("EXECUTE_PIPELINE_DEPTH", &pipeline_depth));
+  if (!pipeline_depth.empty()) {
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(pipeline_depth, &pipeline_depth_));
+    if (pipeline_depth_ < 1) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("EXECUTE_PIPELINE_DEPTH must be at least 1 for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+  }
+
+  // The sequence batcher sends the next request of a sequence once the
+  // previous one is executed, so the executions of a stateful model aren't
+  // pipelined and the interpreter sees the requests of a sequence in order.
+  if (sequence_batching_) {
+    if ((pipeline_depth_ > 1) && !pipeline_depth.empty()) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("EXECUTE_PIPELINE_DEPTH can't be larger than 1 with "
+                       "the sequence batcher for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+    pipeline_depth_ = 1;
+  }
+
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("INTERPRETER_MODE", &interpreter_mode_));
+  if ((interpreter_mode_ != "process") && (interpreter_mode_ != "embedded")) {
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("INTERPRETER_MODE must be 'process' or 'embedded' for "
+                     "model '") +
+         Name() + "'")
+            .c_str()));
+  }
+  if (EmbeddedInterpreter()) {
+#ifndef TRITON_ENABLE_EMBEDDED_PYTHON
+    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_UNSUPPORTED,
+        (std::string("INTERPRETER_MODE 'embedded' requires the python "
+                     "backend to be built with TRITON_ENABLE_EMBEDDED_PYTHON "
+                     "for model '") +
+         Name() + "'")
+            .c_str()));
+#endif  // TRITON_ENABLE_EMBEDDED_PYTHON
+    if (batched_execution_ || decoupled_) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("INTERPRETER_MODE 'embedded' can't be used with "
+                       "BATCHED_EXECUTION or the decoupled transaction "
+                       "policy for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+
+    // The embedded models run one at a time under the GIL, so the instance
+    // executes synchronously
+    pipeline_depth_ = 1;
+  }
+
+  std::string cache_byte_size;
+  THROW_IF_BACKEND_MODEL_ERROR(
+      ReadParameter("RESPONSE_CACHE_BYTE_SIZE", &cache_byte_size));
+  if (!cache_byte_size.empty()) {
+    int64_t byte_size = 0;
+    THROW_IF_BACKEND_MODEL_ERROR(
+        ParseLongLongValue(cache_byte_size, &byte_size));
+    if (byte_size < 0) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("RESPONSE_CACHE_BYTE_SIZE must not be negative for "
+                       "model '") +
+           Name() + "'")
+              .c_str()));
+    }
+    if ((byte_size > 0) &&
+        (batched_execution_ || decoupled_ || sequence_batching_)) {
+      throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("RESPONSE_CACHE_BYTE_SIZE can't be used with "
+                       "BATCHED_EXECUTION, the decoupled transaction "
+                       "policy or the sequence batcher for model '") +
+           Name() + "'")
+              .c_str()));
+    }
+    if (byte_size > 0) {
+      THROW_IF_BACKEND_MODEL_ERROR(
+          ResponseCache::Create(byte_size, &response_cache_));
+      if (backend_state_->cache_lookup_family != nullptr) {
+        LOG_IF_ERROR(
+            CreateCacheMetrics(),
+            "failed to create the response cache metrics");
+      }
+    }
+  }
+
+  THROW_IF_BACKEND_MODEL_ERROR(StartBlsServer());
+
+  // The reference is only released by the destructor, so nothing may throw
+  // once it is taken
+  THROW_IF_BACKEND_MODEL_ERROR(AcquireWeightStore());
+}
+
+ModelState::~ModelState()
+{
+  for (auto& interpreter : launched_interpreters_) {
+    TerminateInterpreter(interpreter.get());
+  }
+  ReleaseWeightStore();
+  for (TRITONSERVER_Metric* metric : {cache_hit_metric_, cache_miss_metric_}) {
+    if (metric != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricDelete(metric),
+          "failed to delete a response cache metric");
+    }
+  }
+}
+
+TRITONSERVER_Error*
+ModelState::AcquireWeightStore()
+{
+  // Files that change in the version directory, e.g. when the model is
+  // updated in place before a reload, give the model a new store
+  int64_t mtime_ns = 0;
+  LatestModificationTime(
+      RepositoryPath() + "/" + std::to_string(Version()), &mtime_ns);
+
+  std::stringstream name;
+  name << "triton_python_backend_weights_" << EscapeFileName(RepositoryPath())
+       << "_" << Version() << "_" << std::hex << mtime_ns;
+  if (name.str().size() > NAME_MAX) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_WARN,
+        (std::string("the weight store is not available for model '") +
+         Name() + "', the path of its repository is too long")
+            .c_str());
+    return nullptr;
+  }
+  const std::string path =
+      backend_state_->weight_store_dir + "/" + name.str();
+
+  std::lock_guard<std::mutex> lk(backend_state_->weight_store_mu);
+  auto it = backend_state_->weight_store_refs.find(path);
+  if (it == backend_state_->weight_store_refs.end()) {
+    int lock_fd;
+    TRITONSERVER_Error* err = LockWeightStore(path, &lock_fd);
+    if (err != nullptr) {
+      TRITONSERVER_Error* model_err = TRITONSERVER_ErrorNew(
+          TRITONSERVER_ErrorCode(err),
+          (std::string(TRITONSERVER_ErrorMessage(err)) + " for model '" +
+           Name() + "'")
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      return model_err;
+    }
+    it = backend_state_->weight_store_refs
+             .emplace(path, BackendState::WeightStoreRef{0, lock_fd})
+             .first;
+  }
+  ++it->second.model_count;
+
+  weight_store_path_ = path;
+  return nullptr;
+}
+
+void
+ModelState::ReleaseWeightStore()
+{
+  if (weight_store_path_.empty()) {
+    return;
+  }
+
+  // The arrays that interpreters still map stay valid once they are removed
+  std::lock_guard<std::mutex> lk(backend_state_->weight_store_mu);
+  auto it = backend_state_->weight_store_refs.find(weight_store_path_);
+  if ((it != backend_state_->weight_store_refs.end()) &&
+      (--it->second.model_count == 0)) {
+    UnlockWeightStore(weight_store_path_, it->second.lock_fd);
+    backend_state_->weight_store_refs.erase(it);
+  }
+}
+
+TRITONSERVER_Error*
+ModelState::StartBlsServer()
+{
+  std::lock_guard<std::mutex> lk(backend_state_->bls_server_mu);
+  if (backend_state_->bls_server != nullptr) {
+    return nullptr;
+  }
+
+  return BlsServer::Create(TritonServer(), &backend_state_->bls_server);
+}
+
+TRITONSERVER_Error*
+ModelState::CreateCacheMetrics()
+{
+  const std::string version = std::to_string(Version());
+  for (TRITONSERVER_Metric** metric :
+       {&cache_hit_metric_, &cache_miss_metric_}) {
+    const TRITONSERVER_Parameter* labels[] = {
+        TRITONSERVER_ParameterNew(
+            "model", TRITONSERVER_PARAMETER_STRING, Name().c_str()),
+        TRITONSERVER_ParameterNew(
+            "version", TRITONSERVER_PARAMETER_STRING, version.c_str()),
+        TRITONSERVER_ParameterNew(
+            "result", TRITONSERVER_PARAMETER_STRING,
+            (metric == &cache_hit_metric_) ? "hit" : "miss")};
+    constexpr uint64_t label_count = sizeof(labels) / sizeof(labels[0]);
+
+    TRITONSERVER_Error* err = TRITONSERVER_MetricNew(
+        metric, backend_state_->cache_lookup_family, labels, label_count);
+    for (const TRITONSERVER_Parameter* label : labels) {
+      TRITONSERVER_ParameterDelete(const_cast<TRITONSERVER_Parameter*>(label));
+    }
+    RETURN_IF_ERROR(err);
+  }
+
+  return nullptr;
+}
+
+void
+ModelState::RecordCacheLookup(const bool hit)
+{
+  TRITONSERVER_Metric* metric = hit ? cache_hit_metric_ : cache_miss_metric_;
+  if (metric != nullptr) {
+    LOG_IF_ERROR(
+        TRITONSERVER_MetricIncrement(metric, 1),
+        "failed to update a response cache metric");
+  }
+}
+
+TRITONSERVER_Error*
+ModelState::LaunchInterpreters()
+{
+  // The instances of an embedded model don't have interpreter processes
+  if (EmbeddedInterpreter()) {
+    return nullptr;
+  }
+
+  // Count the instances of every instance group. The instances of a GPU
+  // group without a list of GPUs are spread over all the GPUs, those are
+  // launched on demand if not enough interpreters are started here. The
+  // instances of a group with a host policy are placed by it, so their
+  // interpreters are launched when they are created.
+  int64_t instance_count = 0;
+  triton::common::TritonJson::Value instance_groups;
+  if (ModelConfig().Find("instance_group", &instance_groups)) {
+    for (size_t i = 0; i < instance_groups.ArraySize(); ++i) {
+      triton::common::TritonJson::Value instance_group;
+      RETURN_IF_ERROR(instance_groups.IndexAsObject(i, &instance_group));
+      std::string host_policy;
+      if (instance_group.Find("host_policy")) {
+        RETURN_IF_ERROR(
+            instance_group.MemberAsString("host_policy", &host_policy));
+      }
+      if (!host_policy.empty()) {
+        continue;
+      }
+
+      int64_t count = 1;
+      if (instance_group.Find("count")) {
+        RETURN_IF_ERROR(instance_group.MemberAsInt("count", &count));
+      }
+      triton::common::TritonJson::Value gpus;
+      if (instance_group.Find("gpus", &gpus) && (gpus.ArraySize() > 0)) {
+        count *= gpus.ArraySize();
+      }
+      instance_count += count;
+    }
+  }
+
+  for (int64_t i = 0; i < instance_count + WarmSpareCount(); ++i) {
+    Placement placement;
+    RETURN_IF_ERROR(NextPlacement(&placement));
+    std::unique_ptr<InterpreterProcess> interpreter;
+    RETURN_IF_ERROR(LaunchInterpreter(placement, &interpreter));
+
+    std::lock_guard<std::mutex> lk(interpreter_mu_);
+    launched_interpreters_.emplace_back(std::move(interpreter));
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::AcquireInterpreter(
+    const Placement& placement,
+    std::unique_ptr<InterpreterProcess>* interpreter)
+{
+  // The launched interpreters are placed by the policy of the model
+  if (!placement.Empty()) {
+    return LaunchInterpreter(placement, interpreter);
+  }
+
+  bool launch_spare;
+  {
+    std::lock_guard<std::mutex> lk(interpreter_mu_);
+    if (launched_interpreters_.empty()) {
+      interpreter->reset();
+    } else {
+      // Use the interpreter that was launched first, it is the most likely
+      // to be ready.
+      *interpreter = std::move(launched_interpreters_.front());
+      launched_interpreters_.erase(launched_interpreters_.begin());
+    }
+    launch_spare =
+        (static_cast<int64_t>(launched_interpreters_.size()) <
+         WarmSpareCount());
+  }
+
+  if (*interpreter == nullptr) {
+    Placement next_placement;
+    RETURN_IF_ERROR(NextPlacement(&next_placement));
+    RETURN_IF_ERROR(LaunchInterpreter(next_placement, interpreter));
+  }
+
+  // Replace the spare that was taken so that the next instance finds one
+  if (launch_spare) {
+    Placement spare_placement;
+    std::unique_ptr<InterpreterProcess> spare;
+    LOG_IF_ERROR(
+        NextPlacement(&spare_placement), "failed to place a spare interpreter");
+    LOG_IF_ERROR(
+        LaunchInterpreter(spare_placement, &spare),
+        "failed to launch a spare Python interpreter");
+    if (spare != nullptr) {
+      std::lock_guard<std::mutex> lk(interpreter_mu_);
+      launched_interpreters_.emplace_back(std::move(spare));
+    }
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::NextPlacement(Placement* placement)
+{
+  if (cpu_affinity_policy_ == "spread") {
+    return Placement::Spread(placement_index_++, placement);
+  }
+
+  *placement = Placement();
+  return nullptr;
+}
+
+int64_t
+ModelState::InterpreterThreadCount(const Placement& placement) const
+{
+  if (interpreter_thread_count_ != -1) {
+    return interpreter_thread_count_;
+  }
+
+  if (placement.CpuCount() == 0) {
+    return 0;
+  }
+  return std::max<int64_t>(1, placement.CpuCount() / WorkerCount());
+}
+
+TRITONSERVER_Error*
+ModelState::LaunchInterpreter(
+    const Placement& placement,
+    std::unique_ptr<InterpreterProcess>* interpreter)
+{
+  constexpr int max_tmpfile_name = 255;
+  char tmp_dir_name[max_tmpfile_name] = "/tmp/XXXXXX";
+
+  // Create a temporary directory and use <tmp_dir>/unix.socket for GRPC socket
+  // This is the only way that we can make sure that the unix socket path used
+  // for GRPC is unique
+  if (mkdtemp(tmp_dir_name) == nullptr) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        "Failed to create a temporary socket name");
+  }
+
+  std::unique_ptr<InterpreterProcess> process(new InterpreterProcess());
+  process->tmp_dir = tmp_dir_name;
+  process->domain_socket =
+      std::string("unix://") + tmp_dir_name + "/unix.socket";
+  process->control_fd = -1;
+  process->placement = placement;
+
+  const std::string model_path = ModelPath();
+  const std::string python_interpreter_startup =
+      StateForBackend()->python_lib + "/startup.py";
+
+  // Both ends are close-on-exec so that they don't leak into the processes
+  // that other threads may fork at the same time. The child clears the flag
+  // on its end before it runs startup.py.
+  int control_sockets[2];
+  if (socketpair(
+          AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, control_sockets) == -1) {
+    rmdir(tmp_dir_name);
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("failed to create the control socket for model '") +
+         Name() + "': " + strerror(errno))
+            .c_str());
+  }
+
+  std::vector<std::string> args{"--socket",
+                                process->domain_socket,
+                                "--model-path",
+                                model_path,
+                                "--model-name",
+                                Name(),
+                                "--worker-count",
+                                std::to_string(WorkerCount()),
+                                "--worker-type",
+                                WorkerType(),
+                                "--bls-socket",
+                                StateForBackend()->bls_server->Address()};
+
+  // A new interpreter is placed and given its environment before it starts,
+  // startup.py places those forked by the fork server
+  const int64_t thread_count = InterpreterThreadCount(placement);
+  if (!placement.CpuList().empty()) {
+    args.emplace_back("--cpu-affinity");
+    args.emplace_back(placement.CpuList());
+  }
+  if (thread_count > 0) {
+    args.emplace_back("--thread-count");
+    args.emplace_back(std::to_string(thread_count));
+  }
+
+  // Fall back to starting a fresh interpreter if the fork server can't be
+  // used, the interpreter only takes longer to start.
+  process->pid = -1;
+  ForkServer* fork_server = StateForBackend()->fork_server.get();
+  if (fork_server != nullptr) {
+    TRITONSERVER_Error* err =
+        fork_server->Fork(args, control_sockets[1], &process->pid);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          (std::string("failed to fork the Python interpreter for model '") +
+           Name() + "' from the fork server, starting a new interpreter: " +
+           TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      process->pid = -1;
+    }
+  }
+
+  if (process->pid == -1) {
+    args.emplace_back("--control-fd");
+    args.emplace_back(std::to_string(control_sockets[1]));
+
+    // The command line is built before forking, the child only makes
+    // async-signal-safe calls until it runs the Python interpreter.
+    std::vector<const char*> subinterpreter_commandline{
+        StateForBackend()->python_runtime.c_str(),
+        python_interpreter_startup.c_str()};
+    for (const auto& arg : args) {
+      subinterpreter_commandline.push_back(arg.c_str());
+    }
+    subinterpreter_commandline.push_back(nullptr);
+
+    // The thread counts of the math libraries replace those of the
+    // environment of Triton
+    std::vector<std::string> thread_count_variables;
+    if (thread_count > 0) {
+      for (const char* variable :
+           {"OMP_NUM_THREADS", "OPENBLAS_NUM_THREADS", "MKL_NUM_THREADS"}) {
+        thread_count_variables.emplace_back(
+            std::string(variable) + "=" + std::to_string(thread_count));
+      }
+    }
+    std::vector<const char*> subinterpreter_environment;
+    for (char** variable = environ; *variable != nullptr; ++variable) {
+      const bool replaced = std::any_of(
+          thread_count_variables.begin(), thread_count_variables.end(),
+          [variable](const std::string& replacement) {
+            const size_t name_size = replacement.find('=') + 1;
+            return strncmp(*variable, replacement.c_str(), name_size) == 0;
+          });
+      if (!replaced) {
+        subinterpreter_environment.push_back(*variable);
+      }
+    }
+    for (const auto& variable : thread_count_variables) {
+      subinterpreter_environment.push_back(variable.c_str());
+    }
+    subinterpreter_environment.push_back(nullptr);
+
+    process->pid = fork();
+    if (process->pid == 0) {
+      fcntl(control_sockets[1], F_SETFD, 0);
+      placement.Apply();
+      execvpe(
+          subinterpreter_commandline[0],
+          const_cast<char**>(subinterpreter_commandline.data()),
+          const_cast<char**>(subinterpreter_environment.data()));
+
+      // The backend reports the failure when the socket is closed without
+      // the interpreter becoming ready
+      _exit(1);
+    }
+  }
+
+  close(control_sockets[1]);
+  if (process->pid == -1) {
+    close(control_sockets[0]);
+    rmdir(tmp_dir_name);
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("Cannot run interpreter host for model '") + Name() +
+         "': " + strerror(errno))
+            .c_str());
+  }
+  process->control_fd = control_sockets[0];
+
+  LOG_MESSAGE(
+      TRITONSERVER_LOG_VERBOSE,
+      (std::string("launched Python interpreter ") +
+       std::to_string(process->pid) + " for model '" + Name() + "' on " +
+       placement.ToString())
+          .c_str());
+
+  *interpreter = std::move(process);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::ParseSequenceControls(
+    triton::common::TritonJson::Value& sequence_batching)
+{
+  triton::common::TritonJson::Value control_inputs;
+  if (!sequence_batching.Find("control_input", &control_inputs)) {
+    return nullptr;
+  }
+
+  for (size_t i = 0; i < control_inputs.ArraySize(); ++i) {
+    triton::common::TritonJson::Value control_input;
+    RETURN_IF_ERROR(control_inputs.IndexAsObject(i, &control_input));
+    std::string name;
+    RETURN_IF_ERROR(control_input.MemberAsString("name", &name));
+
+    triton::common::TritonJson::Value controls;
+    RETURN_IF_ERROR(control_input.MemberAsArray("control", &controls));
+    for (size_t c = 0; c < controls.ArraySize(); ++c) {
+      triton::common::TritonJson::Value control;
+      RETURN_IF_ERROR(controls.IndexAsObject(c, &control));
+      std::string kind;
+      RETURN_IF_ERROR(control.MemberAsString("kind", &kind));
+
+      // The correlation ID is already known from the request
+      SequenceControl sequence_control;
+      sequence_control.name = name;
+      if (kind == "CONTROL_SEQUENCE_START") {
+        sequence_control.flag = SEQUENCE_FLAG_START;
+      } else if (kind == "CONTROL_SEQUENCE_END") {
+        sequence_control.flag = SEQUENCE_FLAG_END;
+      } else if (kind == "CONTROL_SEQUENCE_READY") {
+        sequence_control.flag = SEQUENCE_FLAG_NOT_READY;
+      } else {
+        continue;
+      }
+
+      // The control has the false and the true value of the input for the
+      // datatype of the input
+      triton::common::TritonJson::Value values;
+      if (control.Find("int32_false_true", &values) &&
+          (values.ArraySize() == 2)) {
+        int64_t value;
+        RETURN_IF_ERROR(values.IndexAsInt(1, &value));
+        sequence_control.true_value = value;
+      } else if (
+          control.Find("fp32_false_true", &values) &&
+          (values.ArraySize() == 2)) {
+        RETURN_IF_ERROR(values.IndexAsDouble(1, &sequence_control.true_value));
+      } else if (
+          control.Find("bool_false_true", &values) &&
+          (values.ArraySize() == 2)) {
+        bool value;
+        RETURN_IF_ERROR(values.IndexAsBool(1, &value));
+        sequence_control.true_value = value ? 1 : 0;
+      } else {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            (std::string("control ") + kind + " of input '" + name +
+             "' must have a false and a true value for model '" + Name() +
+             "'")
+                .c_str());
+      }
+      sequence_controls_.push_back(sequence_control);
+    }
+  }
+
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ModelState::SequenceFlags(TRITONBACKEND_Request* request, uint32_t* flags)
+{
+  // START and END are also in the flags of the request, READY is only known
+  // from its control input
+  uint32_t request_flags = 0;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestFlags(request, &request_flags));
+  *flags = request_flags & (TRITONSERVER_REQUEST_FLAG_SEQUENCE_START |
+                            TRITONSERVER_REQUEST_FLAG_SEQUENCE_END);
+
+  for (const SequenceControl& control : sequence_controls_) {
+    TRITONBACKEND_Input* input;
+    RETURN_IF_ERROR(
+        TRITONBACKEND_RequestInput(request, control.name.c_str(), &input));
+    TRITONSERVER_DataType dtype;
+    RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+        input, nullptr, &dtype, nullptr, nullptr, nullptr, nullptr));
+
+    const void* buffer;
+    uint64_t buffer_byte_size;
+    TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+    int64_t memory_type_id = 0;
+    RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+        input, 0, &buffer, &buffer_byte_size, &memory_type, &memory_type_id));
+    if ((memory_type == TRITONSERVER_MEMORY_GPU) ||
+        (buffer_byte_size < TRITONSERVER_DataTypeByteSize(dtype))) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INTERNAL,
+          (std::string("can't read control input '") + control.name + "'")
+              .c_str());
+    }
+
+    double value = 0;
+    if (dtype == TRITONSERVER_TYPE_INT32) {
+      int32_t int32_value;
+      memcpy(&int32_value, buffer, sizeof(int32_value));
+      value = int32_value;
+    } else if (dtype == TRITONSERVER_TYPE_FP32) {
+      float fp32_value;
+      memcpy(&fp32_value, buffer, sizeof(fp32_value));
+      value = fp32_value;
+    } else if (dtype == TRITONSERVER_TYPE_BOOL) {
+      value = (*reinterpret_cast<const uint8_t*>(buffer) != 0) ? 1 : 0;
+    }
+
+    const bool signaled = (value == control.true_value);
+    if (control.flag == SEQUENCE_FLAG_NOT_READY) {
+      if (!signaled) {
+        *flags |= SEQUENCE_FLAG_NOT_READY;
+      }
+    } else if (signaled) {
+      *flags |= control.flag;
+    }
+  }
 
   return nullptr;
 }
 
-TRITONSERVER_Error*
-ModelState::Create(TRITONBACKEND_Model* triton_model, ModelState** state)
+std::string
+ModelState::ModelPath()
 {
-  try {
-    *state = new ModelState(triton_model);
-  }
-  catch (const BackendModelException& ex) {
-    RETURN_ERROR_IF_TRUE(
-        ex.err_ == nullptr, TRITONSERVER_ERROR_INTERNAL,
-        std::string("unexpected nullptr in BackendModelException"));
-    RETURN_IF_ERROR(ex.err_);
-  }
-
-  return nullptr;  // success
+  std::stringstream ss;
+  ss << RepositoryPath() << "/" << Version() << "/model.py";
+  return ss.str();
 }
 
-ModelState::ModelState(TRITONBACKEND_Model* triton_model)
-    : BackendModel(triton_model)
+TRITONSERVER_Error*
+ModelState::ReadParameter(const std::string& key, std::string* value)
 {
-  TRITONBACKEND_Backend* backend;
-  THROW_IF_BACKEND_MODEL_ERROR(
-      TRITONBACKEND_ModelBackend(triton_model, &backend));
-
-  const char* path = nullptr;
-  TRITONBACKEND_ArtifactType artifact_type;
-  THROW_IF_BACKEND_MODEL_ERROR(
-      TRITONBACKEND_ModelRepository(triton_model, &artifact_type, &path));
-
-  void* bstate;
-  THROW_IF_BACKEND_MODEL_ERROR(TRITONBACKEND_BackendState(backend, &bstate));
-  backend_state_ = reinterpret_cast<BackendState*>(bstate);
+  triton::common::TritonJson::Value parameters;
+  if (!ModelConfig().Find("parameters", &parameters)) {
+    return nullptr;
+  }
 
-  if (artifact_type != TRITONBACKEND_ARTIFACT_FILESYSTEM) {
-    throw triton::backend::BackendModelException(TRITONSERVER_ErrorNew(
-        TRITONSERVER_ERROR_UNSUPPORTED,
-        (std::string("unsupported artifact type for model '") + Name() + "'")
-            .c_str()));
+  TRITONSERVER_Error* err = GetParameterValue(parameters, key, value);
+  if (err != nullptr) {
+    if (TRITONSERVER_ErrorCode(err) != TRITONSERVER_ERROR_NOT_FOUND) {
+      return err;
+    }
+    TRITONSERVER_ErrorDelete(err);
   }
+
+  return nullptr;
 }
 
 extern "C" {
@@ -515,6 +4307,15 @@ TRITONBACKEND_Initialize(TRITONBACKEND_Backend* backend)
   triton::common::TritonJson::Value cmdline;
   backend_state->python_runtime = "python3";
   backend_state->grpc_timeout = 2000;
+  backend_state->shm_default_byte_size = 64 * 1024 * 1024;
+  backend_state->shm_growth_byte_size = 64 * 1024 * 1024;
+  backend_state->cuda_ipc_byte_size = 64 * 1024 * 1024;
+  backend_state->startup_timeout = 60000;
+  backend_state->weight_store_dir = "/dev/shm";
+  int64_t completion_thread_count =
+      std::max(1u, std::thread::hardware_concurrency());
+  bool enable_fork_server = false;
+  std::string preload_modules;
 
   if (backend_config.Find("cmdline", &cmdline)) {
     triton::common::TritonJson::Value python_runtime;
@@ -529,6 +4330,70 @@ TRITONBACKEND_Initialize(TRITONBACKEND_Backend* backend)
       RETURN_IF_ERROR(
           ParseLongLongValue(grpc_timeout_str, &backend_state->grpc_timeout));
     }
+
+    triton::common::TritonJson::Value startup_timeout;
+    if (cmdline.Find("startup-timeout-milliseconds", &startup_timeout)) {
+      std::string startup_timeout_str;
+      RETURN_IF_ERROR(startup_timeout.AsString(&startup_timeout_str));
+      RETURN_IF_ERROR(ParseLongLongValue(
+          startup_timeout_str, &backend_state->startup_timeout));
+    }
+
+    triton::common::TritonJson::Value shm_default_size;
+    if (cmdline.Find("shm-default-byte-size", &shm_default_size)) {
+      std::string shm_default_byte_size;
+      RETURN_IF_ERROR(shm_default_size.AsString(&shm_default_byte_size));
+      RETURN_IF_ERROR(ParseLongLongValue(
+          shm_default_byte_size, &backend_state->shm_default_byte_size));
+    }
+
+    triton::common::TritonJson::Value shm_growth_size;
+    if (cmdline.Find("shm-growth-byte-size", &shm_growth_size)) {
+      std::string shm_growth_byte_size;
+      RETURN_IF_ERROR(shm_growth_size.AsString(&shm_growth_byte_size));
+      RETURN_IF_ERROR(ParseLongLongValue(
+          shm_growth_byte_size, &backend_state->shm_growth_byte_size));
+    }
+
+    triton::common::TritonJson::Value cuda_ipc_size;
+    if (cmdline.Find("cuda-ipc-byte-size", &cuda_ipc_size)) {
+      std::string cuda_ipc_byte_size;
+      RETURN_IF_ERROR(cuda_ipc_size.AsString(&cuda_ipc_byte_size));
+      RETURN_IF_ERROR(ParseLongLongValue(
+          cuda_ipc_byte_size, &backend_state->cuda_ipc_byte_size));
+    }
+
+    triton::common::TritonJson::Value fork_server;
+    if (cmdline.Find("fork-server", &fork_server)) {
+      std::string fork_server_str;
+      RETURN_IF_ERROR(fork_server.AsString(&fork_server_str));
+      RETURN_IF_ERROR(ParseBoolValue(fork_server_str, &enable_fork_server));
+    }
+
+    triton::common::TritonJson::Value fork_server_preload;
+    if (cmdline.Find("fork-server-preload-modules", &fork_server_preload)) {
+      RETURN_IF_ERROR(fork_server_preload.AsString(&preload_modules));
+    }
+
+    triton::common::TritonJson::Value weight_store_dir;
+    if (cmdline.Find("weight-store-dir", &weight_store_dir)) {
+      RETURN_IF_ERROR(
+          weight_store_dir.AsString(&backend_state->weight_store_dir));
+    }
+
+    triton::common::TritonJson::Value completion_threads;
+    if (cmdline.Find("grpc-completion-thread-count", &completion_threads)) {
+      std::string completion_thread_count_str;
+      RETURN_IF_ERROR(
+          completion_threads.AsString(&completion_thread_count_str));
+      RETURN_IF_ERROR(ParseLongLongValue(
+          completion_thread_count_str, &completion_thread_count));
+      if (completion_thread_count < 1) {
+        return TRITONSERVER_ErrorNew(
+            TRITONSERVER_ERROR_INVALID_ARG,
+            "grpc-completion-thread-count must be at least 1");
+      }
+    }
   }
 
   // Use BackendArtifacts to determine the location of Python files
@@ -538,6 +4403,82 @@ TRITONBACKEND_Initialize(TRITONBACKEND_Backend* backend)
       TRITONBACKEND_BackendArtifacts(backend, &artifact_type, &location));
   backend_state->python_lib = location;
 
+  // The stage durations are only reported if the server has metrics enabled
+  TRITONSERVER_Error* err = TRITONSERVER_MetricFamilyNew(
+      &backend_state->stage_duration_family, TRITONSERVER_METRIC_KIND_COUNTER,
+      "nv_python_backend_stage_duration_us",
+      "Cumulative time spent in every stage of the executions of the Python "
+      "backend, in microseconds");
+  if (err != nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("stage duration metrics are not available: ") +
+         TRITONSERVER_ErrorMessage(err))
+            .c_str());
+    TRITONSERVER_ErrorDelete(err);
+    backend_state->stage_duration_family = nullptr;
+  }
+
+  err = TRITONSERVER_MetricFamilyNew(
+      &backend_state->cache_lookup_family, TRITONSERVER_METRIC_KIND_COUNTER,
+      "nv_python_backend_response_cache_lookups",
+      "Number of lookups in the response caches of the Python backend, by "
+      "result");
+  if (err != nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("response cache metrics are not available: ") +
+         TRITONSERVER_ErrorMessage(err))
+            .c_str());
+    TRITONSERVER_ErrorDelete(err);
+    backend_state->cache_lookup_family = nullptr;
+  }
+
+  err = TRITONSERVER_MetricFamilyNew(
+      &backend_state->buffer_pool_acquisition_family,
+      TRITONSERVER_METRIC_KIND_COUNTER,
+      "nv_python_backend_buffer_pool_acquisitions",
+      "Number of staging buffers taken from the buffer pools of the Python "
+      "backend, by whether a free buffer was reused");
+  if (err == nullptr) {
+    err = TRITONSERVER_MetricFamilyNew(
+        &backend_state->buffer_pool_size_family,
+        TRITONSERVER_METRIC_KIND_GAUGE, "nv_python_backend_buffer_pool_bytes",
+        "Number of bytes of free staging buffers kept by the buffer pools of "
+        "the Python backend");
+  }
+  if (err != nullptr) {
+    LOG_MESSAGE(
+        TRITONSERVER_LOG_VERBOSE,
+        (std::string("buffer pool metrics are not available: ") +
+         TRITONSERVER_ErrorMessage(err))
+            .c_str());
+    TRITONSERVER_ErrorDelete(err);
+    if (backend_state->buffer_pool_acquisition_family != nullptr) {
+      LOG_IF_ERROR(
+          TRITONSERVER_MetricFamilyDelete(
+              backend_state->buffer_pool_acquisition_family),
+          "failed to delete the buffer pool metric family");
+    }
+    backend_state->buffer_pool_acquisition_family = nullptr;
+    backend_state->buffer_pool_size_family = nullptr;
+  }
+
+  // gRPC is initialized once for the backend, and the asynchronous
+  // executions of all the instances share the completion threads
+  RETURN_IF_ERROR(GrpcRuntime::Create(
+      completion_thread_count, &backend_state->grpc_runtime));
+
+  // Without the fork server every interpreter is started from scratch
+  if (enable_fork_server) {
+    LOG_IF_ERROR(
+        ForkServer::Create(
+            backend_state->python_runtime,
+            backend_state->python_lib + "/startup.py", preload_modules,
+            backend_state->startup_timeout, &backend_state->fork_server),
+        "failed to start the Python fork server");
+  }
+
   RETURN_IF_ERROR(TRITONBACKEND_BackendSetState(
       backend, reinterpret_cast<void*>(backend_state.get())));
 
@@ -581,6 +4522,12 @@ TRITONBACKEND_ModelInitialize(TRITONBACKEND_Model* model)
   RETURN_IF_ERROR(
       TRITONBACKEND_ModelSetState(model, reinterpret_cast<void*>(model_state)));
 
+  // If the interpreters can't be launched now, every instance will try to
+  // launch its own and report the error
+  LOG_IF_ERROR(
+      model_state->LaunchInterpreters(),
+      "failed to launch the Python interpreters ahead of the instances");
+
   return nullptr;
 }
 
@@ -634,6 +4581,9 @@ TRITONBACKEND_ModelInstanceInitialize(TRITONBACKEND_ModelInstance* instance)
 
   RETURN_IF_ERROR(instance_state->CreatePythonInterpreter());
 
+  // The instance is only ready once it is warmed up
+  RETURN_IF_ERROR(instance_state->Warmup());
+
   LOG_MESSAGE(
       TRITONSERVER_LOG_VERBOSE,
       (std::string("TRITONBACKEND_ModelInstanceInitialize: instance "
@@ -653,277 +4603,7 @@ TRITONBACKEND_ModelInstanceExecute(
   RETURN_IF_ERROR(TRITONBACKEND_ModelInstanceState(
       instance, reinterpret_cast<void**>(&instance_state)));
 
-  std::vector<TRITONBACKEND_Response*> responses;
-  responses.reserve(request_count);
-
-  uint64_t exec_start_ns = 0;
-  SET_TIMESTAMP(exec_start_ns);
-
-  for (uint32_t r = 0; r < request_count; ++r) {
-    TRITONBACKEND_Request* req = requests[r];
-
-    TRITONBACKEND_Response* response;
-    RETURN_IF_ERROR(TRITONBACKEND_ResponseNew(&response, req));
-    responses.push_back(response);
-  }
-
-  // Create ExecuteRequest
-  ExecuteRequest execute_request;
-  for (uint32_t r = 0; r < request_count; ++r) {
-    TRITONBACKEND_Request* request = requests[r];
-
-    InferenceRequest* inference_request = execute_request.add_requests();
-
-    uint32_t requested_input_count = 0;
-    GUARDED_RESPOND_IF_ERROR(
-        responses, r,
-        TRITONBACKEND_RequestInputCount(request, &requested_input_count));
-
-    uint32_t requested_output_count = 0;
-    GUARDED_RESPOND_IF_ERROR(
-        responses, r,
-        TRITONBACKEND_RequestOutputCount(request, &requested_output_count));
-
-    uint32_t batch_size = 0;
-    for (size_t iidx = 0; iidx < requested_input_count; ++iidx) {
-      Tensor* input_tensor = inference_request->add_inputs();
-      GUARDED_RESPOND_IF_ERROR(
-          responses, r,
-          instance_state->GetInputTensor(
-              iidx, request, input_tensor, responses, r, batch_size));
-    }
-
-    // Append the list of requested outputs to the inference_request
-    for (size_t iidx = 0; iidx < requested_output_count; ++iidx) {
-      const char* requested_output_name;
-      GUARDED_RESPOND_IF_ERROR(
-          responses, r,
-          TRITONBACKEND_RequestOutputName(
-              request, iidx, &requested_output_name));
-
-      inference_request->add_requested_output_names(requested_output_name);
-    }
-
-    const char* id;
-    GUARDED_RESPOND_IF_ERROR(
-        responses, r, TRITONBACKEND_RequestId(request, &id));
-    inference_request->set_id(id);
-
-    uint64_t correlation_id;
-    GUARDED_RESPOND_IF_ERROR(
-        responses, r,
-        TRITONBACKEND_RequestCorrelationId(request, &correlation_id));
-    inference_request->set_correlation_id(correlation_id);
-  }
-
-  // ExecuteResponse
-  grpc::ClientContext context;
-  ExecuteResponse execute_response;
-
-  uint64_t compute_start_ns = 0;
-  SET_TIMESTAMP(compute_start_ns);
-
-  // Perform inference on the Python side
-  const auto status = instance_state->stub->Execute(
-      &context, execute_request, &execute_response);
-
-  uint64_t compute_end_ns = 0;
-  SET_TIMESTAMP(compute_end_ns);
-
-  // If inference fails, release all the requests and send an error response If
-  // inference fails at this stage, it usually indicates a bug in the model code
-  if (!status.ok()) {
-    for (uint32_t r = 0; r < request_count; ++r) {
-      if (responses[r] == nullptr) {
-        continue;
-      }
-      TRITONSERVER_Error* err = TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_INTERNAL, ("GRPC Execute Failed, message: " +
-                                        std::string(status.error_message()))
-                                           .c_str());
-      LOG_IF_ERROR(
-          TRITONBACKEND_ResponseSend(
-              responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
-          "failed sending response");
-      responses[r] = nullptr;
-      TRITONSERVER_ErrorDelete(err);
-    }
-
-    for (uint32_t r = 0; r < request_count; ++r) {
-      TRITONBACKEND_Request* request = requests[r];
-      LOG_IF_ERROR(
-          TRITONBACKEND_ModelInstanceReportStatistics(
-              instance, request, false /* success */, exec_start_ns,
-              compute_start_ns, compute_end_ns, compute_end_ns),
-          "failed reporting request statistics");
-
-      LOG_IF_ERROR(
-          TRITONBACKEND_RequestRelease(
-              request, TRITONSERVER_REQUEST_RELEASE_ALL),
-          "failed releasing request");
-    }
-
-    return nullptr;
-  }
-
-  for (uint32_t r = 0; r < request_count; ++r) {
-    TRITONBACKEND_Response* response = responses[r];
-    TRITONBACKEND_Request* request = requests[r];
-    uint32_t requested_output_count = 0;
-
-    // Get response r
-    InferenceResponse inference_response = execute_response.responses(r);
-
-    if (inference_response.failed()) {
-      TRITONSERVER_Error* err = TRITONSERVER_ErrorNew(
-          TRITONSERVER_ERROR_INTERNAL,
-          (inference_response.error().message()).c_str());
-      LOG_IF_ERROR(
-          TRITONBACKEND_ResponseSend(
-              responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, err),
-          "failed sending response");
-      responses[r] = nullptr;
-      TRITONSERVER_ErrorDelete(err);
-
-      // If has_error is true, we do not look at the response even if the
-      // response is set.
-      continue;
-    }
-
-    GUARDED_RESPOND_IF_ERROR(
-        responses, r,
-        TRITONBACKEND_RequestOutputCount(request, &requested_output_count));
-    for (size_t j = 0; j < requested_output_count; ++j) {
-      // Prepare output buffers.
-      const Tensor python_output_result = inference_response.outputs(j);
-      TRITONBACKEND_Output* triton_output;
-      TRITONSERVER_DataType triton_dt =
-          static_cast<TRITONSERVER_DataType>(python_output_result.dtype());
-
-      auto python_output_dims = python_output_result.dims();
-      const std::string output_tensor_name = python_output_result.name();
-
-      uint32_t dims_count = python_output_dims.size();
-
-      GUARDED_RESPOND_IF_ERROR(
-          responses, r,
-          TRITONBACKEND_ResponseOutput(
-              response, &triton_output, python_output_result.name().c_str(),
-              triton_dt, python_output_dims.data(), dims_count));
-
-      int64_t output_byte_size;
-
-      // Custom handling for TRITONSERVER_TYPE_BYTES
-      if (triton_dt == TRITONSERVER_TYPE_BYTES) {
-        output_byte_size = python_output_result.raw_data().size();
-      } else {
-        std::vector<int64_t> output_dims(
-            python_output_dims.begin(), python_output_dims.end());
-        output_byte_size = GetByteSize(triton_dt, output_dims);
-      }
-
-      void* output_buffer;
-
-      TRITONSERVER_MemoryType output_memory_type = TRITONSERVER_MEMORY_CPU;
-      int64_t output_memory_type_id = 0;
-      GUARDED_RESPOND_IF_ERROR(
-          responses, r,
-          TRITONBACKEND_OutputBuffer(
-              triton_output, &output_buffer, output_byte_size,
-              &output_memory_type, &output_memory_type_id));
-
-      if ((responses[r] == nullptr) ||
-          (output_memory_type == TRITONSERVER_MEMORY_GPU)) {
-        GUARDED_RESPOND_IF_ERROR(
-            responses, r,
-            TRITONSERVER_ErrorNew(
-                TRITONSERVER_ERROR_UNSUPPORTED,
-                "can't create response in GPU memory."));
-        TRITONSERVER_LogMessage(
-            TRITONSERVER_LOG_ERROR, __FILE__, __LINE__,
-            (std::string("request ") + std::to_string(r) +
-             ": failed to create output buffer in CPU memory.")
-                .c_str());
-        continue;
-      }
-
-      // Try to find the matching output name we don't use indexing here because
-      // the output inference batch may be missing from the response
-      auto output_response_tensor = std::find_if(
-          inference_response.outputs().begin(),
-          inference_response.outputs().end(),
-          [&output_tensor_name](const Tensor& itr) {
-            return itr.name() == output_tensor_name;
-          });
-
-      // Continue to the next inference batch if the corresponding output
-      // response can't be found
-      if (output_response_tensor == inference_response.outputs().end()) {
-        LOG_MESSAGE(
-            TRITONSERVER_LOG_ERROR,
-            ("can't find output tensor with name " + output_tensor_name)
-                .c_str());
-        continue;
-      }
-
-      // Copy Python output to Triton output buffers
-      std::copy(
-          output_response_tensor->raw_data().begin(),
-          output_response_tensor->raw_data().end(), (char*)output_buffer);
-    }
-
-    if (responses[r] == nullptr) {
-      LOG_MESSAGE(
-          TRITONSERVER_LOG_ERROR, (std::string("Request ") + std::to_string(r) +
-                                   ": failed to create output response")
-                                      .c_str());
-      continue;
-    }
-
-    // If error happens at this stage, we can only log it
-    LOG_IF_ERROR(
-        TRITONBACKEND_ResponseSend(
-            responses[r], TRITONSERVER_RESPONSE_COMPLETE_FINAL, nullptr),
-        "failed sending response");
-  }
-
-  uint64_t exec_end_ns = 0;
-  SET_TIMESTAMP(exec_end_ns);
-
-  for (uint32_t r = 0; r < request_count; ++r) {
-    TRITONBACKEND_Request* request = requests[r];
-
-    // Report statistics for the request. Note that there could
-    // still be responses that have not yet been sent but those
-    // cannot be captured in the statistics as they reflect only the
-    // request object. We use the execution start/end time for
-    // compute also so that the entire execution time is associated
-    // with the inference computation.
-    LOG_IF_ERROR(
-        TRITONBACKEND_ModelInstanceReportStatistics(
-            instance, request, (responses[r] != nullptr) /* success */,
-            exec_start_ns, compute_start_ns, compute_end_ns, exec_end_ns),
-        "failed reporting request statistics");
-
-    LOG_IF_ERROR(
-        TRITONBACKEND_RequestRelease(request, TRITONSERVER_REQUEST_RELEASE_ALL),
-        "failed releasing request");
-  }
-
-  // Report the entire batch statistics. This backend does not support
-  // batching so the total batch size is always 1.
-  LOG_IF_ERROR(
-      TRITONBACKEND_ModelInstanceReportBatchStatistics(
-          instance, 1, exec_start_ns, compute_start_ns, compute_end_ns,
-          exec_end_ns),
-      "failed reporting batch request statistics");
-
-  LOG_MESSAGE(
-      TRITONSERVER_LOG_VERBOSE,
-      (std::string("TRITONBACKEND_ModelInstanceExecute: model instance name ") +
-       instance_state->Name() + " released " + std::to_string(request_count) +
-       " requests")
-          .c_str());
+  RETURN_IF_ERROR(instance_state->ProcessRequests(requests, request_count));
 
   return nullptr;
 }
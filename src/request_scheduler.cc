@@ -0,0 +1,95 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "request_scheduler.h"
+
+#include <algorithm>
+#include <utility>
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+TRITONSERVER_Error*
+InputByteSize(TRITONBACKEND_Request* request, uint64_t* byte_size)
+{
+  uint32_t input_count;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestInputCount(request, &input_count));
+
+  *byte_size = 0;
+  for (uint32_t i = 0; i < input_count; ++i) {
+    TRITONBACKEND_Input* input;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestInputByIndex(request, i, &input));
+    uint64_t input_byte_size;
+    RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+        input, nullptr, nullptr, nullptr, nullptr, &input_byte_size,
+        nullptr));
+    *byte_size += input_byte_size;
+  }
+
+  return nullptr;
+}
+
+}  // namespace
+
+TRITONSERVER_Error*
+ScheduleRequests(
+    TRITONBACKEND_Request** requests, const uint32_t request_count,
+    const uint64_t large_byte_size,
+    std::vector<std::vector<TRITONBACKEND_Request*>>* executions)
+{
+  std::vector<std::pair<uint64_t, TRITONBACKEND_Request*>> sized_requests;
+  sized_requests.reserve(request_count);
+  for (uint32_t r = 0; r < request_count; ++r) {
+    uint64_t byte_size;
+    RETURN_IF_ERROR(InputByteSize(requests[r], &byte_size));
+    sized_requests.emplace_back(byte_size, requests[r]);
+  }
+
+  // Stable so that the requests of the same size keep the order in which
+  // the scheduler of Triton has batched them.
+  std::stable_sort(
+      sized_requests.begin(), sized_requests.end(),
+      [](const std::pair<uint64_t, TRITONBACKEND_Request*>& lhs,
+         const std::pair<uint64_t, TRITONBACKEND_Request*>& rhs) {
+        return lhs.first < rhs.first;
+      });
+
+  executions->clear();
+  for (const auto& sized_request : sized_requests) {
+    if ((sized_request.first >= large_byte_size) || executions->empty()) {
+      executions->emplace_back();
+    }
+    executions->back().push_back(sized_request.second);
+  }
+
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,155 @@
+# Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+"""Python side of the embedded interpreter mode of the backend. The backend
+creates an EmbeddedModel for every instance of a model that sets
+INTERPRETER_MODE to "embedded" and calls it directly from the interpreter
+that it embeds, see embedded_interpreter.cc.
+"""
+
+import numpy as np
+
+import triton_python_backend_utils as tpb_utils
+from startup import (SequenceStates, deserialize_bytes_tensor, load_model,
+                     merge_responses, output_datatype, serialize_byte_tensor,
+                     uses_sequence_batcher)
+
+
+def _input_loader(dtype, dims, data):
+    """Get the function that reads an input for tpb_utils.Tensor._lazy.
+    `data` is a read-only memoryview of the Triton input buffer, so the
+    inputs are only valid for the duration of the execution.
+    """
+    numpy_type = tpb_utils.triton_to_numpy_type(dtype)
+
+    # We need to deserialize TYPE_STRING
+    if numpy_type == np.object_ or numpy_type == np.bytes_:
+        return lambda: deserialize_bytes_tensor(data).reshape(dims)
+
+    return lambda: np.frombuffer(data, dtype=numpy_type).reshape(dims)
+
+
+def _response_outputs(inference_request, response):
+    """Get the error message of `response`, or the name, datatype, shape and
+    C-contiguous data of every output that `inference_request` requested.
+    """
+    if response.has_error():
+        return response.error().message()
+
+    outputs = []
+    for output_tensor in response.output_tensors():
+        if not inference_request.is_output_requested(output_tensor.name()):
+            continue
+
+        if output_tensor.is_cpu():
+            output_array = output_tensor.as_numpy()
+        else:
+            # The backend only reads outputs from host memory
+            output_array = output_tensor._as_cupy().get()
+
+        if output_array.dtype == np.object_ or output_array.dtype.type is np.bytes_:
+            output_data = serialize_byte_tensor(output_array)
+        else:
+            output_data = np.ascontiguousarray(output_array)
+
+        outputs.append((output_tensor.name(), output_datatype(output_array),
+                        output_array.shape, output_data))
+    return outputs
+
+
+class EmbeddedModel:
+    """A TritonPythonModel run by the interpreter embedded in the backend.
+    Exceptions are reported by the backend as errors of the instance or of
+    the execution.
+    """
+
+    def __init__(self, module_path, args):
+        self.module_path = module_path
+        self.model_instance = load_model(module_path)
+
+        if not hasattr(self.model_instance, 'execute'):
+            raise NotImplementedError(
+                f'Python model {module_path} does not implement `execute` method.'
+            )
+        self.sequence_states = None
+        if uses_sequence_batcher(args):
+            self.sequence_states = SequenceStates()
+
+        if hasattr(self.model_instance, 'initialize'):
+            self.model_instance.initialize(args)
+
+    def execute(self, requests):
+        """Run the model on the requests of an execution. Every request is a
+        tuple of its ID, correlation ID, inputs, requested output names,
+        sequence flags and timeout in microseconds, and every input a tuple of
+        its name, datatype, shape and data. Returns the result of _response_outputs for every request.
+        """
+        inference_requests = []
+        for (request_id, correlation_id, inputs, requested_output_names,
+             sequence_flags, timeout_us) in requests:
+            input_tensors = [
+                tpb_utils.Tensor._lazy(name,
+                                       _input_loader(dtype, dims, data))
+                for name, dtype, dims, data in inputs
+            ]
+            inference_requests.append(
+                tpb_utils.InferenceRequest(input_tensors, request_id,
+                                           correlation_id,
+                                           requested_output_names,
+                                           sequence_flags,
+                                           timeout_us=timeout_us))
+
+        model_requests, skipped_responses = inference_requests, {}
+        if self.sequence_states is not None:
+            model_requests, skipped_responses = self.sequence_states.prepare(
+                inference_requests)
+        try:
+            responses = self.model_instance.execute(model_requests)
+        finally:
+            if self.sequence_states is not None:
+                self.sequence_states.finish(model_requests)
+
+        # Make sure that number of InferenceResponse and InferenceRequest
+        # objects match
+        if len(model_requests) != len(responses):
+            raise tpb_utils.TritonModelException(
+                'Number of inference responses and requests don\'t match ( requests='
+                + str(len(model_requests)) + ' != responses=' +
+                str(len(responses)) + ')')
+        if skipped_responses:
+            responses = merge_responses(len(inference_requests),
+                                        skipped_responses, responses)
+
+        return [
+            _response_outputs(inference_request, response)
+            for inference_request, response in zip(inference_requests,
+                                                   responses)
+        ]
+
+    def finalize(self):
+        if hasattr(self.model_instance, 'finalize'):
+            self.model_instance.finalize()
@@ -28,27 +28,46 @@ import triton_python_backend_utils as tpb_utils
 
 import argparse
 import concurrent.futures as futures
+import ctypes
 import importlib.util
+import json
+import mmap
+import multiprocessing
+import os
+import queue
 import sys
 import threading
 import signal
+import socket
 import time
 import struct
 import traceback
 from pathlib import Path
 
-from grpc_channelz.v1 import channelz
-from grpc_channelz.v1 import channelz_pb2
-from grpc_channelz.v1 import channelz_pb2_grpc
 
 import numpy as np
 
 from python_host_pb2 import *
-from python_host_pb2_grpc import PythonInterpreterServicer, add_PythonInterpreterServicer_to_server
+from python_host_pb2_grpc import PythonInterpreterServicer, PythonInterpreterStub, add_PythonInterpreterServicer_to_server
 import grpc
 
 MAX_GRPC_MESSAGE_SIZE = 2147483647
 
+# How often the stream of a decoupled execution checks whether it was
+# cancelled while it waits for a response
+STREAM_POLL_INTERVAL_S = 1.0
+
+# TRITONSERVER_MemoryType
+TRITONSERVER_MEMORY_CPU = 0
+TRITONSERVER_MEMORY_GPU = 2
+
+# TRITONSERVER_DataType of the BYTES tensors
+TRITONSERVER_TYPE_BYTES = 13
+
+
+# Length prefix of every element of a serialized BYTES tensor
+BYTES_LENGTH = struct.Struct('<I')
+
 
 def serialize_byte_tensor(input_tensor):
     """
@@ -65,43 +84,66 @@ def serialize_byte_tensor(input_tensor):
             The 1-D numpy array of type uint8 containing the serialized bytes in 'C' order.
         Raises
         ------
-        InferenceServerException
+        TritonModelException
             If unable to serialize the given tensor.
         """
 
     if input_tensor.size == 0:
-        return np.empty([0])
+        return np.empty([0], dtype=np.uint8)
 
     # If the input is a tensor of string/bytes objects, then must flatten those into
     # a 1-dimensional array containing the 4-byte byte size followed by the
     # actual element bytes. All elements are concatenated together in "C"
     # order.
-    if (input_tensor.dtype == np.object) or (input_tensor.dtype.type
-                                             == np.bytes_):
-        flattened = bytes()
-        for obj in np.nditer(input_tensor, flags=["refs_ok"], order='C'):
+    if (input_tensor.dtype == np.object_) or (input_tensor.dtype.type
+                                              == np.bytes_):
+        elements = input_tensor.ravel(order='C').tolist()
+        if input_tensor.dtype == np.object_:
             # If directly passing bytes to BYTES type,
             # don't convert it to str as Python will encode the
             # bytes which may distort the meaning
-            if obj.dtype.type == np.bytes_:
-                if type(obj.item()) == bytes:
-                    s = obj.item()
-                else:
-                    s = bytes(obj)
-            else:
-                s = str(obj).encode('utf-8')
-            flattened += struct.pack("<I", len(s))
-            flattened += s
-        flattened_array = np.asarray(flattened)
-        if not flattened_array.flags['C_CONTIGUOUS']:
-            flattened_array = np.ascontiguousarray(flattened_array)
-        return flattened_array
+            elements = [
+                e if type(e) == bytes else str(e).encode('utf-8')
+                for e in elements
+            ]
+
+        # Place the length prefixes and the element bytes in the output with
+        # vectorized scatters, so the cost is linear in the size of the
+        # tensor.
+        lengths = np.fromiter(map(len, elements),
+                              dtype=np.uint32,
+                              count=len(elements))
+        data_starts = np.cumsum(lengths.astype(np.int64) +
+                                BYTES_LENGTH.size) - lengths
+        serialized = np.empty(int(data_starts[-1]) + int(lengths[-1]),
+                              dtype=np.uint8)
+
+        length_positions = ((data_starts - BYTES_LENGTH.size)[:, np.newaxis] +
+                            np.arange(BYTES_LENGTH.size))
+        serialized[length_positions] = lengths.astype('<u4').view(
+            np.uint8).reshape(-1, BYTES_LENGTH.size)
+
+        is_data = np.ones(serialized.size, dtype=bool)
+        is_data[length_positions] = False
+        serialized[is_data] = np.frombuffer(b''.join(elements),
+                                            dtype=np.uint8)
+        return serialized
     else:
-        raise TritonModelException(
+        raise tpb_utils.TritonModelException(
             "cannot serialize bytes tensor: invalid datatype")
     return None
 
 
+def output_datatype(output_array):
+    """Get the TRITONSERVER_DataType of an output array. BYTES outputs are
+    sent serialized to uint8, so their datatype can't be taken from the
+    array that is sent.
+    """
+    if output_array.dtype == np.object_ or output_array.dtype.type is np.bytes_:
+        return TRITONSERVER_TYPE_BYTES
+    return tpb_utils.numpy_to_triton_type(output_array.dtype.type)
+
+
 def deserialize_bytes_tensor(encoded_tensor):
     """
     Deserializes an encoded bytes tensor into an
@@ -115,22 +157,416 @@ def deserialize_bytes_tensor(encoded_tensor):
     Returns
     -------
     string_tensor : np.array
-        The 1-D numpy array of type object containing the
+        The 1-D numpy array of type bytes containing the
         deserialized bytes in 'C' order.
     """
-    strs = list()
+    # Every length prefix is needed to find the next one, so only this scan
+    # over the prefixes is sequential. The element bytes are gathered with
+    # vectorized operations.
+    starts = []
+    lengths = []
     offset = 0
-    val_buf = encoded_tensor
-    while offset < len(val_buf):
-        l = struct.unpack_from("<I", val_buf, offset)[0]
-        offset += 4
-        sb = struct.unpack_from("<{}s".format(l), val_buf, offset)[0]
-        offset += l
-        strs.append(sb)
-    return (np.array(strs, dtype=bytes))
+    byte_size = len(encoded_tensor)
+    unpack_from = BYTES_LENGTH.unpack_from
+    while offset < byte_size:
+        if offset + BYTES_LENGTH.size > byte_size:
+            raise tpb_utils.TritonModelException(
+                "cannot deserialize bytes tensor: truncated length")
+        length = unpack_from(encoded_tensor, offset)[0]
+        offset += BYTES_LENGTH.size
+        starts.append(offset)
+        lengths.append(length)
+        offset += length
+
+    if not lengths:
+        return np.array([], dtype=bytes)
+    if offset > byte_size:
+        raise tpb_utils.TritonModelException(
+            "cannot deserialize bytes tensor: truncated element")
+
+    starts = np.array(starts, dtype=np.int64)
+    lengths = np.array(lengths, dtype=np.int64)
+    item_size = max(int(lengths.max()), 1)
+
+    # Copy the bytes of element i to row i of a fixed-size bytes array,
+    # numpy drops the trailing padding when the elements are accessed
+    rows = np.repeat(np.arange(lengths.size), lengths)
+    columns = np.arange(rows.size) - np.repeat(
+        np.cumsum(lengths) - lengths, lengths)
+    strs = np.zeros((lengths.size, item_size), dtype=np.uint8)
+    buffer = np.frombuffer(encoded_tensor, dtype=np.uint8)
+    strs[rows, columns] = buffer[np.repeat(starts, lengths) + columns]
+    return strs.view('S{}'.format(item_size)).reshape(lengths.size)
+
+
+# Flat layout of the requests of an execution, must match flat_request.h
+FLAT_REQUESTS_HEADER = np.dtype([('request_count', 'u4'),
+                                 ('tensor_count', 'u4'),
+                                 ('output_name_count', 'u4'),
+                                 ('dim_count', 'u4'),
+                                 ('strings_byte_size', 'u8')])
+FLAT_REQUEST = np.dtype([('correlation_id', 'u8'), ('first_input', 'u4'),
+                         ('input_count', 'u4'), ('id_offset', 'u4'),
+                         ('id_byte_size', 'u4'), ('first_output_name', 'u4'),
+                         ('output_name_count', 'u4'),
+                         ('sequence_flags', 'u4'), ('reserved', 'u4'),
+                         ('timeout_us', 'u8')])
+FLAT_TENSOR = np.dtype([('offset', 'u8'), ('byte_size', 'u8'),
+                        ('memory_type_id', 'i8'), ('dtype', 'i4'),
+                        ('memory_type', 'i4'), ('name_offset', 'u4'),
+                        ('name_byte_size', 'u4'), ('first_dim', 'u4'),
+                        ('dims_count', 'u4')])
+FLAT_STRING = np.dtype([('offset', 'u4'), ('byte_size', 'u4')])
+FLAT_DIM = np.dtype('i8')
+
+
+def read_flat_requests(buffer):
+    """Read the requests that the backend wrote to `buffer` in the flat
+    layout. Every section is read with a single numpy call, without creating
+    a Python object per field.
+
+    Returns
+    -------
+    list
+        A (id, correlation_id, inputs, requested_output_names,
+        sequence_flags) tuple for every request, where `inputs` is a list of
+        (name, dtype, dims, offset, byte_size, memory_type) tuples.
+    """
+    header = np.frombuffer(buffer, dtype=FLAT_REQUESTS_HEADER, count=1)[0]
+    offset = FLAT_REQUESTS_HEADER.itemsize
+    sections = []
+    for dtype, count in ((FLAT_REQUEST, header['request_count']),
+                         (FLAT_TENSOR, header['tensor_count']),
+                         (FLAT_STRING, header['output_name_count']),
+                         (FLAT_DIM, header['dim_count'])):
+        count = int(count)
+        sections.append(
+            np.frombuffer(buffer, dtype=dtype, count=count,
+                          offset=offset).tolist())
+        offset += count * dtype.itemsize
+    flat_requests, flat_tensors, flat_output_names, dims = sections
+    strings = bytes(buffer[offset:offset + int(header['strings_byte_size'])])
+
+    requests = []
+    for (correlation_id, first_input, input_count, id_offset, id_byte_size,
+         first_output_name, output_name_count, sequence_flags, _,
+         timeout_us) in flat_requests:
+        inputs = []
+        for (tensor_offset, byte_size, _, dtype, memory_type, name_offset,
+             name_byte_size, first_dim, dims_count
+            ) in flat_tensors[first_input:first_input + input_count]:
+            name = strings[name_offset:name_offset + name_byte_size].decode()
+            inputs.append((name, dtype, dims[first_dim:first_dim + dims_count],
+                           tensor_offset, byte_size, memory_type))
+        requested_output_names = [
+            strings[name_offset:name_offset + name_byte_size].decode()
+            for name_offset, name_byte_size in
+            flat_output_names[first_output_name:first_output_name +
+                              output_name_count]
+        ]
+        request_id = strings[id_offset:id_offset + id_byte_size].decode()
+        requests.append((request_id, correlation_id, inputs,
+                         requested_output_names, sequence_flags, timeout_us))
+    return requests
+
+
+def input_loader(shm_region, cuda_ipc_region, dtype, dims, offset, byte_size,
+                 memory_type):
+    """Get the function that reads the data of an input tensor for
+    tpb_utils.Tensor._lazy.
+    """
+    numpy_type = tpb_utils.triton_to_numpy_type(dtype)
+
+    # We need to deserialize TYPE_STRING
+    if numpy_type == np.object_ or numpy_type == np.bytes_:
+        return lambda: deserialize_bytes_tensor(
+            shm_region.buffer(offset, byte_size)).reshape(dims)
+
+    # Inputs in GPU memory are views of the CUDA IPC region
+    if memory_type == TRITONSERVER_MEMORY_GPU:
+        return lambda: cuda_ipc_region.ndarray(offset, numpy_type, dims)
+
+    # Inputs are read-only views of the shared memory region and are only
+    # valid for the duration of the execution.
+    def load():
+        numpy_data = shm_region.ndarray(offset, numpy_type, dims)
+        numpy_data.flags.writeable = False
+        return numpy_data
+
+    return load
+
+
+def write_tensor(shm_region, name, array):
+    """Write the numpy array `array` to the shared memory region and get the
+    Tensor message of it. Arrays that are already in the region, e.g. the
+    outputs created with tpb_utils.Tensor.empty or the inputs that are
+    returned unchanged, are not copied.
+    """
+    # We need to serialize TYPE_STRING
+    if array.dtype == np.object_ or array.dtype.type is np.bytes_:
+        data = serialize_byte_tensor(array)
+        offset = shm_region.write(data.tobytes())
+    else:
+        data = array
+        offset = shm_region.offset_of(data)
+        if offset is None:
+            offset = shm_region.allocate(data.nbytes)
+            shm_region.ndarray(offset, data.dtype, array.shape)[...] = data
+
+    return Tensor(name=name,
+                  dtype=output_datatype(array),
+                  dims=array.shape,
+                  offset=offset,
+                  byte_size=data.nbytes,
+                  memory_type=TRITONSERVER_MEMORY_CPU,
+                  memory_type_id=0)
+
+
+class SharedMemoryRegion:
+    """Python side of the shared memory region that the backend creates for
+    every model instance. Tensor data is exchanged through this region and
+    only the offsets are sent over gRPC. The region starts with a header that
+    must match `SharedMemoryHeader` in shm_manager.h.
+    """
+
+    HEADER = struct.Struct('<QQQ')
+    ALIGNMENT = 64
+
+    def __init__(self, name):
+        self.name = name
+        self._fd = os.open('/dev/shm/' + name.lstrip('/'), os.O_RDWR)
+        self._mmap = None
+        self._remap()
+
+        # Held while the region is allocated from. A request sent with
+        # `InferenceRequest.exec` holds it until the backend has written the
+        # outputs, so that other threads don't allocate at the same time.
+        self.lock = threading.RLock()
+
+    def _remap(self):
+        # numpy arrays created from the previous mapping keep it alive until
+        # they are garbage collected.
+        self._mmap = mmap.mmap(self._fd, os.fstat(self._fd).st_size)
+        # Address of the mapping, used to recognize the arrays whose data is
+        # already in the region
+        self._address = np.frombuffer(
+            self._mmap, dtype=np.uint8).__array_interface__['data'][0]
+
+    def _header(self):
+        return self.HEADER.unpack_from(self._mmap, 0)
+
+    def _ensure_mapped(self, end):
+        # The backend may have grown the region since it was mapped
+        if end > len(self._mmap):
+            self._remap()
+        if end > len(self._mmap):
+            raise tpb_utils.TritonModelException(
+                'tensor is out of the bounds of the shared memory region')
+
+    def ndarray(self, offset, dtype, shape):
+        """Create a numpy array backed by the region at `offset`
+        """
+        dtype = np.dtype(dtype)
+        self._ensure_mapped(offset +
+                            int(np.prod(shape, dtype=np.int64)) * dtype.itemsize)
+        return np.ndarray(shape, dtype=dtype, buffer=self._mmap, offset=offset)
+
+    def offset_of(self, array):
+        """Get the offset of the data of the numpy array `array` if it is
+        already allocated in the current mapping of the region, or None
+        otherwise.
+        """
+        if not array.flags['C_CONTIGUOUS']:
+            return None
+
+        offset = array.__array_interface__['data'][0] - self._address
+        used = self._header()[2]
+        if (offset < self.HEADER.size) or (offset + array.nbytes > used):
+            return None
+        return offset
+
+    def buffer(self, offset, byte_size):
+        """Get a memoryview of `byte_size` bytes of the region at `offset`
+        """
+        self._ensure_mapped(offset + byte_size)
+        return memoryview(self._mmap)[offset:offset + byte_size]
+
+    def allocate(self, byte_size):
+        """Allocate `byte_size` bytes in the region, growing it if required.
+        Returns the offset of the allocation.
+        """
+        with self.lock:
+            return self._allocate(byte_size)
+
+    def _allocate(self, byte_size):
+        capacity, growth_byte_size, used = self._header()
+        offset = (used + self.ALIGNMENT - 1) & ~(self.ALIGNMENT - 1)
+        end = offset + byte_size
+
+        if end > capacity:
+            if growth_byte_size == 0:
+                raise tpb_utils.TritonModelException(
+                    'shared memory region is full and growth is disabled')
+            current_capacity = capacity
+            while capacity < end:
+                capacity += growth_byte_size
+            try:
+                os.posix_fallocate(self._fd, current_capacity,
+                                   capacity - current_capacity)
+            except OSError as e:
+                raise tpb_utils.TritonModelException(
+                    'failed to grow shared memory region: ' + str(e))
+            self._remap()
+
+        self.HEADER.pack_into(self._mmap, 0, capacity, growth_byte_size, end)
+        return offset
+
+    def write(self, data):
+        """Copy the bytes-like `data` into a new allocation. Returns the offset
+        of the allocation.
+        """
+        data = memoryview(data).cast('B')
+        offset = self.allocate(data.nbytes)
+        self._mmap[offset:offset + data.nbytes] = data
+        return offset
 
 
-def parse_startup_arguments():
+class CudaIpcRegion:
+    """Python side of the device memory that the backend shares with the
+    interpreter through CUDA IPC when it is enabled for the model. Inputs in
+    GPU memory are placed in the region by the backend, and outputs in GPU
+    memory are copied to it after the allocations of the backend. The layout
+    must match `CudaIpcMemory` in cuda_ipc_memory.h.
+    """
+
+    ALIGNMENT = 256
+
+    def __init__(self, cuda_ipc_region):
+        self._cupy = tpb_utils._import_cupy()
+        self.handle = cuda_ipc_region.handle
+        self.device_id = cuda_ipc_region.device_id
+        self._byte_size = cuda_ipc_region.byte_size
+        self._used = 0
+        with self._cupy.cuda.Device(self.device_id):
+            self._ptr = self._cupy.cuda.runtime.ipcOpenMemHandle(self.handle)
+        self._memory = self._cupy.cuda.UnownedMemory(self._ptr,
+                                                     self._byte_size, self,
+                                                     self.device_id)
+
+    def __del__(self):
+        if getattr(self, '_ptr', None) is not None:
+            self._cupy.cuda.runtime.ipcCloseMemHandle(self._ptr)
+
+    def reset(self, used):
+        """Start a new execution, the first `used` bytes contain its inputs
+        """
+        self._used = used
+
+    def ndarray(self, offset, dtype, shape):
+        """Create a cupy array backed by the region at `offset`
+        """
+        memptr = self._cupy.cuda.MemoryPointer(self._memory, offset)
+        return self._cupy.ndarray(shape, dtype=dtype, memptr=memptr)
+
+    def write(self, cupy_array):
+        """Copy `cupy_array` into a new allocation. Returns the offset of the
+        allocation, or None if the region is full.
+        """
+        offset = (self._used + self.ALIGNMENT - 1) & ~(self.ALIGNMENT - 1)
+        end = offset + cupy_array.nbytes
+        if end > self._byte_size:
+            return None
+
+        self._used = end
+        with self._cupy.cuda.Device(self.device_id):
+            self.ndarray(offset, cupy_array.dtype,
+                         cupy_array.shape)[...] = cupy_array
+            # The backend reads the output as soon as Execute returns
+            self._cupy.cuda.get_current_stream().synchronize()
+        return offset
+
+
+class BlsClient:
+    """Sends the requests of `tpb_utils.InferenceRequest.exec` to the BLS
+    server of the backend, which runs them on the other models loaded in
+    Triton. The tensors are exchanged through the shared memory region of the
+    execution that sends the request, so only their metadata is sent over
+    gRPC.
+    """
+
+    def __init__(self, address):
+        self._address = address
+        self._lock = threading.Lock()
+        self._pid = None
+        self._stub = None
+
+    def _get_stub(self):
+        # The channel is created on first use by every process, a channel
+        # can't be used by the worker processes forked after it is created
+        with self._lock:
+            if self._pid != os.getpid():
+                self._stub = PythonInterpreterStub(
+                    grpc.insecure_channel(
+                        self._address,
+                        options=[
+                            ('grpc.max_send_message_length',
+                             MAX_GRPC_MESSAGE_SIZE),
+                            ('grpc.max_receive_message_length',
+                             MAX_GRPC_MESSAGE_SIZE),
+                        ]))
+                self._pid = os.getpid()
+            return self._stub
+
+    def __call__(self, inference_request):
+        shm_region = getattr(tpb_utils._execution_context, 'shm_region', None)
+        if shm_region is None:
+            raise tpb_utils.TritonModelException(
+                'inference requests can only be sent during execute')
+
+        timeout_us = 0
+        remaining_time = inference_request.remaining_time()
+        if remaining_time is not None:
+            if remaining_time <= 0:
+                return tpb_utils.InferenceResponse(
+                    [], error=tpb_utils.TritonError('request timed out'))
+            timeout_us = max(1, int(remaining_time * 1e6))
+
+        with shm_region.lock:
+            inputs = []
+            for tensor in inference_request.inputs():
+                array = (tensor.as_numpy()
+                         if tensor.is_cpu() else tensor._as_cupy().get())
+                inputs.append(write_tensor(shm_region, tensor.name(), array))
+            message = ModelInferRequest(
+                model_name=inference_request.model_name(),
+                model_version=inference_request.model_version(),
+                request=InferenceRequest(
+                    id=inference_request.request_id(),
+                    correlation_id=inference_request.correlation_id(),
+                    inputs=inputs,
+                    requested_output_names=(
+                        inference_request.requested_output_names()),
+                    timeout_us=timeout_us),
+                shm_region_name=shm_region.name)
+            response = self._get_stub().Infer(message)
+
+        if response.failed:
+            return tpb_utils.InferenceResponse(
+                [], error=tpb_utils.TritonError(response.error.message))
+
+        # The outputs are views of the region, like the inputs of the
+        # execution, and are only valid until `execute` returns
+        output_tensors = [
+            tpb_utils.Tensor._lazy(
+                x.name,
+                input_loader(shm_region, None, x.dtype, tuple(x.dims),
+                             x.offset, x.byte_size, x.memory_type))
+            for x in response.outputs
+        ]
+        return tpb_utils.InferenceResponse(output_tensors)
+
+
+def parse_startup_arguments(args=None):
     parser = argparse.ArgumentParser(description="Triton Python Host")
     parser.add_argument("--socket",
                         default=None,
@@ -142,14 +578,167 @@ def parse_startup_arguments():
                         required=True,
                         type=str,
                         help="Path to model code")
-    parser.add_argument("--instance-name",
+    parser.add_argument("--model-name",
+                        default="",
+                        type=str,
+                        help="Triton model name")
+    parser.add_argument("--worker-count",
+                        default=1,
+                        type=int,
+                        help="Number of workers that run the model")
+    parser.add_argument("--worker-type",
+                        default="thread",
+                        choices=["thread", "process"],
+                        help="Run the model in threads or in pre-forked "
+                        "processes")
+    parser.add_argument("--control-fd",
+                        default=-1,
+                        type=int,
+                        help="Socket shared with the backend that is written "
+                        "to once the server is listening, the interpreter "
+                        "exits when the backend closes it")
+    parser.add_argument("--cpu-affinity",
+                        default="",
+                        type=str,
+                        help="CPUs that the interpreter runs on, e.g. "
+                        "'0-3,8'")
+    parser.add_argument("--thread-count",
+                        default=0,
+                        type=int,
+                        help="Number of threads of the math libraries")
+    parser.add_argument("--bls-socket",
+                        default="",
+                        type=str,
+                        help="Socket of the backend server that runs the "
+                        "inference requests sent by the model")
+    return parser.parse_args(args)
+
+
+def parse_fork_server_arguments():
+    parser = argparse.ArgumentParser(description="Triton Python Fork Server")
+    parser.add_argument("--fork-server-fd",
                         default=None,
                         required=True,
+                        type=int,
+                        help="Socket to receive the fork requests from")
+    parser.add_argument("--preload-modules",
+                        default="",
                         type=str,
-                        help="Triton instance name")
+                        help="Comma separated list of modules to import "
+                        "before forking the interpreters")
     return parser.parse_args()
 
 
+def load_model(module_path):
+    """Import the model file at `module_path` and create its
+    TritonPythonModel.
+    """
+    module_path = Path(module_path).resolve()
+    # Add model parent directories so that relative and absolute import work
+    sys.path.append(str(module_path.parent))
+    sys.path.append(str(module_path.parent.parent))
+
+    # We need to import the parent directory of the module
+    # so that the relative imports work too.
+    spec = importlib.util.spec_from_file_location(
+        f'{module_path.parent.name}.{module_path.name}', str(module_path))
+    module = importlib.util.module_from_spec(spec)
+    spec.loader.exec_module(module)
+
+    if hasattr(module, 'TritonPythonModel'):
+        return module.TritonPythonModel()
+    raise NotImplementedError('TritonPythonModel class doesn\'t exist in ' +
+                              str(module_path))
+
+
+class SequenceStates:
+    """The states of the sequences of a model that uses the sequence batcher.
+    The state of a sequence is kept in the interpreter from the request that
+    starts the sequence to the request that ends it, so every request only
+    needs to carry the new inputs of the sequence.
+    """
+
+    def __init__(self):
+        self._states = {}
+        self._lock = threading.Lock()
+
+    def prepare(self, inference_requests):
+        """Attach the state of its sequence to every request. Returns the
+        requests that the model must execute, and the responses of the
+        others by index: an empty response for the requests that the
+        sequence batcher marked as not ready, and an error for those whose
+        sequence was not started in this interpreter, e.g. because the
+        interpreter was restarted.
+        """
+        model_requests = []
+        skipped_responses = {}
+        with self._lock:
+            for index, inference_request in enumerate(inference_requests):
+                flags = inference_request._sequence_flags
+                if flags & tpb_utils.SEQUENCE_FLAG_NOT_READY:
+                    skipped_responses[index] = tpb_utils.InferenceResponse([])
+                    continue
+
+                correlation_id = inference_request.correlation_id()
+                if flags & tpb_utils.SEQUENCE_FLAG_START:
+                    self._states[correlation_id] = {}
+                state = self._states.get(correlation_id)
+                if state is None:
+                    skipped_responses[index] = tpb_utils.InferenceResponse(
+                        [],
+                        error=tpb_utils.TritonError(
+                            f'the state of sequence {correlation_id} is not '
+                            'available, the sequence must be started again'))
+                    continue
+
+                inference_request._sequence_state = state
+                model_requests.append(inference_request)
+        return model_requests, skipped_responses
+
+    def finish(self, model_requests):
+        """Release the states of the sequences that ended with
+        `model_requests`.
+        """
+        with self._lock:
+            for inference_request in model_requests:
+                if inference_request.is_sequence_end():
+                    self._states.pop(inference_request.correlation_id(),
+                                     None)
+
+
+def uses_sequence_batcher(args):
+    """Whether the model configuration in the arguments of `initialize`
+    enables the sequence batcher.
+    """
+    return 'sequence_batching' in json.loads(args.get('model_config', '{}'))
+
+
+def stream_grace_period(args):
+    """The STREAM_GRACE_PERIOD_MILLISECONDS parameter of the model
+    configuration in the arguments of `initialize`, in seconds. None if it
+    isn't set or is 0, the backend has checked that it is valid.
+    """
+    parameters = json.loads(args.get('model_config', '{}')).get(
+        'parameters', {})
+    value = parameters.get('STREAM_GRACE_PERIOD_MILLISECONDS',
+                           {}).get('string_value', '')
+    if not value or int(value) == 0:
+        return None
+    return int(value) / 1000.0
+
+
+def merge_responses(request_count, skipped_responses, responses):
+    """Interleave the responses of the model with the responses of the
+    requests that SequenceStates.prepare kept from it.
+    """
+    model_responses = iter(responses)
+    return [
+        skipped_responses[index]
+        if index in skipped_responses else next(model_responses)
+        for index in range(request_count)
+    ]
+
+
 class PythonHost(PythonInterpreterServicer):
     """This class handles inference request for python script.
     """
@@ -157,25 +746,43 @@ class PythonHost(PythonInterpreterServicer):
     def __init__(self, module_path, *args, **kwargs):
         super(PythonInterpreterServicer, self).__init__(*args, **kwargs)
 
-        module_path = Path(module_path).resolve()
-        # Add model parent directories so that relative and absolute import work
-        sys.path.append(str(module_path.parent))
-        sys.path.append(str(module_path.parent.parent))
+        # Shared memory regions and CUDA IPC regions of the execution slots
+        # of the instance, keyed by the name of the shared memory region
+        self.shm_regions = {}
+        self.cuda_ipc_regions = {}
 
-        # We need to import the parent directory of the module
-        # so that the relative imports work too.
-        spec = importlib.util.spec_from_file_location(
-            f'{module_path.parent.name}.{module_path.name}', str(module_path))
-        module = importlib.util.module_from_spec(spec)
-        spec.loader.exec_module(module)
+        self.module_path = Path(module_path).resolve()
+        self.model_instance = load_model(self.module_path)
 
-        self.module_path = module_path
+        # Set by Init if the model uses the sequence batcher
+        self.sequence_states = None
 
-        if hasattr(module, 'TritonPythonModel'):
-            self.model_instance = module.TritonPythonModel()
-        else:
-            raise NotImplementedError(
-                'TritonPythonModel class doesn\'t exist in ' + module_path)
+        # Time that a decoupled model may go without sending a response once
+        # its `execute` has returned, before the stream of the execution is
+        # ended without the missing final responses. Set by Init, None waits
+        # for the final responses for as long as it takes.
+        self.stream_grace_period_s = None
+
+    def get_shm_region(self, name):
+        """Get the shared memory region with the given name, the regions are
+        mapped on first use.
+        """
+        shm_region = self.shm_regions.get(name)
+        if shm_region is None:
+            shm_region = SharedMemoryRegion(name)
+            self.shm_regions[name] = shm_region
+        return shm_region
+
+    def get_cuda_ipc_region(self, name, cuda_ipc_region):
+        """Get the CUDA IPC region of the execution slot that uses the shared
+        memory region `name`, the regions are opened on first use.
+        """
+        region = self.cuda_ipc_regions.get(name)
+        if region is None or region.handle != cuda_ipc_region.handle:
+            region = CudaIpcRegion(cuda_ipc_region)
+            self.cuda_ipc_regions[name] = region
+        region.reset(cuda_ipc_region.used)
+        return region
 
     def Init(self, request, context):
         """Init is called on TRITONBACKEND_ModelInstanceInitialize. `request`
@@ -191,8 +798,12 @@ class PythonHost(PythonInterpreterServicer):
             context.set_details('request objects does\'nt have args attribute')
             return Empty()
 
+        args = {x.key: x.value for x in request.args}
+        if uses_sequence_batcher(args):
+            self.sequence_states = SequenceStates()
+        self.stream_grace_period_s = stream_grace_period(args)
+
         if hasattr(model_instance, 'initialize'):
-            args = {x.key: x.value for x in request.args}
             try:
                 self.model_instance.initialize(args)
             except Exception as e:
@@ -217,6 +828,105 @@ class PythonHost(PythonInterpreterServicer):
 
         return Empty()
 
+    def _read_requests(self, request, context):
+        """Create the triton_python_backend_utils.InferenceRequest objects of
+        an ExecuteRequest. Returns them with the shared memory region and the
+        CUDA IPC region of the execution. The requests are cancelled when the
+        gRPC `context` of the execution is.
+        """
+        shm_region = self.get_shm_region(request.shm_region_name)
+        cuda_ipc_region = None
+        if request.HasField('cuda_ipc_region'):
+            cuda_ipc_region = self.get_cuda_ipc_region(
+                request.shm_region_name, request.cuda_ipc_region)
+
+        if request.flat_requests_byte_size > 0:
+            requests = read_flat_requests(
+                shm_region.buffer(request.flat_requests_offset,
+                                  request.flat_requests_byte_size))
+        else:
+            requests = [(r.id, r.correlation_id,
+                         [(x.name, x.dtype, x.dims, x.offset, x.byte_size,
+                           x.memory_type) for x in r.inputs],
+                         r.requested_output_names, r.sequence_flags,
+                         r.timeout_us) for r in request.requests]
+
+        inference_requests = []
+        for (request_id, correlation_id, inputs, requested_output_names,
+             sequence_flags, timeout_us) in requests:
+            # This object contains a list of tpb_utils.Tensor
+            input_tensors = []
+            for name, dtype, dims, offset, byte_size, memory_type in inputs:
+                # The data of an input is only read when the model accesses
+                # it, so the inputs that the model ignores cost nothing
+                input_tensors.append(
+                    tpb_utils.Tensor._lazy(
+                        name,
+                        input_loader(shm_region, cuda_ipc_region, dtype,
+                                     tuple(dims), offset, byte_size,
+                                     memory_type),
+                        in_gpu=(memory_type == TRITONSERVER_MEMORY_GPU)))
+
+            inference_request = tpb_utils.InferenceRequest(
+                input_tensors,
+                request_id,
+                correlation_id,
+                requested_output_names,
+                sequence_flags,
+                timeout_us=timeout_us,
+                is_active=context.is_active)
+            inference_requests.append(inference_request)
+
+        return inference_requests, shm_region, cuda_ipc_region
+
+    def _write_response(self, inference_request, response, shm_region,
+                        cuda_ipc_region):
+        """Convert a triton_python_backend_utils.InferenceResponse to the
+        InferenceResponse message that is sent to the backend. The output
+        tensors are written to the shared memory region or the CUDA IPC
+        region of the execution, except those that `inference_request`
+        didn't request, which the backend would discard.
+        """
+        # If there is an error do not look into output_tensors
+        if response.has_error():
+            error = Error(message=response.error().message())
+            return InferenceResponse(outputs=[], error=error, failed=True)
+
+        output_tensors = response.output_tensors()
+        response_tensors = []
+
+        for output_tensor in output_tensors:
+            if not inference_request.is_output_requested(output_tensor.name()):
+                continue
+
+            if output_tensor.is_cpu():
+                response_tensors.append(
+                    write_tensor(shm_region, output_tensor.name(),
+                                 output_tensor.as_numpy()))
+                continue
+
+            # Outputs in GPU memory stay on the device when CUDA IPC is
+            # enabled and the region has enough space left
+            output_array = output_tensor._as_cupy()
+            offset = None
+            if cuda_ipc_region is not None:
+                offset = cuda_ipc_region.write(output_array)
+            if offset is None:
+                response_tensors.append(
+                    write_tensor(shm_region, output_tensor.name(),
+                                 output_array.get()))
+                continue
+
+            response_tensors.append(
+                Tensor(name=output_tensor.name(),
+                       dtype=output_datatype(output_array),
+                       dims=output_array.shape,
+                       offset=offset,
+                       byte_size=output_array.nbytes,
+                       memory_type=TRITONSERVER_MEMORY_GPU,
+                       memory_type_id=cuda_ipc_region.device_id))
+        return InferenceResponse(outputs=response_tensors)
+
     def Execute(self, request, context):
         """Execute is called on TRITONBACKEND_ModelInstanceExecute. Inference
         happens in this function. This function mainly converts gRPC
@@ -229,35 +939,11 @@ class PythonHost(PythonInterpreterServicer):
             Contains a `requests` attribute which is a list of python_host_pb2.InferenceRequest
         """
 
-        requests = request.requests
-        inference_requests = []
-        for request in requests:
-            # This object contains a list of tpb_utils.Tensor
-            input_tensors = []
-            for request_input in request.inputs:
-                x = request_input
-                numpy_type = tpb_utils.triton_to_numpy_type(x.dtype)
-
-                # We need to deserialize TYPE_STRING
-                if numpy_type == np.object_ or numpy_type == np.bytes_:
-                    numpy_data = deserialize_bytes_tensor(x.raw_data)
-                    tensor = tpb_utils.Tensor(x.name,
-                                              numpy_data.reshape(x.dims))
-                    input_tensors.append(tensor)
-                else:
-                    tensor = tpb_utils.Tensor(
-                        x.name,
-                        np.frombuffer(x.raw_data,
-                                      dtype=numpy_type).reshape(x.dims))
-                    input_tensors.append(tensor)
-
-            request_id = request.id
-            correlation_id = request.correlation_id
-            requested_output_names = request.requested_output_names
-            inference_request = tpb_utils.InferenceRequest(
-                input_tensors, request_id, correlation_id,
-                requested_output_names)
-            inference_requests.append(inference_request)
+        # The durations of the stages are returned to the backend, which
+        # reports them as metrics
+        input_start_ns = time.perf_counter_ns()
+        inference_requests, shm_region, cuda_ipc_region = self._read_requests(
+            request, context)
 
         # Execute inference on the Python model instance. `responses` contains
         # a list of triton_python_backend_utils.InferenceResponse. Each backend
@@ -269,116 +955,418 @@ class PythonHost(PythonInterpreterServicer):
             )
             return ExecuteResponse()
 
+        model_requests, skipped_responses = inference_requests, {}
+        if self.sequence_states is not None:
+            model_requests, skipped_responses = self.sequence_states.prepare(
+                inference_requests)
+
+        # Let tpb_utils.Tensor.empty allocate the outputs in the region
+        tpb_utils._execution_context.shm_region = shm_region
+        compute_start_ns = time.perf_counter_ns()
         try:
-            responses = self.model_instance.execute(inference_requests)
+            responses = self.model_instance.execute(model_requests)
         except Exception as e:
             context.set_code(grpc.StatusCode.INTERNAL)
             tb = traceback.format_exc()
             context.set_details(tb)
+            return ExecuteResponse()
+        finally:
+            tpb_utils._execution_context.shm_region = None
+            if self.sequence_states is not None:
+                self.sequence_states.finish(model_requests)
+        output_start_ns = time.perf_counter_ns()
 
         # Make sure that number of InferenceResponse and InferenceRequest
         # objects match
-        if len(inference_requests) != len(responses):
+        if len(model_requests) != len(responses):
             context.set_code(grpc.StatusCode.INTERNAL)
             context.set_details(
                 'Number of inference responses and requests don\'t match ( requests='
-                + len(inference_requests) + ' != responses=' + len(responses) +
-                ')')
+                + str(len(model_requests)) + ' != responses=' +
+                str(len(responses)) + ')')
             return ExecuteResponse()
+        if skipped_responses:
+            responses = merge_responses(len(inference_requests),
+                                        skipped_responses, responses)
+
+        exec_responses = [
+            self._write_response(inference_request, response, shm_region,
+                                 cuda_ipc_region)
+            for inference_request, response in zip(inference_requests,
+                                                   responses)
+        ]
+        timings = ExecuteTimings(
+            input_ns=compute_start_ns - input_start_ns,
+            compute_ns=output_start_ns - compute_start_ns,
+            output_ns=time.perf_counter_ns() - output_start_ns)
+        execute_response = ExecuteResponse(responses=exec_responses,
+                                           timings=timings)
+
+        return execute_response
 
-        exec_responses = []
-        for response in responses:
-            # If there is an error do not look into output_tensors
-            if response.has_error():
-                error = Error(message=response.error().message())
-                inference_response = InferenceResponse(outputs=[],
-                                                       error=error,
-                                                       failed=True)
-                exec_responses.append(inference_response)
+    def ExecuteStream(self, request, context):
+        """ExecuteStream replaces Execute for the models that use the
+        decoupled transaction policy. The model sends the responses of every
+        request with the sender returned by
+        `InferenceRequest.get_response_sender`, from `execute` or from any
+        other thread, and each response is streamed to the backend as soon as
+        it is sent. The stream ends once `execute` has returned and every
+        request has received its final response, or when no response is sent
+        for `stream_grace_period_s` after `execute` has returned. The backend
+        fails the requests that are left without a final response. A
+        cancelled stream sends nothing more, but only ends once `execute` has
+        returned, since the model may still write to the shared memory
+        region of the execution until then.
+        """
+        input_start_ns = time.perf_counter_ns()
+        inference_requests, shm_region, cuda_ipc_region = self._read_requests(
+            request, context)
+
+        if not hasattr(self.model_instance, 'execute'):
+            context.set_code(grpc.StatusCode.INTERNAL)
+            context.set_details(
+                f'Python model {self.module_path} does not implement `execute` method.'
+            )
+            return
+
+        # (request index, response, flags) for every response sent by the
+        # model, and None once `execute` has returned
+        sent_responses = queue.Queue()
+        for index, inference_request in enumerate(inference_requests):
+            inference_request._response_sender = (
+                tpb_utils.InferenceResponseSender(
+                    lambda response, flags, index=index: sent_responses.put(
+                        (index, response, flags))))
+
+        # The requests that the model doesn't execute are completed right
+        # away with their response
+        model_requests, skipped_responses = inference_requests, {}
+        if self.sequence_states is not None:
+            model_requests, skipped_responses = self.sequence_states.prepare(
+                inference_requests)
+        for index, response in skipped_responses.items():
+            inference_requests[index]._response_sender.send(
+                response, tpb_utils.TRITONSERVER_RESPONSE_COMPLETE_FINAL)
+
+        execute_errors = []
+
+        def run_execute():
+            tpb_utils._execution_context.shm_region = shm_region
+            try:
+                self.model_instance.execute(model_requests)
+            except Exception:
+                execute_errors.append(traceback.format_exc())
+            finally:
+                tpb_utils._execution_context.shm_region = None
+                if self.sequence_states is not None:
+                    self.sequence_states.finish(model_requests)
+                sent_responses.put(None)
+
+        # `execute` runs in its own thread so that the responses are streamed
+        # while it is running
+        compute_start_ns = time.perf_counter_ns()
+        threading.Thread(target=run_execute, daemon=True).start()
+
+        output_ns = 0
+        pending_request_count = len(inference_requests)
+        executing = True
+        grace_deadline = None
+        while executing or pending_request_count > 0:
+            if not context.is_active():
+                # The responses are dropped, but the model may write to the
+                # shared memory region of the execution until `execute` has
+                # returned
+                while executing:
+                    executing = sent_responses.get() is not None
+                return
+            if grace_deadline is not None:
+                remaining_s = grace_deadline - time.monotonic()
+                if remaining_s <= 0:
+                    break
+            else:
+                remaining_s = STREAM_POLL_INTERVAL_S
+            try:
+                sent_response = sent_responses.get(
+                    timeout=min(remaining_s, STREAM_POLL_INTERVAL_S))
+            except queue.Empty:
+                continue
+
+            # The grace period restarts with every response that is sent
+            # after `execute` has returned
+            if ((self.stream_grace_period_s is not None) and
+                    ((sent_response is None) or not executing)):
+                grace_deadline = (time.monotonic() +
+                                  self.stream_grace_period_s)
+            if sent_response is None:
+                executing = False
+                if execute_errors:
+                    context.set_code(grpc.StatusCode.INTERNAL)
+                    context.set_details(execute_errors[0])
+                    return
                 continue
 
-            output_tensors = response.output_tensors()
-            response_tensors = []
+            output_start_ns = time.perf_counter_ns()
+            index, response, flags = sent_response
+            final = (flags & tpb_utils.TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0
+            message = ExecuteStreamResponse(request_index=index, final=final)
+            if response is not None:
+                message.response.CopyFrom(
+                    self._write_response(inference_requests[index], response,
+                                         shm_region, cuda_ipc_region))
+            if final:
+                pending_request_count -= 1
+            output_ns += time.perf_counter_ns() - output_start_ns
+            yield message
 
-            for output_tensor in output_tensors:
-                output_np_array = output_tensor.as_numpy()
-                output_shape = output_np_array.shape
+        # The time spent writing the responses overlaps with `execute`, it is
+        # only counted as output time
+        yield ExecuteStreamResponse(timings=ExecuteTimings(
+            input_ns=compute_start_ns - input_start_ns,
+            compute_ns=time.perf_counter_ns() - compute_start_ns - output_ns,
+            output_ns=output_ns))
 
-                # We need to serialize TYPE_STRING
-                if output_np_array.dtype == np.object or output_np_array.dtype.type is np.bytes_:
-                    output_np_array = serialize_byte_tensor(output_np_array)
 
-                tensor = Tensor(name=output_tensor.name(),
-                                dtype=tpb_utils.numpy_to_triton_type(
-                                    output_np_array.dtype.type),
-                                dims=output_shape,
-                                raw_data=output_np_array.tobytes())
+class WorkerContext:
+    """Records the status that PythonHost sets on the gRPC context when it
+    runs inside a worker process, so that it can be forwarded to the real
+    context.
+    """
 
-                response_tensors.append(tensor)
-            exec_responses.append(InferenceResponse(outputs=response_tensors))
-        execute_response = ExecuteResponse(responses=exec_responses)
+    def __init__(self):
+        self.code = None
+        self.details = None
 
-        return execute_response
+    def set_code(self, code):
+        self.code = code
 
+    def set_details(self, details):
+        self.details = details
 
-def watch_connections(address, event):
-    # Sleep for 4 seconds to ensure that the Python gRPC server has started
-    time.sleep(4)
+    def is_active(self):
+        # A cancelled execution kills the worker with the interpreter
+        return True
 
-    number_of_failures = 0
-    timeout_sec = 1
 
+def set_parent_death_signal(sig):
+    """Have the kernel send `sig` to this process when its parent exits.
+    """
+    PR_SET_PDEATHSIG = 1
+    try:
+        ctypes.CDLL(None).prctl(PR_SET_PDEATHSIG, int(sig))
+    except (OSError, AttributeError):
+        pass
+
+
+def worker_main(python_host, connection, parent_connection, control_fd):
+    """Main loop of a worker process of ProcessPoolHost. `python_host` was
+    created before the fork, so the model module is already imported.
+    """
+    parent_connection.close()
+    # Only the interpreter holds the control socket, so that the backend
+    # notices right away when the interpreter exits
+    if control_fd >= 0:
+        os.close(control_fd)
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+    # The backend kills the interpreter when an execution times out, a worker
+    # that is stuck in the model must not outlive it
+    set_parent_death_signal(signal.SIGKILL)
+
+    request_types = {
+        'Init': InitializationCommand,
+        'Execute': ExecuteRequest,
+        'ExecuteStream': ExecuteRequest,
+        'Fini': Empty
+    }
     while True:
-        # If there are three failures, shutdown the gRPC server.
-        if number_of_failures == 3:
-            event.set()
+        try:
+            method, payload = connection.recv()
+        except EOFError:
+            # The interpreter process has exited
             break
 
-        channel = grpc.insecure_channel(address)
-        try:
-            channelz_stub = channelz_pb2_grpc.ChannelzStub(channel)
-            # Wait for the channel to be ready.
-            grpc.channel_ready_future(channel).result(timeout=timeout_sec)
-        except grpc.FutureTimeoutError:
-            number_of_failures += 1
-            continue
-        servers = channelz_stub.GetServers(
-            channelz_pb2.GetServersRequest(start_server_id=0))
-        sockets = channelz_stub.GetServerSockets(
-            channelz_pb2.GetServerSocketsRequest(
-                server_id=servers.server[0].ref.server_id, start_socket_id=0))
-
-        # There should be always more than one socket connected to the server
-        if len(sockets.socket_ref) == 1:
-            number_of_failures += 1
+        context = WorkerContext()
+        request = request_types[method].FromString(payload)
+        response = getattr(python_host, method)(request, context)
+        if method == 'ExecuteStream':
+            # Every message is forwarded as soon as the model sends it, and
+            # the end of the stream is marked by a message without payload
+            for message in response:
+                connection.send((message.SerializeToString(), None, None))
+            connection.send((None, context.code, context.details))
         else:
-            number_of_failures = 0
+            connection.send(
+                (response.SerializeToString(), context.code, context.details))
 
-        # Sleep for 2 seconds before polling next time
-        time.sleep(2)
 
+class ProcessPoolHost(PythonInterpreterServicer):
+    """Runs the model in a pool of pre-forked worker processes that share the
+    gRPC endpoint of the interpreter. Every worker has its own instance of the
+    model, and reads and writes the tensors in the shared memory regions
+    directly, so only the protobuf metadata goes through the pool.
+    """
 
-if __name__ == "__main__":
+    def __init__(self, python_host, worker_count, control_fd=-1):
+        mp_context = multiprocessing.get_context('fork')
+        self._connections = []
+        self._idle_connections = queue.Queue()
+        for _ in range(worker_count):
+            parent_connection, child_connection = mp_context.Pipe()
+            worker = mp_context.Process(target=worker_main,
+                                        args=(python_host, child_connection,
+                                              parent_connection, control_fd),
+                                        daemon=True)
+            worker.start()
+            child_connection.close()
+            self._connections.append(parent_connection)
+            self._idle_connections.put(parent_connection)
+
+    def _call(self, connection, method, request, response_type, context):
+        try:
+            connection.send((method, request.SerializeToString()))
+            payload, code, details = connection.recv()
+        except (EOFError, OSError):
+            context.set_code(grpc.StatusCode.INTERNAL)
+            context.set_details('Python worker process exited unexpectedly')
+            return response_type()
+
+        if code is not None:
+            context.set_code(code)
+        if details is not None:
+            context.set_details(details)
+        return response_type.FromString(payload)
+
+    def _call_all(self, method, request, context):
+        # Init and Fini must run in every worker since each one has its own
+        # model instance.
+        for connection in self._connections:
+            worker_context = WorkerContext()
+            self._call(connection, method, request, Empty, worker_context)
+            if worker_context.code is not None:
+                context.set_code(worker_context.code)
+                context.set_details(worker_context.details)
+                break
+        return Empty()
+
+    def Init(self, request, context):
+        return self._call_all('Init', request, context)
+
+    def Fini(self, request, context):
+        return self._call_all('Fini', request, context)
+
+    def Execute(self, request, context):
+        connection = self._idle_connections.get()
+        try:
+            return self._call(connection, 'Execute', request, ExecuteResponse,
+                              context)
+        finally:
+            self._idle_connections.put(connection)
+
+    def ExecuteStream(self, request, context):
+        connection = self._idle_connections.get()
+        complete = False
+        try:
+            connection.send(('ExecuteStream', request.SerializeToString()))
+            while True:
+                payload, code, details = connection.recv()
+                if payload is None:
+                    complete = True
+                    break
+                yield ExecuteStreamResponse.FromString(payload)
+        except (EOFError, OSError):
+            context.set_code(grpc.StatusCode.INTERNAL)
+            context.set_details('Python worker process exited unexpectedly')
+            return
+        finally:
+            # The rest of the stream must be read before the worker is used
+            # for another execution, even if the backend has cancelled it
+            try:
+                while not complete:
+                    complete = connection.recv()[0] is None
+            except (EOFError, OSError):
+                pass
+            self._idle_connections.put(connection)
+
+        if code is not None:
+            context.set_code(code)
+        if details is not None:
+            context.set_details(details)
+
+
+def watch_backend(control_fd, event):
+    """Stop the interpreter as soon as the backend closes its end of the
+    control socket, which happens when the instance is unloaded or the server
+    exits.
+    """
+    try:
+        while os.read(control_fd, 1):
+            pass
+    except OSError:
+        pass
+    event.set()
+
+
+# Environment variables that set the number of threads of the math libraries
+THREAD_COUNT_VARIABLES = ('OMP_NUM_THREADS', 'OPENBLAS_NUM_THREADS',
+                          'MKL_NUM_THREADS')
+
+
+def parse_cpu_list(cpu_list):
+    """Get the CPUs of a list in the format of the cpulist files of sysfs.
+    """
+    cpus = set()
+    for cpu_range in cpu_list.split(','):
+        if cpu_range.strip():
+            first, _, last = cpu_range.partition('-')
+            cpus.update(range(int(first), int(last or first) + 1))
+    return cpus
+
+
+def apply_placement(FLAGS):
+    """Restrict the interpreter to its CPUs and set the thread counts of the
+    math libraries. The backend has already done so for an interpreter that it
+    started, this places the interpreters forked by the fork server, which
+    inherit the placement of the fork server otherwise. The libraries that
+    the fork server imported keep their thread counts.
+    """
+    if FLAGS.cpu_affinity:
+        try:
+            os.sched_setaffinity(0, parse_cpu_list(FLAGS.cpu_affinity))
+        except OSError:
+            pass
+    if FLAGS.thread_count > 0:
+        for variable in THREAD_COUNT_VARIABLES:
+            os.environ[variable] = str(FLAGS.thread_count)
+
+
+def serve(FLAGS):
+    """Run the interpreter of a model instance until it is terminated.
+    """
+    apply_placement(FLAGS)
     signal_received = False
-    FLAGS = parse_startup_arguments()
-    server = grpc.server(futures.ThreadPoolExecutor(max_workers=1),
-                         options=[
-                             ('grpc.max_send_message_length',
-                              MAX_GRPC_MESSAGE_SIZE),
-                             ('grpc.max_receive_message_length',
-                              MAX_GRPC_MESSAGE_SIZE),
-                         ])
-    channelz.add_channelz_servicer(server)
+    if FLAGS.bls_socket:
+        tpb_utils._bls_executor = BlsClient(FLAGS.bls_socket)
+    python_host = PythonHost(module_path=FLAGS.model_path)
+
+    # The worker processes must be forked before the gRPC server is created
+    if FLAGS.worker_type == 'process':
+        python_host = ProcessPoolHost(python_host, FLAGS.worker_count,
+                                      FLAGS.control_fd)
+
+    server = grpc.server(
+        futures.ThreadPoolExecutor(max_workers=FLAGS.worker_count),
+        options=[
+            ('grpc.max_send_message_length', MAX_GRPC_MESSAGE_SIZE),
+            ('grpc.max_receive_message_length', MAX_GRPC_MESSAGE_SIZE),
+        ])
     # Create an Event to keep the GRPC server running
     event = threading.Event()
-    python_host = PythonHost(module_path=FLAGS.model_path)
     add_PythonInterpreterServicer_to_server(python_host, server)
 
     def interrupt_handler(signum, frame):
         pass
 
     def sigterm_handler(signum, frame):
-        global signal_received
+        nonlocal signal_received
         if not signal_received:
             signal_received = True
         else:
@@ -392,14 +1380,93 @@ if __name__ == "__main__":
     server.add_insecure_port(FLAGS.socket)
     server.start()
 
-    # A Background thread to monitor the status of the gRPC server
-    background_thread = threading.Thread(target=watch_connections,
-                                         args=(FLAGS.socket, event))
+    # Let the backend know that it can connect, instead of having it retry.
+    # The socket is kept open so that the backend notices when this process
+    # exits.
+    if FLAGS.control_fd >= 0:
+        os.write(FLAGS.control_fd, b'1')
 
-    # Set background_thread as a daemon thread so that it doesn't interrupt the
-    # program termination
-    background_thread.daemon = True
-    background_thread.start()
+        # Set background_thread as a daemon thread so that it doesn't
+        # interrupt the program termination
+        background_thread = threading.Thread(target=watch_backend,
+                                             args=(FLAGS.control_fd, event))
+        background_thread.daemon = True
+        background_thread.start()
     event.wait()
     server.stop(grace=5)
+
+
+# Layout of the fork server messages, must match ForkServer in
+# fork_server.cc
+FORK_SERVER_MAX_REQUEST_SIZE = 64 * 1024
+FORK_SERVER_FD = struct.Struct('=i')
+FORK_SERVER_REPLY = struct.Struct('=q')
+
+
+def fork_server_main(FLAGS):
+    """Fork the interpreters of the model instances on request of the backend.
+    The modules imported here, including grpc and numpy, are shared with the
+    forked interpreters, so they don't import them again. Nothing that starts
+    threads, such as a gRPC server or CUDA, may be used before forking.
+    """
+    for module in FLAGS.preload_modules.split(','):
+        if module.strip():
+            importlib.import_module(module.strip())
+
+    # The forked interpreters are reaped automatically
+    signal.signal(signal.SIGCHLD, signal.SIG_IGN)
+    signal.signal(signal.SIGINT, signal.SIG_IGN)
+
+    connection = socket.socket(fileno=FLAGS.fork_server_fd)
+    while True:
+        # Every request is the NUL separated arguments of startup.py, with the
+        # file descriptor of the control socket attached
+        request, ancdata, _, _ = connection.recvmsg(
+            FORK_SERVER_MAX_REQUEST_SIZE,
+            socket.CMSG_SPACE(FORK_SERVER_FD.size))
+        if not request:
+            # The backend has closed the socket
+            break
+
+        control_fd = -1
+        for level, kind, data in ancdata:
+            if level == socket.SOL_SOCKET and kind == socket.SCM_RIGHTS:
+                control_fd = FORK_SERVER_FD.unpack_from(data)[0]
+        args = [
+            os.fsdecode(arg) for arg in request.rstrip(b'\0').split(b'\0')
+        ]
+        args += ['--control-fd', str(control_fd)]
+
+        try:
+            pid = os.fork()
+        except OSError as e:
+            pid = -e.errno
+
+        if pid == 0:
+            connection.close()
+            signal.signal(signal.SIGCHLD, signal.SIG_DFL)
+            signal.signal(signal.SIGINT, signal.SIG_DFL)
+            exit_code = 1
+            try:
+                serve(parse_startup_arguments(args))
+                exit_code = 0
+            except SystemExit as e:
+                exit_code = e.code if isinstance(e.code, int) else 1
+            except BaseException:
+                traceback.print_exc()
+            finally:
+                sys.stdout.flush()
+                sys.stderr.flush()
+                os._exit(exit_code)
+
+        if control_fd >= 0:
+            os.close(control_fd)
+        connection.send(FORK_SERVER_REPLY.pack(pid))
+
+
+if __name__ == "__main__":
+    if '--fork-server-fd' in sys.argv[1:]:
+        fork_server_main(parse_fork_server_arguments())
+    else:
+        serve(parse_startup_arguments())
     sys.exit()
@@ -24,6 +24,11 @@
 # (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
 # OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 
+import fcntl
+import os
+import threading
+import time
+
 import numpy as np
 
 TRITON_TO_NUMPY_TYPE = {
@@ -74,6 +79,16 @@ TRITON_STRING_TO_NUMPY = {
 NUMPY_TO_TRITON_TYPE = {v: k for k, v in TRITON_TO_NUMPY_TYPE.items()}
 NUMPY_TO_TRITON_STRING = {v: k for k, v in TRITON_TO_NUMPY_TYPE.items()}
 
+# Flag of InferenceResponseSender.send that marks the last response of a
+# request, same value as in tritonserver.h
+TRITONSERVER_RESPONSE_COMPLETE_FINAL = 1
+
+# Sequence flags of a request, same values as SequenceFlag in
+# python_host.proto
+SEQUENCE_FLAG_START = 1
+SEQUENCE_FLAG_END = 2
+SEQUENCE_FLAG_NOT_READY = 4
+
 
 class InferenceRequest:
     """InferenceRequest represents a request for inference for a model that
@@ -92,14 +107,46 @@ class InferenceRequest:
     requested_output_name : list
         The names of the output tensors that should be calculated and
         returned for this request.
+    sequence_flags : int
+        The SEQUENCE_FLAG_* bits of the request, for the models that use the
+        sequence batcher.
+    timeout_us : int
+        Time left before the request times out, in microseconds, or 0 if the
+        request has no timeout.
+    is_active : callable
+        Function that returns False once the execution of the request is
+        cancelled, or None if it can't be cancelled.
+    model_name : str
+        Name of the model that the request is sent to by `exec`.
+    model_version : int
+        Version of the model that the request is sent to by `exec`, or -1 for
+        the latest version.
     """
 
-    def __init__(self, inputs, request_id, correlation_id,
-                 requested_output_names):
+    def __init__(self,
+                 inputs,
+                 request_id='',
+                 correlation_id=0,
+                 requested_output_names=(),
+                 sequence_flags=0,
+                 timeout_us=0,
+                 is_active=None,
+                 model_name=None,
+                 model_version=-1):
         self._inputs = inputs
         self._request_id = request_id
         self._correlation_id = correlation_id
         self._requested_output_names = requested_output_names
+        self._requested_output_name_set = None
+        self._response_sender = None
+        self._sequence_flags = sequence_flags
+        self._sequence_state = None
+        self._deadline = None
+        if timeout_us > 0:
+            self._deadline = time.monotonic() + timeout_us / 1e6
+        self._is_active = is_active
+        self._model_name = model_name
+        self._model_version = model_version
 
     def inputs(self):
         """Get input tensors
@@ -137,6 +184,178 @@ class InferenceRequest:
         """
         return self._requested_output_names
 
+    def is_output_requested(self, name):
+        """Check whether an output is requested. Models with many outputs can
+        use it to skip computing the outputs that are not needed, the outputs
+        that are not requested are never sent to Triton.
+        Parameters
+        ----------
+        name : str
+            The name of the output
+        Returns
+        -------
+        bool
+            True if the output `name` is requested
+        """
+        if self._requested_output_name_set is None:
+            self._requested_output_name_set = frozenset(
+                self._requested_output_names)
+        return name in self._requested_output_name_set
+
+    def is_sequence_start(self):
+        """Whether this request starts its sequence
+        Returns
+        -------
+        bool
+            True if this is the first request of the sequence
+        """
+        return (self._sequence_flags & SEQUENCE_FLAG_START) != 0
+
+    def is_sequence_end(self):
+        """Whether this request ends its sequence
+        Returns
+        -------
+        bool
+            True if this is the last request of the sequence
+        """
+        return (self._sequence_flags & SEQUENCE_FLAG_END) != 0
+
+    def sequence_state(self):
+        """Get the state of the sequence of this request. The state is a dict
+        in which the model keeps anything it needs for the next requests of
+        the sequence, e.g. the tensors of the context seen so far. It is
+        empty for the first request of a sequence and released after the
+        last one. Only available to the models that use the sequence
+        batcher.
+        Returns
+        -------
+        dict
+            The state of the sequence
+        """
+        if self._sequence_state is None:
+            raise TritonModelException(
+                'sequence states are only available to models that use the '
+                'sequence batcher')
+        return self._sequence_state
+
+    def remaining_time(self):
+        """Get the time left before this request times out. The timeout is
+        counted from when the backend received the request.
+        Returns
+        -------
+        float
+            The number of seconds left, negative once the request has timed
+            out, or None if the request has no timeout
+        """
+        if self._deadline is None:
+            return None
+        return self._deadline - time.monotonic()
+
+    def is_cancelled(self):
+        """Check whether the response of this request is no longer needed
+        because the request has timed out or the backend has given up on the
+        execution. Models that take long can check it to stop working on the
+        request early.
+        Returns
+        -------
+        bool
+            True if the request is cancelled
+        """
+        if (self._deadline is not None) and (time.monotonic() >=
+                                             self._deadline):
+            return True
+        return (self._is_active is not None) and (not self._is_active())
+
+    def model_name(self):
+        """Get the name of the model that `exec` sends the request to
+        Returns
+        -------
+        str
+            The model name, or None for the requests received by the model
+        """
+        return self._model_name
+
+    def model_version(self):
+        """Get the version of the model that `exec` sends the request to
+        Returns
+        -------
+        int
+            The model version, or -1 for the latest version
+        """
+        return self._model_version
+
+    def exec(self):
+        """Send this request to the model `model_name` loaded in Triton and
+        wait for its response. The input tensors are passed to the model, and
+        the output tensors are returned, through the memory that is shared
+        with Triton. The output tensors are only valid until `execute`
+        returns. Requests can only be sent from `execute`, and the requests
+        sent by the threads of an execution run one at a time.
+        Returns
+        -------
+        InferenceResponse
+            The response of the model, with an error if the request failed
+        """
+        if self._model_name is None:
+            raise TritonModelException(
+                'the request has no model name to send it to')
+        if _bls_executor is None:
+            raise TritonModelException(
+                'inference requests can only be sent by models that run in '
+                'an interpreter process')
+        return _bls_executor(self)
+
+    def get_response_sender(self):
+        """Get the sender of the responses of this request. Only available
+        to the models that use the decoupled transaction policy.
+        Returns
+        -------
+        InferenceResponseSender
+            The sender of the responses of this request
+        """
+        if self._response_sender is None:
+            raise TritonModelException(
+                'response senders are only available to decoupled models')
+        return self._response_sender
+
+
+class InferenceResponseSender:
+    """InferenceResponseSender sends the responses of a request of a model
+    that uses the decoupled transaction policy. Each response is delivered to
+    the client as soon as it is sent, and the last one of the request must
+    have the TRITONSERVER_RESPONSE_COMPLETE_FINAL flag. The tensors of a
+    response must not be modified after it is sent.
+    """
+
+    def __init__(self, send_callback):
+        self._send_callback = send_callback
+        self._complete = False
+        self._lock = threading.Lock()
+
+    def send(self, response=None, flags=0):
+        """Send a response of the request. It can be called from any thread.
+        Parameters
+        ----------
+        response : InferenceResponse
+            The response to send. It may only be None when `flags` has
+            TRITONSERVER_RESPONSE_COMPLETE_FINAL, to complete the request
+            without sending another response.
+        flags : int
+            TRITONSERVER_RESPONSE_COMPLETE_FINAL if this is the last response
+            of the request, 0 otherwise
+        """
+        final = (flags & TRITONSERVER_RESPONSE_COMPLETE_FINAL) != 0
+        if response is None and not final:
+            raise TritonModelException(
+                'a response without the final flag must not be None')
+
+        with self._lock:
+            if self._complete:
+                raise TritonModelException(
+                    'the final response of the request was already sent')
+            self._complete = final
+            self._send_callback(response, flags)
+
 
 class InferenceResponse:
     """An InfrenceResponse object is used to represent the response to an
@@ -183,6 +402,28 @@ class InferenceResponse:
         return self._err
 
 
+# State of the `execute` call that is running in the current thread. startup.py
+# sets `shm_region` to the shared memory region of the execution so that the
+# outputs can be allocated in it.
+_execution_context = threading.local()
+
+# Runs the requests of InferenceRequest.exec, set by startup.py when the
+# model can send requests to the other models
+_bls_executor = None
+
+
+def _import_cupy():
+    """cupy is only required by the models that exchange tensors in GPU
+    memory, so it is imported on first use.
+    """
+    try:
+        import cupy
+    except ImportError:
+        raise TritonModelException(
+            "cupy is required to use tensors in GPU memory")
+    return cupy
+
+
 class Tensor:
     """A Tensor object is used to represent inputs and output data for an
     InferenceRequest or InferenceResponse.
@@ -200,6 +441,100 @@ class Tensor:
 
         self._name = name
         self._numpy_array = numpy_array
+        self._cupy_array = None
+        self._in_gpu = False
+        self._load = None
+
+    @classmethod
+    def empty(cls, name, shape, dtype):
+        """Create an output Tensor whose data is allocated directly in the
+        memory that is shared with Triton. Writing the result of the model
+        into `as_numpy()`, e.g. with the `out` argument of numpy functions,
+        avoids copying the output when it is returned. This is only
+        possible during `execute`, otherwise the data is allocated in
+        private memory.
+        Parameters
+        ----------
+        name : str
+            Tensor name
+        shape : tuple
+            Shape of the tensor
+        dtype : numpy.dtype
+            Datatype of the tensor, it can't be a variable size datatype
+        Returns
+        -------
+        Tensor
+            The Tensor object
+        """
+        dtype = np.dtype(dtype)
+        if dtype.hasobject or dtype.type == np.bytes_:
+            raise TritonModelException(
+                "can't allocate tensor '" + name + "' with datatype " +
+                str(dtype))
+
+        shm_region = getattr(_execution_context, 'shm_region', None)
+        if shm_region is None:
+            return cls(name, np.empty(shape, dtype=dtype))
+
+        byte_size = int(np.prod(shape, dtype=np.int64)) * dtype.itemsize
+        offset = shm_region.allocate(byte_size)
+        return cls(name, shm_region.ndarray(offset, dtype, shape))
+
+    @classmethod
+    def from_dlpack(cls, name, dlpack_capsule):
+        """Create a Tensor in GPU memory from a DLPack capsule, e.g. the
+        result of `torch.utils.dlpack.to_dlpack`. The data is not copied.
+        Parameters
+        ----------
+        name : str
+            Tensor name
+        dlpack_capsule : PyCapsule
+            A DLPack capsule of a tensor in GPU memory
+        Returns
+        -------
+        Tensor
+            The Tensor object
+        """
+        cupy = _import_cupy()
+        from_dlpack = getattr(cupy, 'from_dlpack', None) or cupy.fromDlpack
+        return cls._from_cupy(name, from_dlpack(dlpack_capsule))
+
+    @classmethod
+    def _from_cupy(cls, name, cupy_array):
+        tensor = cls.__new__(cls)
+        tensor._name = name
+        tensor._numpy_array = None
+        tensor._cupy_array = cupy_array
+        tensor._in_gpu = True
+        tensor._load = None
+        return tensor
+
+    @classmethod
+    def _lazy(cls, name, load, in_gpu=False):
+        """Create an input Tensor whose data is only read when the model
+        accesses it. `load` returns the numpy array of the tensor, or its
+        cupy array if `in_gpu` is True.
+        """
+        tensor = cls.__new__(cls)
+        tensor._name = name
+        tensor._numpy_array = None
+        tensor._cupy_array = None
+        tensor._in_gpu = in_gpu
+        tensor._load = load
+        return tensor
+
+    def _materialize(self):
+        if self._load is not None:
+            data = self._load()
+            self._load = None
+            if self._in_gpu:
+                self._cupy_array = data
+            else:
+                self._numpy_array = data
+
+    def _as_cupy(self):
+        self._materialize()
+        return self._cupy_array
 
     def name(self):
         """Get the name of tensor
@@ -210,6 +545,16 @@ class Tensor:
         """
         return self._name
 
+    def is_cpu(self):
+        """Whether the tensor is in CPU memory
+        Returns
+        -------
+        bool
+            True if the data can be accessed with `as_numpy`, False if the
+            tensor is in GPU memory and must be accessed with `to_dlpack`
+        """
+        return not self._in_gpu
+
     def as_numpy(self):
         """Get the underlying numpy array
         Returns
@@ -217,8 +562,28 @@ class Tensor:
         numpy.ndarray
             The numpy array
         """
+        if not self.is_cpu():
+            raise TritonModelException(
+                "tensor '" + self._name +
+                "' is in GPU memory, use to_dlpack() to access it")
+        self._materialize()
         return self._numpy_array
 
+    def to_dlpack(self):
+        """Get a DLPack capsule of a tensor in GPU memory, which can be
+        consumed by e.g. `torch.utils.dlpack.from_dlpack` without copying
+        the data. Input tensors are only valid until `execute` returns.
+        Returns
+        -------
+        PyCapsule
+            The DLPack capsule
+        """
+        if self.is_cpu():
+            raise TritonModelException(
+                "tensor '" + self._name +
+                "' is in CPU memory, use as_numpy() to access it")
+        return self._as_cupy().toDlpack()
+
 
 class TritonError:
     """Error indicating non-Success status.
@@ -270,6 +635,62 @@ class TritonModelException(Exception):
         return self._msg
 
 
+def get_shared_array(args, name, create):
+    """Get an array of the weight store of the model, which the instances of
+    the model version share read-only through a memory-mapped file instead of
+    each loading their own copy. The first instance that asks for the array
+    calls `create` and writes its result to the store, the other instances
+    wait for it and map the stored array. The store is kept while the model
+    version is loaded, including across reloads that don't change the files
+    of the version directory, so an array created from other files must be
+    given a new name when they change.
+    Parameters
+    ----------
+    args : dict
+        The argument of the initialize function of the model
+    name : str
+        Name of the array, unique within the model version
+    create : callable
+        Function without arguments that returns the numpy array to store
+    Returns
+    -------
+    numpy.ndarray
+        The read-only memory-mapped array
+    """
+    store = args.get('model_weight_store', '')
+    if not store:
+        raise TritonModelException('the weight store is not available')
+    if (not name) or ('/' in name) or name.startswith('.'):
+        raise TritonModelException(
+            "invalid name '{}' for an array of the weight store".format(name))
+
+    # The instances are initialized concurrently, the lock lets a single one
+    # create the array. It is written to a temporary file so that an instance
+    # that fails while writing doesn't leave a partial array behind.
+    path = os.path.join(store, name + '.npy')
+    with open(path + '.lock', 'a') as lock:
+        fcntl.flock(lock, fcntl.LOCK_EX)
+        try:
+            if not os.path.exists(path):
+                array = np.asarray(create())
+                if array.dtype == np.object_:
+                    raise TritonModelException(
+                        "array '{}' of the weight store can't have objects".
+                        format(name))
+                stored = np.lib.format.open_memmap(path + '.tmp',
+                                                   mode='w+',
+                                                   dtype=array.dtype,
+                                                   shape=array.shape)
+                stored[...] = array
+                stored.flush()
+                del stored
+                os.rename(path + '.tmp', path)
+        finally:
+            fcntl.flock(lock, fcntl.LOCK_UN)
+
+    return np.load(path, mmap_mode='r')
+
+
 def get_input_tensor_by_name(inference_request, name):
     """Find an input Tensor in the inference_request that has the given
     name
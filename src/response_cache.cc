@@ -0,0 +1,341 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "response_cache.h"
+
+#include <cstring>
+#include <utility>
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Bookkeeping of an entry that is counted in addition to its data
+constexpr uint64_t kEntryOverhead = 128;
+
+constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+uint64_t
+RotateLeft(const uint64_t value, const int bits)
+{
+  return (value << bits) | (value >> (64 - bits));
+}
+
+uint64_t
+Load64(const char* data)
+{
+  uint64_t value;
+  memcpy(&value, data, sizeof(value));
+  return value;
+}
+
+uint64_t
+Round(uint64_t acc, const uint64_t input)
+{
+  acc += input * kPrime2;
+  return RotateLeft(acc, 31) * kPrime1;
+}
+
+// Hash of 'size' bytes of 'data' with 'seed', following XXH64. The four
+// lanes hash large inputs at several bytes per cycle.
+uint64_t
+HashBytes(const void* data, const size_t size, const uint64_t seed)
+{
+  const char* bytes = reinterpret_cast<const char*>(data);
+  size_t i = 0;
+  uint64_t hash;
+  if (size >= 32) {
+    uint64_t lanes[4] = {seed + kPrime1 + kPrime2, seed + kPrime2, seed,
+                         seed - kPrime1};
+    for (; (i + 32) <= size; i += 32) {
+      for (int l = 0; l < 4; ++l) {
+        lanes[l] = Round(lanes[l], Load64(bytes + i + (8 * l)));
+      }
+    }
+    hash = RotateLeft(lanes[0], 1) + RotateLeft(lanes[1], 7) +
+           RotateLeft(lanes[2], 12) + RotateLeft(lanes[3], 18);
+    for (int l = 0; l < 4; ++l) {
+      hash = ((hash ^ Round(0, lanes[l])) * kPrime1) + kPrime4;
+    }
+  } else {
+    hash = seed + kPrime5;
+  }
+  hash += size;
+
+  for (; (i + 8) <= size; i += 8) {
+    hash ^= Round(0, Load64(bytes + i));
+    hash = (RotateLeft(hash, 27) * kPrime1) + kPrime4;
+  }
+  for (; i < size; ++i) {
+    hash ^= static_cast<uint8_t>(bytes[i]) * kPrime5;
+    hash = RotateLeft(hash, 11) * kPrime1;
+  }
+
+  hash ^= hash >> 33;
+  hash *= kPrime2;
+  hash ^= hash >> 29;
+  hash *= kPrime3;
+  hash ^= hash >> 32;
+  return hash;
+}
+
+// Call 'visit' with every part of the description of 'request': its inputs,
+// including their data, and its requested outputs. 'cacheable' is set to
+// false, and the description is incomplete, if some of the input data is in
+// GPU memory.
+template <typename Visitor>
+TRITONSERVER_Error*
+VisitRequest(TRITONBACKEND_Request* request, Visitor* visit, bool* cacheable)
+{
+  *cacheable = true;
+
+  // Strings are length-prefixed so that different requests can't have the
+  // same description
+  auto visit_value = [visit](const uint64_t value) {
+    (*visit)(&value, sizeof(value));
+  };
+  auto visit_string = [visit, &visit_value](const char* value) {
+    const size_t length = strlen(value);
+    visit_value(length);
+    (*visit)(value, length);
+  };
+
+  uint32_t input_count;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestInputCount(request, &input_count));
+  visit_value(input_count);
+  for (uint32_t i = 0; i < input_count; ++i) {
+    TRITONBACKEND_Input* input;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestInputByIndex(request, i, &input));
+
+    const char* name;
+    TRITONSERVER_DataType dtype;
+    const int64_t* shape;
+    uint32_t dims_count;
+    uint64_t byte_size;
+    uint32_t buffer_count;
+    RETURN_IF_ERROR(TRITONBACKEND_InputProperties(
+        input, &name, &dtype, &shape, &dims_count, &byte_size,
+        &buffer_count));
+    visit_string(name);
+    visit_value(dtype);
+    visit_value(dims_count);
+    for (uint32_t d = 0; d < dims_count; ++d) {
+      visit_value(shape[d]);
+    }
+    visit_value(byte_size);
+
+    // The same data split into different buffers hashes differently, which
+    // only makes the request miss the cache
+    for (uint32_t b = 0; b < buffer_count; ++b) {
+      const void* buffer;
+      uint64_t buffer_byte_size;
+      TRITONSERVER_MemoryType memory_type = TRITONSERVER_MEMORY_CPU;
+      int64_t memory_type_id = 0;
+      RETURN_IF_ERROR(TRITONBACKEND_InputBuffer(
+          input, b, &buffer, &buffer_byte_size, &memory_type,
+          &memory_type_id));
+      if (memory_type == TRITONSERVER_MEMORY_GPU) {
+        *cacheable = false;
+        return nullptr;
+      }
+      (*visit)(buffer, buffer_byte_size);
+    }
+  }
+
+  uint32_t output_count;
+  RETURN_IF_ERROR(TRITONBACKEND_RequestOutputCount(request, &output_count));
+  visit_value(output_count);
+  for (uint32_t i = 0; i < output_count; ++i) {
+    const char* name;
+    RETURN_IF_ERROR(TRITONBACKEND_RequestOutputName(request, i, &name));
+    visit_string(name);
+  }
+
+  return nullptr;
+}
+
+// Visitors of the description of a request, which hash it, copy it, or
+// compare it with a copy without copying the input data.
+struct RequestHasher {
+  void operator()(const void* data, const size_t size)
+  {
+    hash = HashBytes(data, size, hash);
+  }
+  uint64_t hash = 0;
+};
+
+struct RequestWriter {
+  void operator()(const void* data, const size_t size)
+  {
+    description.append(reinterpret_cast<const char*>(data), size);
+  }
+  std::string description;
+};
+
+struct RequestMatcher {
+  explicit RequestMatcher(const std::string& description)
+      : description(description)
+  {
+  }
+  void operator()(const void* data, const size_t size)
+  {
+    matches = matches && ((offset + size) <= description.size()) &&
+              (memcmp(description.data() + offset, data, size) == 0);
+    offset += size;
+  }
+  bool Matches() const { return matches && (offset == description.size()); }
+
+  const std::string& description;
+  size_t offset = 0;
+  bool matches = true;
+};
+
+}  // namespace
+
+ResponseCache::ResponseCache(const uint64_t byte_size)
+    : max_byte_size_(byte_size), byte_size_(0)
+{
+}
+
+TRITONSERVER_Error*
+ResponseCache::Create(
+    const uint64_t byte_size, std::unique_ptr<ResponseCache>* cache)
+{
+  if (byte_size == 0) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        "the size of the response cache must be larger than 0");
+  }
+
+  cache->reset(new ResponseCache(byte_size));
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ResponseCache::RequestKey(TRITONBACKEND_Request* request, CacheKey* key)
+{
+  RequestHasher hasher;
+  RETURN_IF_ERROR(VisitRequest(request, &hasher, &key->cacheable));
+  key->hash = hasher.hash;
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ResponseCache::Lookup(
+    const CacheKey& key, TRITONBACKEND_Request* request,
+    std::shared_ptr<const CachedResponse>* response)
+{
+  response->reset();
+
+  std::shared_ptr<const CachedValue> value;
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    auto it = index_.find(key.hash);
+    if (it == index_.end()) {
+      return nullptr;
+    }
+    lru_.splice(lru_.begin(), lru_, it->second);
+    value = it->second->value;
+  }
+
+  // The inputs are compared outside of the lock, the value is kept alive by
+  // the reference even if it is evicted meanwhile
+  RequestMatcher matcher(value->request);
+  bool cacheable;
+  RETURN_IF_ERROR(VisitRequest(request, &matcher, &cacheable));
+  if (cacheable && matcher.Matches()) {
+    *response =
+        std::shared_ptr<const CachedResponse>(value, &value->response);
+  }
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ResponseCache::Insert(
+    const CacheKey& key, TRITONBACKEND_Request* request,
+    CachedResponse&& response)
+{
+  uint64_t byte_size = kEntryOverhead;
+  for (const CachedOutput& output : response) {
+    byte_size += output.name.size() + output.data.size() +
+                 (output.shape.size() * sizeof(int64_t)) + kEntryOverhead;
+  }
+  if (byte_size > max_byte_size_) {
+    return nullptr;
+  }
+
+  // Another instance may have cached the same response in the meantime, the
+  // request is only copied if it is likely to be inserted
+  {
+    std::lock_guard<std::mutex> lk(mu_);
+    if (index_.find(key.hash) != index_.end()) {
+      return nullptr;
+    }
+  }
+
+  RequestWriter writer;
+  bool cacheable;
+  RETURN_IF_ERROR(VisitRequest(request, &writer, &cacheable));
+  if (!cacheable) {
+    return nullptr;
+  }
+  byte_size += writer.description.size();
+  if (byte_size > max_byte_size_) {
+    return nullptr;
+  }
+
+  std::shared_ptr<CachedValue> value(new CachedValue());
+  value->request = std::move(writer.description);
+  value->response = std::move(response);
+
+  std::lock_guard<std::mutex> lk(mu_);
+
+  // A colliding request keeps the entry it already has
+  if (index_.find(key.hash) != index_.end()) {
+    return nullptr;
+  }
+
+  while ((byte_size_ + byte_size) > max_byte_size_) {
+    const Entry& lru_entry = lru_.back();
+    byte_size_ -= lru_entry.byte_size;
+    index_.erase(lru_entry.hash);
+    lru_.pop_back();
+  }
+
+  lru_.push_front(Entry{key.hash, std::move(value), byte_size});
+  index_.emplace(key.hash, lru_.begin());
+  byte_size_ += byte_size;
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
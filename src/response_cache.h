@@ -0,0 +1,114 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// An output of a response that is kept in the ResponseCache.
+struct CachedOutput {
+  std::string name;
+  TRITONSERVER_DataType dtype;
+  std::vector<int64_t> shape;
+  std::string data;
+};
+
+using CachedResponse = std::vector<CachedOutput>;
+
+// Key of a request in the ResponseCache, a hash of its inputs, including
+// their data, and of its requested outputs.
+struct CacheKey {
+  // False if the request can't be cached because some of its input data is
+  // in GPU memory
+  bool cacheable = false;
+  uint64_t hash = 0;
+};
+
+// A size-bounded LRU cache of the responses of a deterministic model, shared
+// by all the instances of the model. A response is keyed on a hash of the
+// inputs of the request, including their data, and of its requested outputs,
+// so a cache hit is answered without sending the request to the Python
+// interpreter. The inputs are kept with the response and compared with the
+// request on a hit, so a hash collision is a miss.
+class ResponseCache {
+ public:
+  static TRITONSERVER_Error* Create(
+      const uint64_t byte_size, std::unique_ptr<ResponseCache>* cache);
+
+  // Build the key of 'request' in 'key'.
+  static TRITONSERVER_Error* RequestKey(
+      TRITONBACKEND_Request* request, CacheKey* key);
+
+  // Get the response cached for 'request', whose cacheable key is 'key', in
+  // 'response', or nullptr if there is none.
+  TRITONSERVER_Error* Lookup(
+      const CacheKey& key, TRITONBACKEND_Request* request,
+      std::shared_ptr<const CachedResponse>* response);
+
+  // Cache 'response' for 'request', whose cacheable key is 'key', evicting
+  // the least recently used responses that don't fit anymore. Responses
+  // larger than the cache are not kept.
+  TRITONSERVER_Error* Insert(
+      const CacheKey& key, TRITONBACKEND_Request* request,
+      CachedResponse&& response);
+
+ private:
+  // A response with the description of the request it was cached for
+  struct CachedValue {
+    std::string request;
+    CachedResponse response;
+  };
+
+  struct Entry {
+    uint64_t hash;
+    std::shared_ptr<const CachedValue> value;
+    uint64_t byte_size;
+  };
+
+  ResponseCache(const uint64_t byte_size);
+
+  const uint64_t max_byte_size_;
+  std::mutex mu_;
+  uint64_t byte_size_;
+
+  // Most recently used entry first
+  std::list<Entry> lru_;
+  std::unordered_map<uint64_t, std::list<Entry>::iterator> index_;
+};
+
+}}}  // namespace triton::backend::python
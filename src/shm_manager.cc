@@ -0,0 +1,235 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "shm_manager.h"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include "placement.h"
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Alignment of every tensor placed in the region. 64 bytes keeps the numpy
+// arrays created on the Python side cache-line aligned.
+constexpr uint64_t kAlignment = 64;
+
+uint64_t
+AlignedOffset(const uint64_t offset)
+{
+  return (offset + kAlignment - 1) & ~(kAlignment - 1);
+}
+
+TRITONSERVER_Error*
+ErrnoError(const std::string& msg)
+{
+  return TRITONSERVER_ErrorNew(
+      TRITONSERVER_ERROR_INTERNAL,
+      (msg + ": " + std::string(strerror(errno))).c_str());
+}
+
+}  // namespace
+
+SharedMemory::SharedMemory(const std::string& name, const int numa_node)
+    : name_(name), fd_(-1), numa_node_(numa_node), base_(nullptr),
+      mapped_byte_size_(0), header_(nullptr)
+{
+}
+
+TRITONSERVER_Error*
+SharedMemory::Create(
+    const std::string& name, const size_t default_byte_size,
+    const size_t growth_byte_size, const int numa_node,
+    std::unique_ptr<SharedMemory>* shm)
+{
+  if (default_byte_size <= sizeof(SharedMemoryHeader)) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("shared memory region size must be larger than ") +
+         std::to_string(sizeof(SharedMemoryHeader)) + " bytes")
+            .c_str());
+  }
+
+  std::unique_ptr<SharedMemory> region(new SharedMemory(name, numa_node));
+  region->fd_ =
+      shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+  if (region->fd_ == -1) {
+    return ErrnoError("failed to create shared memory region '" + name + "'");
+  }
+
+  if (ftruncate(region->fd_, default_byte_size) == -1) {
+    return ErrnoError("failed to resize shared memory region '" + name + "'");
+  }
+
+  RETURN_IF_ERROR(region->Map(default_byte_size));
+  region->header_->capacity = default_byte_size;
+  region->header_->growth_byte_size = growth_byte_size;
+  region->Reset();
+
+  *shm = std::move(region);
+  return nullptr;
+}
+
+SharedMemory::~SharedMemory()
+{
+  for (const auto& mapping : retired_mappings_) {
+    munmap(mapping.first, mapping.second);
+  }
+  if (base_ != nullptr) {
+    munmap(base_, mapped_byte_size_);
+  }
+
+  if (fd_ != -1) {
+    close(fd_);
+    shm_unlink(name_.c_str());
+  }
+}
+
+TRITONSERVER_Error*
+SharedMemory::Map(const size_t byte_size)
+{
+  void* base =
+      mmap(nullptr, byte_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (base == MAP_FAILED) {
+    return ErrnoError("failed to map shared memory region '" + name_ + "'");
+  }
+
+  if (base_ != nullptr) {
+    retired_mappings_.emplace_back(base_, mapped_byte_size_);
+  }
+
+  // The policy is set before the pages are touched, it applies to the shared
+  // memory object so the pages the interpreter allocates follow it too. It
+  // is dropped if the system call isn't allowed, e.g. in a container.
+  if (numa_node_ != -1) {
+    TRITONSERVER_Error* err = BindToNumaNode(base, byte_size, numa_node_);
+    if (err != nullptr) {
+      LOG_MESSAGE(
+          TRITONSERVER_LOG_WARN,
+          (std::string("shared memory region '") + name_ +
+           "' is not bound to its NUMA node: " + TRITONSERVER_ErrorMessage(err))
+              .c_str());
+      TRITONSERVER_ErrorDelete(err);
+      numa_node_ = -1;
+    }
+  }
+
+  base_ = reinterpret_cast<char*>(base);
+  mapped_byte_size_ = byte_size;
+  header_ = reinterpret_cast<SharedMemoryHeader*>(base_);
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+SharedMemory::Allocate(const size_t byte_size, uint64_t* offset, char** buffer)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+
+  // The Python interpreter may have grown the region, e.g. in an execution
+  // whose tensors were never read by the backend.
+  if (header_->capacity > mapped_byte_size_) {
+    RETURN_IF_ERROR(Map(header_->capacity));
+  }
+
+  const uint64_t aligned_offset = AlignedOffset(header_->used);
+  const uint64_t end = aligned_offset + byte_size;
+
+  if (end > header_->capacity) {
+    uint64_t capacity = header_->capacity;
+    const uint64_t growth_byte_size = header_->growth_byte_size;
+    if (growth_byte_size == 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_UNAVAILABLE,
+          (std::string("shared memory region '") + name_ +
+           "' is full and growth is disabled")
+              .c_str());
+    }
+    while (capacity < end) {
+      capacity += growth_byte_size;
+    }
+
+    // Reserve the pages instead of only extending the file so that running
+    // out of space in /dev/shm is reported here and doesn't show up later as
+    // a SIGBUS while the tensor is being written.
+    const uint64_t current_capacity = header_->capacity;
+    const int err =
+        posix_fallocate(fd_, current_capacity, capacity - current_capacity);
+    if (err != 0) {
+      errno = err;
+      return ErrnoError("failed to grow shared memory region '" + name_ + "'");
+    }
+    RETURN_IF_ERROR(Map(capacity));
+    header_->capacity = capacity;
+  }
+
+  header_->used = end;
+  *offset = aligned_offset;
+  *buffer = base_ + aligned_offset;
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+SharedMemory::Buffer(
+    const uint64_t offset, const size_t byte_size, char** buffer)
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  if ((offset + byte_size) > header_->capacity) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INTERNAL,
+        (std::string("tensor at offset ") + std::to_string(offset) +
+         " with size " + std::to_string(byte_size) +
+         " is out of the bounds of shared memory region '" + name_ + "'")
+            .c_str());
+  }
+
+  // The Python interpreter may have grown the region.
+  if (header_->capacity > mapped_byte_size_) {
+    RETURN_IF_ERROR(Map(header_->capacity));
+  }
+
+  *buffer = base_ + offset;
+  return nullptr;
+}
+
+void
+SharedMemory::Reset()
+{
+  std::lock_guard<std::mutex> lk(mu_);
+  for (const auto& mapping : retired_mappings_) {
+    munmap(mapping.first, mapping.second);
+  }
+  retired_mappings_.clear();
+  header_->used = sizeof(SharedMemoryHeader);
+}
+
+}}}  // namespace triton::backend::python
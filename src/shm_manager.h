@@ -0,0 +1,105 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// Control block stored at the beginning of every shared memory region. The
+// layout must match 'SharedMemoryRegion' in startup.py.
+struct SharedMemoryHeader {
+  // Current size of the region in bytes, including this header.
+  uint64_t capacity;
+  // Number of bytes the region is extended by when it runs out of space.
+  uint64_t growth_byte_size;
+  // Offset of the first unallocated byte.
+  uint64_t used;
+};
+
+// A POSIX shared memory region used to exchange tensor data between the
+// backend and the Python interpreter of a model instance. Tensors are placed
+// in the region using a bump allocator that is reset before every execution,
+// and only their offsets are sent over gRPC. Both sides may allocate from the
+// region and grow it when it is full. If 'numa_node' isn't -1, the pages of
+// the region are preferably allocated on that NUMA node. The region may be
+// used from several threads, e.g. the inference requests a decoupled model
+// sends while its responses are read.
+class SharedMemory {
+ public:
+  static TRITONSERVER_Error* Create(
+      const std::string& name, const size_t default_byte_size,
+      const size_t growth_byte_size, const int numa_node,
+      std::unique_ptr<SharedMemory>* shm);
+
+  ~SharedMemory();
+
+  // Allocate 'byte_size' bytes in the region. The returned 'buffer' is valid
+  // until the next call to Reset, growing the region doesn't move it.
+  TRITONSERVER_Error* Allocate(
+      const size_t byte_size, uint64_t* offset, char** buffer);
+
+  // Get a pointer to 'byte_size' bytes located at 'offset'. The data may have
+  // been written by the Python interpreter, which can grow the region.
+  TRITONSERVER_Error* Buffer(
+      const uint64_t offset, const size_t byte_size, char** buffer);
+
+  // Release all the allocations. The buffers returned before are no longer
+  // valid.
+  void Reset();
+
+  const std::string& Name() const { return name_; }
+
+ private:
+  SharedMemory(const std::string& name, const int numa_node);
+
+  // Map the first 'byte_size' bytes of the shared memory object. The
+  // previous mapping is kept until the next Reset so that the buffers that
+  // point to it stay valid. Must be called with 'mu_' held, except while the
+  // region is created.
+  TRITONSERVER_Error* Map(const size_t byte_size);
+
+  std::string name_;
+  int fd_;
+  int numa_node_;
+
+  // Protects the mappings of the region
+  std::mutex mu_;
+  char* base_;
+  size_t mapped_byte_size_;
+  SharedMemoryHeader* header_;
+  std::vector<std::pair<char*, size_t>> retired_mappings_;
+};
+
+}}}  // namespace triton::backend::python
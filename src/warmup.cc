@@ -0,0 +1,281 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "warmup.h"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <random>
+
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// Fill 'data' with 'element_count' elements of 'dtype'. Random integers use
+// all their bits, random floating point values are in [1, 2) so that the
+// model never sees a NaN or an infinity. The generator isn't seeded, every
+// instance executes the same data.
+void
+GenerateData(
+    const TRITONSERVER_DataType dtype, const int64_t element_count,
+    const bool random, std::string* data)
+{
+  const size_t element_byte_size = TRITONSERVER_DataTypeByteSize(dtype);
+  data->assign(element_count * element_byte_size, '\0');
+  if (!random) {
+    return;
+  }
+
+  std::mt19937_64 generator;
+  char* element = &(*data)[0];
+  for (int64_t e = 0; e < element_count; ++e) {
+    uint64_t bits = generator();
+    switch (dtype) {
+      case TRITONSERVER_TYPE_BOOL:
+        bits &= 1;
+        break;
+      case TRITONSERVER_TYPE_FP16:
+        bits = 0x3C00 | (bits & 0x3FF);
+        break;
+      case TRITONSERVER_TYPE_BF16:
+        bits = 0x3F80 | (bits & 0x7F);
+        break;
+      case TRITONSERVER_TYPE_FP32:
+        bits = 0x3F800000 | (bits & 0x7FFFFF);
+        break;
+      case TRITONSERVER_TYPE_FP64:
+        bits = 0x3FF0000000000000 | (bits & 0xFFFFFFFFFFFFF);
+        break;
+      default:
+        break;
+    }
+    // The host is little-endian, the low bytes of 'bits' are the element
+    memcpy(element, &bits, element_byte_size);
+    element += element_byte_size;
+  }
+}
+
+// Repeat 'element' 'element_count' times as serialized BYTES elements, each
+// preceded by its 4-byte length.
+void
+GenerateBytesData(
+    const std::string& element, const int64_t element_count,
+    std::string* data)
+{
+  const uint32_t element_byte_size = element.size();
+  data->clear();
+  data->reserve(element_count * (sizeof(uint32_t) + element.size()));
+  for (int64_t e = 0; e < element_count; ++e) {
+    data->append(
+        reinterpret_cast<const char*>(&element_byte_size), sizeof(uint32_t));
+    data->append(element);
+  }
+}
+
+TRITONSERVER_Error*
+ReadDataFile(const std::string& path, std::string* contents)
+{
+  std::ifstream file(path, std::ios::binary);
+  if (!file) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_NOT_FOUND,
+        (std::string("failed to open warmup data file '") + path + "'")
+            .c_str());
+  }
+  contents->assign(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+  return nullptr;
+}
+
+TRITONSERVER_Error*
+ParseWarmupInput(
+    triton::common::TritonJson::Value& input_config, const std::string& name,
+    const int64_t batch_size, const std::string& warmup_dir,
+    WarmupInput* input)
+{
+  input->name = name;
+
+  std::string data_type;
+  RETURN_IF_ERROR(input_config.MemberAsString("data_type", &data_type));
+  input->dtype = ModelConfigDataTypeToTritonServerDataType(data_type);
+  if (input->dtype == TRITONSERVER_TYPE_INVALID) {
+    return TRITONSERVER_ErrorNew(
+        TRITONSERVER_ERROR_INVALID_ARG,
+        (std::string("warmup input '") + name + "' has an invalid data type")
+            .c_str());
+  }
+
+  std::vector<int64_t> dims;
+  RETURN_IF_ERROR(ParseShape(input_config, "dims", &dims));
+  input->dims.clear();
+  if (batch_size > 0) {
+    input->dims.push_back(batch_size);
+  }
+  for (const int64_t dim : dims) {
+    if (dim < 0) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("warmup input '") + name +
+           "' must not have variable-size dimensions")
+              .c_str());
+    }
+    input->dims.push_back(dim);
+  }
+  const int64_t element_count = GetElementCount(input->dims);
+  const int64_t batch_element_count = GetElementCount(dims);
+
+  bool random = false;
+  if (input_config.Find("random_data")) {
+    RETURN_IF_ERROR(input_config.MemberAsBool("random_data", &random));
+  }
+
+  if (input_config.Find("input_data_file")) {
+    std::string file_name;
+    RETURN_IF_ERROR(
+        input_config.MemberAsString("input_data_file", &file_name));
+    std::string contents;
+    RETURN_IF_ERROR(ReadDataFile(warmup_dir + "/" + file_name, &contents));
+
+    // The file holds the data of one batch item, or a single element of a
+    // BYTES input, and is repeated for the whole batch.
+    if (input->dtype == TRITONSERVER_TYPE_BYTES) {
+      GenerateBytesData(contents, element_count, &input->data);
+      return nullptr;
+    }
+    const uint64_t expected_byte_size =
+        batch_element_count * TRITONSERVER_DataTypeByteSize(input->dtype);
+    if (contents.size() != expected_byte_size) {
+      return TRITONSERVER_ErrorNew(
+          TRITONSERVER_ERROR_INVALID_ARG,
+          (std::string("warmup data file '") + file_name + "' of input '" +
+           name + "' has " + std::to_string(contents.size()) +
+           " bytes, expected " + std::to_string(expected_byte_size))
+              .c_str());
+    }
+    input->data.clear();
+    input->data.reserve(contents.size() * std::max<int64_t>(batch_size, 1));
+    for (int64_t b = 0; b < std::max<int64_t>(batch_size, 1); ++b) {
+      input->data.append(contents);
+    }
+    return nullptr;
+  }
+
+  // Random strings are empty, like zero data
+  if (input->dtype == TRITONSERVER_TYPE_BYTES) {
+    GenerateBytesData(std::string(), element_count, &input->data);
+  } else {
+    GenerateData(input->dtype, element_count, random, &input->data);
+  }
+  return nullptr;
+}
+
+}  // namespace
+
+TRITONSERVER_Error*
+ParseModelWarmup(
+    triton::common::TritonJson::Value& model_config, const int max_batch_size,
+    const std::string& warmup_dir, std::vector<WarmupSample>* samples)
+{
+  samples->clear();
+  triton::common::TritonJson::Value model_warmup;
+  if (!model_config.Find("model_warmup", &model_warmup)) {
+    return nullptr;
+  }
+
+  // Like the warmup of Triton, so that the models that only compute the
+  // requested outputs run all of their code
+  std::vector<std::string> output_names;
+  triton::common::TritonJson::Value outputs;
+  if (model_config.Find("output", &outputs)) {
+    for (size_t i = 0; i < outputs.ArraySize(); ++i) {
+      triton::common::TritonJson::Value output;
+      RETURN_IF_ERROR(outputs.IndexAsObject(i, &output));
+      std::string output_name;
+      RETURN_IF_ERROR(output.MemberAsString("name", &output_name));
+      output_names.push_back(output_name);
+    }
+  }
+
+  for (size_t i = 0; i < model_warmup.ArraySize(); ++i) {
+    triton::common::TritonJson::Value sample_config;
+    RETURN_IF_ERROR(model_warmup.IndexAsObject(i, &sample_config));
+
+    WarmupSample sample;
+    RETURN_IF_ERROR(sample_config.MemberAsString("name", &sample.name));
+
+    uint64_t batch_size = 0;
+    if (sample_config.Find("batch_size")) {
+      RETURN_IF_ERROR(sample_config.MemberAsUInt("batch_size", &batch_size));
+    }
+    if (max_batch_size > 0) {
+      batch_size = std::max<uint64_t>(batch_size, 1);
+    } else {
+      batch_size = 0;
+    }
+
+    sample.count = 1;
+    if (sample_config.Find("count")) {
+      RETURN_IF_ERROR(sample_config.MemberAsUInt("count", &sample.count));
+      sample.count = std::max<uint64_t>(sample.count, 1);
+    }
+
+    triton::common::TritonJson::Value inputs;
+    if (sample_config.Find("inputs", &inputs)) {
+      std::vector<std::string> input_names;
+      RETURN_IF_ERROR(inputs.Members(&input_names));
+      for (const std::string& input_name : input_names) {
+        triton::common::TritonJson::Value input_config;
+        RETURN_IF_ERROR(
+            inputs.MemberAsObject(input_name.c_str(), &input_config));
+        sample.inputs.emplace_back();
+        TRITONSERVER_Error* err = ParseWarmupInput(
+            input_config, input_name, batch_size, warmup_dir,
+            &sample.inputs.back());
+        if (err != nullptr) {
+          TRITONSERVER_Error* sample_err = TRITONSERVER_ErrorNew(
+              TRITONSERVER_ErrorCode(err),
+              (std::string("warmup sample '") + sample.name +
+               "': " + TRITONSERVER_ErrorMessage(err))
+                  .c_str());
+          TRITONSERVER_ErrorDelete(err);
+          return sample_err;
+        }
+      }
+    }
+
+    sample.requested_output_names = output_names;
+    samples->push_back(std::move(sample));
+  }
+
+  return nullptr;
+}
+
+}}}  // namespace triton::backend::python
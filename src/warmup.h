@@ -0,0 +1,65 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "triton/common/triton_json.h"
+#include "triton/core/tritonserver.h"
+
+namespace triton { namespace backend { namespace python {
+
+// An input of a warmup sample. 'data' holds the tensor of the whole batch,
+// in the layout that the interpreter reads from the shared memory region.
+struct WarmupInput {
+  std::string name;
+  TRITONSERVER_DataType dtype;
+  std::vector<int64_t> dims;
+  std::string data;
+};
+
+// A sample of the 'model_warmup' section of the model configuration. Every
+// instance executes it 'count' times before it is ready. All the outputs of
+// the model are requested.
+struct WarmupSample {
+  std::string name;
+  uint64_t count;
+  std::vector<WarmupInput> inputs;
+  std::vector<std::string> requested_output_names;
+};
+
+// Read the warmup samples of 'model_config' and generate their input data.
+// The batch dimension is added to the inputs if 'max_batch_size' is larger
+// than 0, and the files of 'input_data_file' are read from 'warmup_dir'.
+TRITONSERVER_Error* ParseModelWarmup(
+    triton::common::TritonJson::Value& model_config, const int max_batch_size,
+    const std::string& warmup_dir, std::vector<WarmupSample>* samples);
+
+}}}  // namespace triton::backend::python
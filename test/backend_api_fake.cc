@@ -0,0 +1,165 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "backend_api_fake.h"
+
+extern "C" {
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestInputCount(
+    TRITONBACKEND_Request* request, uint32_t* count)
+{
+  *count = request->inputs.size();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestInputByIndex(
+    TRITONBACKEND_Request* request, const uint32_t index,
+    TRITONBACKEND_Input** input)
+{
+  *input = &request->inputs[index];
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_InputProperties(
+    TRITONBACKEND_Input* input, const char** name,
+    TRITONSERVER_DataType* datatype, const int64_t** shape,
+    uint32_t* dims_count, uint64_t* byte_size, uint32_t* buffer_count)
+{
+  if (name != nullptr) {
+    *name = input->name.c_str();
+  }
+  if (datatype != nullptr) {
+    *datatype = input->dtype;
+  }
+  if (shape != nullptr) {
+    *shape = input->shape.data();
+  }
+  if (dims_count != nullptr) {
+    *dims_count = input->shape.size();
+  }
+  if (byte_size != nullptr) {
+    *byte_size = 0;
+    for (const std::string& buffer : input->buffers) {
+      *byte_size += buffer.size();
+    }
+  }
+  if (buffer_count != nullptr) {
+    *buffer_count = input->buffers.size();
+  }
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_InputBuffer(
+    TRITONBACKEND_Input* input, const uint32_t index, const void** buffer,
+    uint64_t* buffer_byte_size, TRITONSERVER_MemoryType* memory_type,
+    int64_t* memory_type_id)
+{
+  *buffer = input->buffers[index].data();
+  *buffer_byte_size = input->buffers[index].size();
+  *memory_type = input->memory_type;
+  *memory_type_id = 0;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestOutputCount(
+    TRITONBACKEND_Request* request, uint32_t* count)
+{
+  *count = request->requested_output_names.size();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONBACKEND_RequestOutputName(
+    TRITONBACKEND_Request* request, const uint32_t index,
+    const char** output_name)
+{
+  *output_name = request->requested_output_names[index].c_str();
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_MetricIncrement(TRITONSERVER_Metric* metric, double value)
+{
+  metric->value += value;
+  return nullptr;  // success
+}
+
+TRITONSERVER_Error*
+TRITONSERVER_MetricSet(TRITONSERVER_Metric* metric, double value)
+{
+  metric->value = value;
+  return nullptr;  // success
+}
+
+uint32_t
+TRITONSERVER_DataTypeByteSize(TRITONSERVER_DataType datatype)
+{
+  switch (datatype) {
+    case TRITONSERVER_TYPE_BOOL:
+    case TRITONSERVER_TYPE_UINT8:
+    case TRITONSERVER_TYPE_INT8:
+      return 1;
+    case TRITONSERVER_TYPE_UINT16:
+    case TRITONSERVER_TYPE_INT16:
+    case TRITONSERVER_TYPE_FP16:
+    case TRITONSERVER_TYPE_BF16:
+      return 2;
+    case TRITONSERVER_TYPE_UINT32:
+    case TRITONSERVER_TYPE_INT32:
+    case TRITONSERVER_TYPE_FP32:
+      return 4;
+    case TRITONSERVER_TYPE_UINT64:
+    case TRITONSERVER_TYPE_INT64:
+    case TRITONSERVER_TYPE_FP64:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
+}  // extern "C"
+
+namespace triton { namespace backend { namespace python {
+
+TRITONBACKEND_Input
+FakeInput(const std::string& name, const std::string& data)
+{
+  TRITONBACKEND_Input input;
+  input.name = name;
+  input.dtype = TRITONSERVER_TYPE_UINT8;
+  input.shape = {static_cast<int64_t>(data.size())};
+  input.memory_type = TRITONSERVER_MEMORY_CPU;
+  input.buffers = {data};
+  return input;
+}
+
+}}}  // namespace triton::backend::python
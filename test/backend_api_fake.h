@@ -0,0 +1,64 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#pragma once
+
+// The parts of the backend API that the unit tests pass to the sources of
+// the backend. The tests run without a server, so the requests and their
+// inputs are plain objects that the tests fill in.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "triton/core/tritonbackend.h"
+#include "triton/core/tritonserver.h"
+
+struct TRITONBACKEND_Input {
+  std::string name;
+  TRITONSERVER_DataType dtype;
+  std::vector<int64_t> shape;
+  TRITONSERVER_MemoryType memory_type;
+  std::vector<std::string> buffers;
+};
+
+struct TRITONBACKEND_Request {
+  std::vector<TRITONBACKEND_Input> inputs;
+  std::vector<std::string> requested_output_names;
+};
+
+// Keeps the last value that the backend reported.
+struct TRITONSERVER_Metric {
+  double value;
+};
+
+namespace triton { namespace backend { namespace python {
+
+// A 1-D UINT8 input in CPU memory with 'data' in a single buffer.
+TRITONBACKEND_Input FakeInput(const std::string& name, const std::string& data);
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,118 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "buffer_pool.h"
+
+#include "backend_api_fake.h"
+#include "gtest/gtest.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+const std::vector<BackendMemory::AllocationType> kCpu{
+    BackendMemory::AllocationType::CPU};
+
+TEST(BufferPoolTest, NoAllocationTypeIsInvalid)
+{
+  std::unique_ptr<BufferPool> pool;
+  TRITONSERVER_Error* err = BufferPool::Create(nullptr, {}, 1 << 20, &pool);
+  ASSERT_NE(nullptr, err);
+  EXPECT_EQ(TRITONSERVER_ERROR_INVALID_ARG, TRITONSERVER_ErrorCode(err));
+  TRITONSERVER_ErrorDelete(err);
+}
+
+TEST(BufferPoolTest, RoundsUpToTheSizeClass)
+{
+  std::unique_ptr<BufferPool> pool;
+  ASSERT_EQ(nullptr, BufferPool::Create(nullptr, kCpu, 1 << 20, &pool));
+
+  BackendMemory* small;
+  ASSERT_EQ(nullptr, pool->Acquire(1, &small));
+  EXPECT_EQ(4096u, small->ByteSize());
+  BackendMemory* large;
+  ASSERT_EQ(nullptr, pool->Acquire(4097, &large));
+  EXPECT_EQ(8192u, large->ByteSize());
+  pool->Release(small);
+  pool->Release(large);
+}
+
+TEST(BufferPoolTest, ReusesAReleasedBufferOfTheSameClass)
+{
+  std::unique_ptr<BufferPool> pool;
+  ASSERT_EQ(nullptr, BufferPool::Create(nullptr, kCpu, 1 << 20, &pool));
+  TRITONSERVER_Metric hit{0}, miss{0}, byte_size{0};
+  pool->SetMetrics(&hit, &miss, &byte_size);
+
+  BackendMemory* buffer;
+  ASSERT_EQ(nullptr, pool->Acquire(100, &buffer));
+  pool->Release(buffer);
+  EXPECT_EQ(4096, byte_size.value);
+
+  BackendMemory* reused;
+  ASSERT_EQ(nullptr, pool->Acquire(4000, &reused));
+  EXPECT_EQ(buffer, reused);
+  EXPECT_EQ(0, byte_size.value);
+
+  // Kept for its own class only
+  pool->Release(reused);
+  BackendMemory* other_class;
+  ASSERT_EQ(nullptr, pool->Acquire(5000, &other_class));
+  EXPECT_NE(reused, other_class);
+  pool->Release(other_class);
+
+  EXPECT_EQ(1, hit.value);
+  EXPECT_EQ(2, miss.value);
+  EXPECT_EQ(4096 + 8192, byte_size.value);
+}
+
+TEST(BufferPoolTest, FreesTheBuffersThatDontFit)
+{
+  std::unique_ptr<BufferPool> pool;
+  ASSERT_EQ(nullptr, BufferPool::Create(nullptr, kCpu, 4096, &pool));
+  TRITONSERVER_Metric hit{0}, miss{0}, byte_size{0};
+  pool->SetMetrics(&hit, &miss, &byte_size);
+
+  BackendMemory* first;
+  BackendMemory* second;
+  ASSERT_EQ(nullptr, pool->Acquire(100, &first));
+  ASSERT_EQ(nullptr, pool->Acquire(100, &second));
+  pool->Release(first);
+  pool->Release(second);
+  EXPECT_EQ(4096, byte_size.value);
+
+  ASSERT_EQ(nullptr, pool->Acquire(100, &first));
+  ASSERT_EQ(nullptr, pool->Acquire(100, &second));
+  EXPECT_EQ(1, hit.value);
+  EXPECT_EQ(3, miss.value);
+  pool->Release(first);
+  pool->Release(second);
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::python
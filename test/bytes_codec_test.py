@@ -0,0 +1,90 @@
+# Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+#
+# Redistribution and use in source and binary forms, with or without
+# modification, are permitted provided that the following conditions
+# are met:
+#  * Redistributions of source code must retain the above copyright
+#    notice, this list of conditions and the following disclaimer.
+#  * Redistributions in binary form must reproduce the above copyright
+#    notice, this list of conditions and the following disclaimer in the
+#    documentation and/or other materials provided with the distribution.
+#  * Neither the name of NVIDIA CORPORATION nor the names of its
+#    contributors may be used to endorse or promote products derived
+#    from this software without specific prior written permission.
+#
+# THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+# EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+# IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+# PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+# CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+# EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+# PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+# PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+# OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+# (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+# OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+# Round trips of the BYTES tensor codec of startup.py. Run with the build
+# directory, where the generated python_host_pb2 modules are, and
+# src/resources on PYTHONPATH.
+
+import unittest
+
+import numpy as np
+
+import startup
+import triton_python_backend_utils as tpb_utils
+
+
+class BytesCodecTest(unittest.TestCase):
+
+    def round_trip(self, elements):
+        tensor = np.array(elements, dtype=np.object_)
+        serialized = startup.serialize_byte_tensor(tensor)
+        self.assertEqual(serialized.dtype, np.uint8)
+        return startup.deserialize_bytes_tensor(serialized.tobytes())
+
+    def test_empty_tensor(self):
+        serialized = startup.serialize_byte_tensor(
+            np.array([], dtype=np.object_))
+        self.assertEqual(serialized.dtype, np.uint8)
+        self.assertEqual(serialized.size, 0)
+        self.assertEqual(
+            startup.deserialize_bytes_tensor(serialized.tobytes()).size, 0)
+
+    def test_zero_length_elements(self):
+        deserialized = self.round_trip([b'', b'', b''])
+        self.assertEqual(deserialized.tolist(), [b'', b'', b''])
+
+    def test_mixed_lengths(self):
+        elements = [b'a', b'', b'bcd', b'x' * 1000, b'ef']
+        deserialized = self.round_trip(elements)
+        self.assertEqual(deserialized.tolist(), elements)
+
+    def test_layout(self):
+        serialized = startup.serialize_byte_tensor(
+            np.array([b'ab', b'', 'c'], dtype=np.object_))
+        self.assertEqual(serialized.tobytes(),
+                         b'\x02\x00\x00\x00ab\x00\x00\x00\x00\x01\x00\x00\x00c')
+
+    def test_multidimensional_tensor(self):
+        tensor = np.array([[b'a', b'bc'], [b'', b'def']], dtype=np.bytes_)
+        serialized = startup.serialize_byte_tensor(tensor)
+        deserialized = startup.deserialize_bytes_tensor(serialized.tobytes())
+        self.assertEqual(deserialized.tolist(), [b'a', b'bc', b'', b'def'])
+
+    def test_truncated_element(self):
+        serialized = startup.serialize_byte_tensor(
+            np.array([b'abc', b'defg'], dtype=np.object_)).tobytes()
+        with self.assertRaises(tpb_utils.TritonModelException):
+            startup.deserialize_bytes_tensor(serialized[:-1])
+
+    def test_truncated_length(self):
+        serialized = startup.serialize_byte_tensor(
+            np.array([b'abc'], dtype=np.object_)).tobytes()
+        with self.assertRaises(tpb_utils.TritonModelException):
+            startup.deserialize_bytes_tensor(serialized + b'\x01\x00')
+
+
+if __name__ == '__main__':
+    unittest.main()
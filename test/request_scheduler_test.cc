@@ -0,0 +1,122 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "request_scheduler.h"
+
+#include "backend_api_fake.h"
+#include "gtest/gtest.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+TRITONBACKEND_Request
+FakeRequest(const size_t byte_size)
+{
+  TRITONBACKEND_Request request;
+  request.inputs.push_back(FakeInput("INPUT0", std::string(byte_size, 'x')));
+  return request;
+}
+
+TEST(RequestSchedulerTest, SmallRequestsShareAnExecution)
+{
+  std::vector<TRITONBACKEND_Request> requests{
+      FakeRequest(30), FakeRequest(10), FakeRequest(20)};
+  std::vector<TRITONBACKEND_Request*> request_ptrs{
+      &requests[0], &requests[1], &requests[2]};
+
+  std::vector<std::vector<TRITONBACKEND_Request*>> executions;
+  ASSERT_EQ(
+      nullptr, ScheduleRequests(
+                   request_ptrs.data(), request_ptrs.size(), 100, &executions));
+  ASSERT_EQ(1u, executions.size());
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{
+          &requests[1], &requests[2], &requests[0]}),
+      executions[0]);
+}
+
+TEST(RequestSchedulerTest, LargeRequestsRunAloneSmallestFirst)
+{
+  std::vector<TRITONBACKEND_Request> requests{
+      FakeRequest(300), FakeRequest(10), FakeRequest(100), FakeRequest(20)};
+  std::vector<TRITONBACKEND_Request*> request_ptrs{
+      &requests[0], &requests[1], &requests[2], &requests[3]};
+
+  std::vector<std::vector<TRITONBACKEND_Request*>> executions;
+  ASSERT_EQ(
+      nullptr, ScheduleRequests(
+                   request_ptrs.data(), request_ptrs.size(), 100, &executions));
+  ASSERT_EQ(3u, executions.size());
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{&requests[1], &requests[3]}),
+      executions[0]);
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{&requests[2]}), executions[1]);
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{&requests[0]}), executions[2]);
+}
+
+TEST(RequestSchedulerTest, KeepsTheOrderOfRequestsOfTheSameSize)
+{
+  std::vector<TRITONBACKEND_Request> requests{
+      FakeRequest(200), FakeRequest(200), FakeRequest(200)};
+  std::vector<TRITONBACKEND_Request*> request_ptrs{
+      &requests[0], &requests[1], &requests[2]};
+
+  std::vector<std::vector<TRITONBACKEND_Request*>> executions;
+  ASSERT_EQ(
+      nullptr, ScheduleRequests(
+                   request_ptrs.data(), request_ptrs.size(), 100, &executions));
+  ASSERT_EQ(3u, executions.size());
+  for (size_t e = 0; e < executions.size(); ++e) {
+    EXPECT_EQ(
+        (std::vector<TRITONBACKEND_Request*>{&requests[e]}), executions[e]);
+  }
+}
+
+TEST(RequestSchedulerTest, CountsTheBytesOfAllInputs)
+{
+  std::vector<TRITONBACKEND_Request> requests{FakeRequest(60), FakeRequest(80)};
+  requests[0].inputs.push_back(FakeInput("INPUT1", std::string(60, 'x')));
+  std::vector<TRITONBACKEND_Request*> request_ptrs{
+      &requests[0], &requests[1]};
+
+  std::vector<std::vector<TRITONBACKEND_Request*>> executions;
+  ASSERT_EQ(
+      nullptr, ScheduleRequests(
+                   request_ptrs.data(), request_ptrs.size(), 100, &executions));
+  ASSERT_EQ(2u, executions.size());
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{&requests[1]}), executions[0]);
+  EXPECT_EQ(
+      (std::vector<TRITONBACKEND_Request*>{&requests[0]}), executions[1]);
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,204 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "response_cache.h"
+
+#include "backend_api_fake.h"
+#include "gtest/gtest.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+TRITONBACKEND_Request
+FakeRequest(const std::string& data)
+{
+  TRITONBACKEND_Request request;
+  request.inputs.push_back(FakeInput("INPUT0", data));
+  request.requested_output_names.push_back("OUTPUT0");
+  return request;
+}
+
+CachedResponse
+FakeResponse(const std::string& data)
+{
+  CachedOutput output;
+  output.name = "OUTPUT0";
+  output.dtype = TRITONSERVER_TYPE_UINT8;
+  output.shape = {static_cast<int64_t>(data.size())};
+  output.data = data;
+  return CachedResponse{output};
+}
+
+CacheKey
+RequestKey(TRITONBACKEND_Request* request)
+{
+  CacheKey key;
+  EXPECT_EQ(nullptr, ResponseCache::RequestKey(request, &key));
+  return key;
+}
+
+void
+Insert(
+    ResponseCache* cache, TRITONBACKEND_Request* request,
+    const std::string& data)
+{
+  ASSERT_EQ(
+      nullptr,
+      cache->Insert(RequestKey(request), request, FakeResponse(data)));
+}
+
+// The data of the response cached for 'request', or an empty string if there
+// is none.
+std::string
+Lookup(ResponseCache* cache, TRITONBACKEND_Request* request)
+{
+  std::shared_ptr<const CachedResponse> response;
+  EXPECT_EQ(nullptr, cache->Lookup(RequestKey(request), request, &response));
+  return (response == nullptr) ? std::string() : response->front().data;
+}
+
+TEST(ResponseCacheTest, ZeroSizeIsInvalid)
+{
+  std::unique_ptr<ResponseCache> cache;
+  TRITONSERVER_Error* err = ResponseCache::Create(0, &cache);
+  ASSERT_NE(nullptr, err);
+  EXPECT_EQ(TRITONSERVER_ERROR_INVALID_ARG, TRITONSERVER_ErrorCode(err));
+  TRITONSERVER_ErrorDelete(err);
+}
+
+TEST(ResponseCacheTest, HitOnTheSameRequest)
+{
+  std::unique_ptr<ResponseCache> cache;
+  ASSERT_EQ(nullptr, ResponseCache::Create(1 << 20, &cache));
+
+  TRITONBACKEND_Request request = FakeRequest("abcd");
+  EXPECT_EQ("", Lookup(cache.get(), &request));
+  Insert(cache.get(), &request, "dcba");
+
+  // Another request with the same inputs and requested outputs
+  TRITONBACKEND_Request same_request = FakeRequest("abcd");
+  EXPECT_EQ("dcba", Lookup(cache.get(), &same_request));
+}
+
+TEST(ResponseCacheTest, MissOnAnotherRequest)
+{
+  std::unique_ptr<ResponseCache> cache;
+  ASSERT_EQ(nullptr, ResponseCache::Create(1 << 20, &cache));
+
+  TRITONBACKEND_Request request = FakeRequest("abcd");
+  Insert(cache.get(), &request, "dcba");
+
+  TRITONBACKEND_Request other_data = FakeRequest("abce");
+  EXPECT_EQ("", Lookup(cache.get(), &other_data));
+
+  TRITONBACKEND_Request other_outputs = FakeRequest("abcd");
+  other_outputs.requested_output_names.push_back("OUTPUT1");
+  EXPECT_EQ("", Lookup(cache.get(), &other_outputs));
+
+  // The same bytes in other buffers
+  TRITONBACKEND_Request other_buffers = FakeRequest("abcd");
+  other_buffers.inputs[0].buffers = {"ab", "cd"};
+  EXPECT_EQ("", Lookup(cache.get(), &other_buffers));
+}
+
+TEST(ResponseCacheTest, HashCollisionIsAMiss)
+{
+  std::unique_ptr<ResponseCache> cache;
+  ASSERT_EQ(nullptr, ResponseCache::Create(1 << 20, &cache));
+
+  TRITONBACKEND_Request request = FakeRequest("abcd");
+  const CacheKey key = RequestKey(&request);
+  ASSERT_EQ(nullptr, cache->Insert(key, &request, FakeResponse("dcba")));
+
+  TRITONBACKEND_Request colliding_request = FakeRequest("efgh");
+  CacheKey colliding_key = RequestKey(&colliding_request);
+  ASSERT_NE(key.hash, colliding_key.hash);
+  colliding_key.hash = key.hash;
+
+  std::shared_ptr<const CachedResponse> response;
+  ASSERT_EQ(
+      nullptr, cache->Lookup(colliding_key, &colliding_request, &response));
+  EXPECT_EQ(nullptr, response);
+
+  // The colliding request doesn't replace the cached one
+  ASSERT_EQ(
+      nullptr, cache->Insert(
+                   colliding_key, &colliding_request, FakeResponse("hgfe")));
+  ASSERT_EQ(
+      nullptr, cache->Lookup(colliding_key, &colliding_request, &response));
+  EXPECT_EQ(nullptr, response);
+  EXPECT_EQ("dcba", Lookup(cache.get(), &request));
+}
+
+TEST(ResponseCacheTest, EvictsTheLeastRecentlyUsed)
+{
+  // Holds two of the entries below, which take about 370 bytes each
+  std::unique_ptr<ResponseCache> cache;
+  ASSERT_EQ(nullptr, ResponseCache::Create(800, &cache));
+
+  TRITONBACKEND_Request a = FakeRequest("aaaa");
+  TRITONBACKEND_Request b = FakeRequest("bbbb");
+  TRITONBACKEND_Request c = FakeRequest("cccc");
+  Insert(cache.get(), &a, "AAAA");
+  Insert(cache.get(), &b, "BBBB");
+
+  // A hit makes 'a' the most recently used
+  EXPECT_EQ("AAAA", Lookup(cache.get(), &a));
+  Insert(cache.get(), &c, "CCCC");
+
+  EXPECT_EQ("AAAA", Lookup(cache.get(), &a));
+  EXPECT_EQ("", Lookup(cache.get(), &b));
+  EXPECT_EQ("CCCC", Lookup(cache.get(), &c));
+}
+
+TEST(ResponseCacheTest, ResponseLargerThanTheCacheIsNotCached)
+{
+  std::unique_ptr<ResponseCache> cache;
+  ASSERT_EQ(nullptr, ResponseCache::Create(800, &cache));
+
+  TRITONBACKEND_Request small = FakeRequest("abcd");
+  TRITONBACKEND_Request large = FakeRequest("efgh");
+  Insert(cache.get(), &small, "dcba");
+  Insert(cache.get(), &large, std::string(1000, 'x'));
+
+  EXPECT_EQ("", Lookup(cache.get(), &large));
+  EXPECT_EQ("dcba", Lookup(cache.get(), &small));
+}
+
+TEST(ResponseCacheTest, GpuInputIsNotCacheable)
+{
+  TRITONBACKEND_Request request = FakeRequest("abcd");
+  EXPECT_TRUE(RequestKey(&request).cacheable);
+
+  request.inputs[0].memory_type = TRITONSERVER_MEMORY_GPU;
+  EXPECT_FALSE(RequestKey(&request).cacheable);
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::python
@@ -0,0 +1,248 @@
+// Copyright (c) 2020, NVIDIA CORPORATION. All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without
+// modification, are permitted provided that the following conditions
+// are met:
+//  * Redistributions of source code must retain the above copyright
+//    notice, this list of conditions and the following disclaimer.
+//  * Redistributions in binary form must reproduce the above copyright
+//    notice, this list of conditions and the following disclaimer in the
+//    documentation and/or other materials provided with the distribution.
+//  * Neither the name of NVIDIA CORPORATION nor the names of its
+//    contributors may be used to endorse or promote products derived
+//    from this software without specific prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS ``AS IS'' AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+// IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR
+// PURPOSE ARE DISCLAIMED.  IN NO EVENT SHALL THE COPYRIGHT OWNER OR
+// CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL,
+// EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR
+// PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY
+// OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+// (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+// OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+
+#include "warmup.h"
+
+#include <stdlib.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
+#include "backend_api_fake.h"
+#include "gtest/gtest.h"
+#include "triton/backend/backend_common.h"
+
+namespace triton { namespace backend { namespace python {
+
+namespace {
+
+// A model with one FP32 input and two outputs, and the 'model_warmup'
+// section 'warmup'.
+std::string
+ModelConfig(const int max_batch_size, const std::string& warmup)
+{
+  return std::string("{\"name\": \"model\", \"max_batch_size\": ") +
+         std::to_string(max_batch_size) +
+         ", \"input\": [{\"name\": \"INPUT0\", \"data_type\": \"TYPE_FP32\", "
+         "\"dims\": [3]}], \"output\": [{\"name\": \"OUTPUT0\", "
+         "\"data_type\": \"TYPE_FP32\", \"dims\": [3]}, {\"name\": "
+         "\"OUTPUT1\", \"data_type\": \"TYPE_FP32\", \"dims\": [3]}], "
+         "\"model_warmup\": " +
+         warmup + "}";
+}
+
+TRITONSERVER_Error*
+ParseWarmup(
+    const int max_batch_size, const std::string& warmup,
+    const std::string& warmup_dir, std::vector<WarmupSample>* samples)
+{
+  triton::common::TritonJson::Value model_config;
+  RETURN_IF_ERROR(model_config.Parse(ModelConfig(max_batch_size, warmup)));
+  return ParseModelWarmup(model_config, max_batch_size, warmup_dir, samples);
+}
+
+std::vector<float>
+Floats(const std::string& data)
+{
+  std::vector<float> values(data.size() / sizeof(float));
+  memcpy(values.data(), data.data(), data.size());
+  return values;
+}
+
+TEST(WarmupTest, NoWarmupSection)
+{
+  triton::common::TritonJson::Value model_config;
+  ASSERT_EQ(nullptr, model_config.Parse("{\"name\": \"model\"}"));
+  std::vector<WarmupSample> samples(1);
+  ASSERT_EQ(nullptr, ParseModelWarmup(model_config, 0, "", &samples));
+  EXPECT_TRUE(samples.empty());
+}
+
+TEST(WarmupTest, ZeroDataWithTheBatchDimension)
+{
+  std::vector<WarmupSample> samples;
+  ASSERT_EQ(
+      nullptr,
+      ParseWarmup(
+          8,
+          "[{\"name\": \"zero\", \"batch_size\": 2, \"count\": 3, "
+          "\"inputs\": {\"INPUT0\": {\"data_type\": \"TYPE_FP32\", "
+          "\"dims\": [3], \"zero_data\": true}}}]",
+          "", &samples));
+  ASSERT_EQ(1u, samples.size());
+  const WarmupSample& sample = samples[0];
+  EXPECT_EQ("zero", sample.name);
+  EXPECT_EQ(3u, sample.count);
+  EXPECT_EQ(
+      (std::vector<std::string>{"OUTPUT0", "OUTPUT1"}),
+      sample.requested_output_names);
+  ASSERT_EQ(1u, sample.inputs.size());
+  const WarmupInput& input = sample.inputs[0];
+  EXPECT_EQ("INPUT0", input.name);
+  EXPECT_EQ(TRITONSERVER_TYPE_FP32, input.dtype);
+  EXPECT_EQ((std::vector<int64_t>{2, 3}), input.dims);
+  EXPECT_EQ(std::string(2 * 3 * sizeof(float), '\0'), input.data);
+}
+
+TEST(WarmupTest, NoBatchDimensionWithoutBatching)
+{
+  std::vector<WarmupSample> samples;
+  ASSERT_EQ(
+      nullptr,
+      ParseWarmup(
+          0,
+          "[{\"name\": \"zero\", \"batch_size\": 2, \"count\": 0, "
+          "\"inputs\": {\"INPUT0\": {\"data_type\": \"TYPE_FP32\", "
+          "\"dims\": [3], \"zero_data\": true}}}]",
+          "", &samples));
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(1u, samples[0].count);
+  EXPECT_EQ((std::vector<int64_t>{3}), samples[0].inputs[0].dims);
+  EXPECT_EQ(3 * sizeof(float), samples[0].inputs[0].data.size());
+}
+
+TEST(WarmupTest, RandomFloatsAreFinite)
+{
+  std::vector<WarmupSample> samples;
+  ASSERT_EQ(
+      nullptr,
+      ParseWarmup(
+          0,
+          "[{\"name\": \"random\", \"inputs\": {\"INPUT0\": {\"data_type\": "
+          "\"TYPE_FP32\", \"dims\": [64], \"random_data\": true}}}]",
+          "", &samples));
+  ASSERT_EQ(1u, samples.size());
+  const std::vector<float> values = Floats(samples[0].inputs[0].data);
+  ASSERT_EQ(64u, values.size());
+  for (const float value : values) {
+    EXPECT_GE(value, 1.0f);
+    EXPECT_LT(value, 2.0f);
+  }
+}
+
+TEST(WarmupTest, BytesElementsAreEmpty)
+{
+  std::vector<WarmupSample> samples;
+  ASSERT_EQ(
+      nullptr,
+      ParseWarmup(
+          0,
+          "[{\"name\": \"bytes\", \"inputs\": {\"INPUT0\": {\"data_type\": "
+          "\"TYPE_STRING\", \"dims\": [2], \"zero_data\": true}}}]",
+          "", &samples));
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(TRITONSERVER_TYPE_BYTES, samples[0].inputs[0].dtype);
+  EXPECT_EQ(
+      std::string(2 * sizeof(uint32_t), '\0'), samples[0].inputs[0].data);
+}
+
+TEST(WarmupTest, VariableSizeDimensionIsInvalid)
+{
+  std::vector<WarmupSample> samples;
+  TRITONSERVER_Error* err = ParseWarmup(
+      0,
+      "[{\"name\": \"variable\", \"inputs\": {\"INPUT0\": {\"data_type\": "
+      "\"TYPE_FP32\", \"dims\": [-1], \"zero_data\": true}}}]",
+      "", &samples);
+  ASSERT_NE(nullptr, err);
+  EXPECT_EQ(TRITONSERVER_ERROR_INVALID_ARG, TRITONSERVER_ErrorCode(err));
+  EXPECT_NE(
+      nullptr,
+      strstr(TRITONSERVER_ErrorMessage(err), "warmup sample 'variable'"));
+  TRITONSERVER_ErrorDelete(err);
+}
+
+class WarmupDataFileTest : public ::testing::Test {
+ protected:
+  void SetUp() override
+  {
+    char dir[] = "/tmp/warmup_test_XXXXXX";
+    ASSERT_NE(nullptr, mkdtemp(dir));
+    warmup_dir_ = dir;
+
+    // The data of one batch item of INPUT0
+    const float values[3] = {1.0f, 2.0f, 3.0f};
+    std::ofstream file(warmup_dir_ + "/input0", std::ios::binary);
+    file.write(reinterpret_cast<const char*>(values), sizeof(values));
+  }
+
+  void TearDown() override
+  {
+    unlink((warmup_dir_ + "/input0").c_str());
+    rmdir(warmup_dir_.c_str());
+  }
+
+  std::string warmup_dir_;
+};
+
+TEST_F(WarmupDataFileTest, RepeatedForTheBatch)
+{
+  std::vector<WarmupSample> samples;
+  ASSERT_EQ(
+      nullptr,
+      ParseWarmup(
+          8,
+          "[{\"name\": \"file\", \"batch_size\": 2, \"inputs\": {\"INPUT0\": "
+          "{\"data_type\": \"TYPE_FP32\", \"dims\": [3], "
+          "\"input_data_file\": \"input0\"}}}]",
+          warmup_dir_, &samples));
+  ASSERT_EQ(1u, samples.size());
+  EXPECT_EQ(
+      (std::vector<float>{1.0f, 2.0f, 3.0f, 1.0f, 2.0f, 3.0f}),
+      Floats(samples[0].inputs[0].data));
+}
+
+TEST_F(WarmupDataFileTest, WrongSizeIsInvalid)
+{
+  std::vector<WarmupSample> samples;
+  TRITONSERVER_Error* err = ParseWarmup(
+      0,
+      "[{\"name\": \"file\", \"inputs\": {\"INPUT0\": {\"data_type\": "
+      "\"TYPE_FP32\", \"dims\": [4], \"input_data_file\": \"input0\"}}}]",
+      warmup_dir_, &samples);
+  ASSERT_NE(nullptr, err);
+  EXPECT_EQ(TRITONSERVER_ERROR_INVALID_ARG, TRITONSERVER_ErrorCode(err));
+  TRITONSERVER_ErrorDelete(err);
+}
+
+TEST_F(WarmupDataFileTest, MissingFileIsNotFound)
+{
+  std::vector<WarmupSample> samples;
+  TRITONSERVER_Error* err = ParseWarmup(
+      0,
+      "[{\"name\": \"file\", \"inputs\": {\"INPUT0\": {\"data_type\": "
+      "\"TYPE_FP32\", \"dims\": [3], \"input_data_file\": \"missing\"}}}]",
+      warmup_dir_, &samples);
+  ASSERT_NE(nullptr, err);
+  EXPECT_EQ(TRITONSERVER_ERROR_NOT_FOUND, TRITONSERVER_ErrorCode(err));
+  TRITONSERVER_ErrorDelete(err);
+}
+
+}  // namespace
+
+}}}  // namespace triton::backend::python